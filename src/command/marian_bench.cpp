@@ -0,0 +1,392 @@
+#include "marian.h"
+
+#include "common/cli_wrapper.h"
+#include "common/file_stream.h"
+#include "common/regex.h"
+#include "common/timer.h"
+#include "common/version.h"
+#include "functional/functional.h"
+#include "tensors/tensor_allocator.h"
+#include "tensors/tensor_operators.h"
+#include "tensors/cpu/sharp/int_gemm.h"
+#include "tensors/cpu/fbgemm/packed_gemm.h"
+
+#if USE_FBGEMM
+#include "fbgemm/Utils.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <random>
+
+namespace marian {
+
+// Runs single tensor operators on the CPU backend with shapes of a transformer model and collects
+// the wall-clock time of every repetition. Operators are called directly on tensors, so there is
+// no graph overhead in the measurements.
+class OperatorBenchmark {
+public:
+  struct Result {
+    std::string name;
+    std::string shape;
+    double flops;              // floating point operations per call, 0 if not meaningful
+    std::vector<double> times; // milliseconds per repetition
+  };
+
+private:
+  Ptr<Options> options_;
+  Ptr<Backend> backend_;
+  Ptr<TensorAllocator> allocator_;
+  std::mt19937 engine_;
+
+  size_t warmup_;
+  size_t repetitions_;
+  regex::regex filter_;
+
+  std::vector<Result> results_;
+
+  static double percentile(std::vector<double> times, double p) {
+    std::sort(times.begin(), times.end());
+    size_t i = (size_t)std::ceil(p * times.size());
+    return times[std::min(std::max(i, (size_t)1), times.size()) - 1];
+  }
+
+public:
+  OperatorBenchmark(Ptr<Options> options)
+      : options_(options),
+        engine_((unsigned int)options->get<size_t>("seed")),
+        warmup_(options->get<size_t>("warmup")),
+        repetitions_(options->get<size_t>("repetitions")),
+        filter_(options->get<std::string>("filter")) {
+    ABORT_IF(repetitions_ == 0, "--repetitions must be at least 1");
+    backend_ = BackendByDeviceId(DeviceId(0, DeviceType::cpu), options->get<size_t>("seed"));
+    allocator_ = New<TensorAllocator>(backend_);
+    allocator_->reserveExact(options->get<size_t>("workspace") * 1024 * 1024);
+  }
+
+  // Tensor filled with uniformly distributed values from [-1, 1)
+  Tensor uniform(Shape shape) {
+    Tensor t;
+    allocator_->allocate(t, shape, Type::float32);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    std::vector<float> values(shape.elements());
+    for(auto& v : values)
+      v = dist(engine_);
+    t->set(values);
+    return t;
+  }
+
+  // Index tensor with values from [0, range)
+  Tensor indices(Shape shape, size_t range) {
+    Tensor t;
+    allocator_->allocate(t, shape, Type::uint32);
+    std::uniform_int_distribution<IndexType> dist(0, (IndexType)range - 1);
+    std::vector<IndexType> values(shape.elements());
+    for(auto& v : values)
+      v = dist(engine_);
+    t->set(values);
+    return t;
+  }
+
+  Tensor empty(Shape shape, Type type = Type::float32) {
+    Tensor t;
+    allocator_->allocate(t, shape, type);
+    return t;
+  }
+
+  Ptr<Allocator> allocator() { return allocator_->allocator(); }
+
+  bool enabled(const std::string& name) const { return regex::regex_search(name, filter_); }
+
+  // Times op after warmup_ untimed calls. Tensors are allocated by the caller before, so that
+  // nothing but the operator itself is measured.
+  void run(const std::string& name, const std::string& shape, double flops, const std::function<void()>& op) {
+    if(!enabled(name))
+      return;
+
+    for(size_t i = 0; i < warmup_; ++i)
+      op();
+    backend_->synchronize();
+
+    Result result{name, shape, flops, {}};
+    for(size_t i = 0; i < repetitions_; ++i) {
+      timer::Timer timer;
+      op();
+      backend_->synchronize();
+      result.times.push_back(timer.elapsed<std::chrono::microseconds>() / 1000.0);
+    }
+
+    LOG(info,
+        "{:<32} {:<28} median {:9.3f} ms, min {:9.3f} ms{}",
+        name, shape, percentile(result.times, 0.5), percentile(result.times, 0.0),
+        flops > 0 ? fmt::format(", {:8.2f} GFLOP/s", flops / (percentile(result.times, 0.5) * 1e6)) : "");
+    results_.push_back(result);
+  }
+
+  void writeJson(std::ostream& out) const {
+    out << "{\n";
+    out << fmt::format("  \"version\": \"{}\",\n", buildVersion());
+    out << fmt::format("  \"date\": \"{}\",\n", timer::currentDate());
+    out << fmt::format("  \"warmup\": {},\n", warmup_);
+    out << fmt::format("  \"repetitions\": {},\n", repetitions_);
+    out << "  \"results\": [";
+    for(size_t i = 0; i < results_.size(); ++i) {
+      const auto& r = results_[i];
+      double mean = std::accumulate(r.times.begin(), r.times.end(), 0.0) / r.times.size();
+      double var = 0;
+      for(auto t : r.times)
+        var += (t - mean) * (t - mean);
+      double median = percentile(r.times, 0.5);
+
+      out << (i > 0 ? ",\n" : "\n");
+      out << "    {";
+      out << fmt::format("\"name\": \"{}\", \"shape\": \"{}\", ", r.name, r.shape);
+      out << fmt::format("\"mean_ms\": {:.6f}, \"median_ms\": {:.6f}, \"p90_ms\": {:.6f}, ",
+                         mean, median, percentile(r.times, 0.9));
+      out << fmt::format("\"min_ms\": {:.6f}, \"max_ms\": {:.6f}, \"stddev_ms\": {:.6f}",
+                         percentile(r.times, 0.0), percentile(r.times, 1.0), std::sqrt(var / r.times.size()));
+      if(r.flops > 0)
+        out << fmt::format(", \"gflops\": {:.3f}", r.flops / (median * 1e6));
+      out << "}";
+    }
+    out << "\n  ]\n}\n";
+  }
+};
+
+}  // namespace marian
+
+int main(int argc, char** argv) {
+  using namespace marian;
+  using namespace functional;
+
+  createLoggers();
+
+  auto options = New<Options>();
+  {
+    YAML::Node config;
+    auto cli = New<cli::CLIWrapper>(
+        config,
+        "Benchmark single CPU operators on shapes of a transformer model",
+        "Allowed options",
+        "Examples:\n"
+        "  ./marian-bench --output bench.json\n"
+        "  ./marian-bench --filter 'prod|softmax' --repetitions 100 --batch 32");
+    cli->add<size_t>("--warmup", "Number of untimed calls of every operator before measuring", 5);
+    cli->add<size_t>("--repetitions", "Number of timed calls of every operator", 20);
+    cli->add<std::string>("--filter", "Only run benchmarks whose name matches this regular expression", ".*");
+    cli->add<std::string>("--output,-o", "Write the results as JSON to this file, '-' for stdout");
+    cli->add<size_t>("--seed", "Seed for the random input values", 1234);
+    cli->add<size_t>("--workspace", "Memory preallocated for the operands in MB", 1024);
+    cli->add<int>("--dim-model", "Model dimension", 512);
+    cli->add<int>("--dim-ffn", "Dimension of the feed-forward layers", 2048);
+    cli->add<int>("--dim-vocab", "Size of the output vocabulary", 32000);
+    cli->add<int>("--heads", "Number of attention heads", 8);
+    cli->add<int>("--batch", "Number of sentences in a batch", 16);
+    cli->add<int>("--length", "Number of tokens per sentence", 32);
+    cli->add<int>("--beam-size", "Beam size for top-k over the output vocabulary", 4);
+    cli->parse(argc, argv);
+    options->merge(config);
+  }
+
+  int dimModel = options->get<int>("dim-model");
+  int dimFfn   = options->get<int>("dim-ffn");
+  int dimVocab = options->get<int>("dim-vocab");
+  int heads    = options->get<int>("heads");
+  int batch    = options->get<int>("batch");
+  int length   = options->get<int>("length");
+  int beamSize = options->get<int>("beam-size");
+  int tokens   = batch * length;
+
+  ABORT_IF(dimModel % heads != 0, "--dim-model must be divisible by --heads");
+  int dimHead = dimModel / heads;
+
+  LOG(info, "[bench] {} tokens ({} x {}), dim-model {}, dim-ffn {}, dim-vocab {}, {} heads",
+      tokens, batch, length, dimModel, dimFfn, dimVocab, heads);
+
+  OperatorBenchmark bench(options);
+
+  auto shapeStr = [](const std::vector<marian::Shape>& shapes) {
+    std::vector<std::string> parts;
+    for(const auto& s : shapes) {
+      std::vector<std::string> dims;
+      for(int i = 0; i < s.size(); ++i)
+        dims.push_back(std::to_string(s[i]));
+      parts.push_back(utils::join(dims, "x"));
+    }
+    return utils::join(parts, " ");
+  };
+
+  // float32 matrix products: feed-forward layers and output layer
+  struct Gemm { std::string name; int m, k, n; };
+  std::vector<Gemm> gemms = {{"ffn1", tokens, dimModel, dimFfn},
+                             {"ffn2", tokens, dimFfn, dimModel},
+                             {"output", batch * beamSize, dimModel, dimVocab}};
+
+  for(const auto& g : gemms) {
+    double flops = 2.0 * g.m * g.k * g.n;
+    auto A = bench.uniform({g.m, g.k});
+    auto B = bench.uniform({g.k, g.n});
+    auto Bt = bench.uniform({g.n, g.k});
+    auto C = bench.empty({g.m, g.n});
+
+    bench.run("prod/" + g.name, shapeStr({A->shape(), B->shape()}), flops, [&]() {
+      Prod(C, A, B, false, false, 0.f, 1.f);
+    });
+    bench.run("prod/" + g.name + "-transB", shapeStr({A->shape(), Bt->shape()}), flops, [&]() {
+      Prod(C, A, Bt, false, true, 0.f, 1.f);
+    });
+
+    // int16 sharp kernels, both operands are quantized, B is stored transposed
+    auto Aq = bench.empty(A->shape(), Type::int16);
+    auto Bq = bench.empty(Bt->shape(), Type::int16);
+    cpu::int16::Quantize16(Bq, Bt, 0.f);
+    bench.run("int16/" + g.name, shapeStr({A->shape(), Bt->shape()}), flops, [&]() {
+      cpu::int16::Quantize16(Aq, A, 0.f);
+      cpu::int16::ProdInt16(C, Aq, Bq, 1.f);
+    });
+
+#ifdef __AVX512F__
+    // int8 sharp kernels are only compiled for AVX512
+    auto Aq8 = bench.empty(A->shape(), Type::int8);
+    auto Bq8 = bench.empty(Bt->shape(), Type::int8);
+    cpu::int16::Quantize8(Bq8, Bt, 0.f);
+    bench.run("int8/" + g.name, shapeStr({A->shape(), Bt->shape()}), flops, [&]() {
+      cpu::int16::Quantize8(Aq8, A, 0.f);
+      cpu::int16::ProdInt8(C, Aq8, Bq8, 1.f, 0.f);
+    });
+#endif
+
+    // int8 with weights prepared offline as done by marian-conv --gemm-type intgemm8
+    std::vector<float> dataB;
+    B->get(dataB);
+    auto Bp = bench.empty(B->shape(), Type::intgemm8);
+    cpu::int16::PrepareInt8(Bp, dataB.data(), B->shape(), /*transpose=*/false);
+    bench.run("intgemm8/" + g.name, shapeStr({A->shape(), B->shape()}), flops, [&]() {
+      cpu::int16::ProdPreparedInt8(C, A, Bp, nullptr, 1.f);
+    });
+
+#if USE_FBGEMM
+    if(fbgemm::fbgemmHasAvx2Support()) {
+      using namespace cpu::variant;
+
+      int nrow, ncol, kernelNcolBlocks, brow, bcol, lastBrow, nbrow, nbcol;
+      uint64_t packsize;
+      fbgemmPacked16PackInfo(B->shape(), false, nrow, ncol, kernelNcolBlocks, brow, bcol, lastBrow, nbrow, nbcol, packsize);
+      auto B16 = bench.empty({1, (int)packsize}, Type::uint8);
+      fbgemmPacked16Pack(B16, dataB.data(), false, nrow, ncol, kernelNcolBlocks, brow, bcol, lastBrow, nbrow, nbcol, packsize);
+      bench.run("packed16/" + g.name, shapeStr({A->shape(), B->shape()}), flops, [&]() {
+        fbgemmPacked16Gemm(C, A, B16, nullptr, g.m, g.n);
+      });
+
+      Type packType = fbgemm::fbgemmHasAvx512Support() ? Type::packed8avx512 : Type::packed8avx2;
+      fbgemmPacked8PackInfo(B->shape(), packType, false, nrow, ncol, packsize);
+      auto B8 = bench.empty({1, (int)packsize}, Type::uint8);
+      fbgemmPacked8Pack(B8, dataB.data(), packType, false, nrow, ncol, packsize);
+      bench.run("packed8/" + g.name, shapeStr({A->shape(), B->shape()}), flops, [&]() {
+        fbgemmPacked8Gemm(C, A, B8, g.m, g.n, g.k);
+      });
+    }
+#endif
+  }
+
+  // batched products of self-attention: scores Q * K^T and context softmax(scores) * V
+  {
+    int dimBatch = batch * heads;
+    auto Q = bench.uniform({dimBatch, length, dimHead});
+    auto K = bench.uniform({dimBatch, length, dimHead});
+    auto S = bench.empty({dimBatch, length, length});
+    auto O = bench.empty({dimBatch, length, dimHead});
+    double flops = 2.0 * dimBatch * length * length * dimHead;
+
+    bench.run("prod-batched/attention-scores", shapeStr({Q->shape(), K->shape()}), flops, [&]() {
+      ProdBatched(S, bench.allocator(), Q, K, false, true, 0.f, 1.f);
+    });
+    bench.run("prod-batched/attention-context", shapeStr({S->shape(), K->shape()}), flops, [&]() {
+      ProdBatched(O, bench.allocator(), S, K, false, false, 0.f, 1.f);
+    });
+
+    bench.run("softmax/attention", shapeStr({S->shape()}), 0, [&]() { Softmax(S, S); });
+
+    // split and join heads
+    auto X = bench.uniform({batch, length, heads, dimHead});
+    auto Y = bench.empty({batch, heads, length, dimHead});
+    bench.run("transpose/heads", shapeStr({X->shape()}), 0, [&]() {
+      TransposeND(Y, X, {0, 2, 1, 3});
+    });
+  }
+
+  // normalization and element-wise kernels on the hidden states
+  {
+    auto X = bench.uniform({tokens, dimModel});
+    auto R = bench.uniform({tokens, dimModel});
+    auto Y = bench.empty({tokens, dimModel});
+    auto gamma = bench.uniform({1, dimModel});
+    auto beta = bench.uniform({1, dimModel});
+
+    bench.run("layer-norm", shapeStr({X->shape()}), 0, [&]() {
+      LayerNormalization(Y, X, gamma, beta, 1e-9f);
+    });
+    bench.run("element/add", shapeStr({X->shape(), R->shape()}), 0, [&]() {
+      Element(_1 = _2 + _3, Y, X, R);
+    });
+    bench.run("element/add-bias", shapeStr({X->shape(), beta->shape()}), 0, [&]() {
+      Element(_1 = _2 + _3, Y, X, beta);
+    });
+
+    auto H = bench.uniform({tokens, dimFfn});
+    auto G = bench.empty({tokens, dimFfn});
+    bench.run("element/relu", shapeStr({H->shape()}), 0, [&]() {
+      Element(_1 = ReLU(_2), G, H);
+    });
+    bench.run("element/swish", shapeStr({H->shape()}), 0, [&]() {
+      Element(_1 = _2 * sigmoid(_2), G, H);
+    });
+  }
+
+  // output layer: normalization over the vocabulary and beam search top-k
+  {
+    int rows = batch * beamSize;
+    auto L = bench.uniform({rows, dimVocab});
+    auto P = bench.empty({rows, dimVocab});
+    bench.run("softmax/output", shapeStr({L->shape()}), 0, [&]() { Softmax(P, L); });
+    bench.run("logsoftmax/output", shapeStr({L->shape()}), 0, [&]() { LogSoftmax(P, L); });
+
+    auto topVal = bench.empty({rows, beamSize});
+    auto topIdx = bench.empty({rows, beamSize}, Type::uint32);
+    bench.run("topk/output", shapeStr({L->shape()}), 0, [&]() {
+      TopK(topVal, topIdx, bench.allocator(), L, beamSize, (int)L->shape().size() - 1, true);
+    });
+  }
+
+  // embedding lookup and reordering of decoder states between beam search steps
+  {
+    auto E = bench.uniform({dimVocab, dimModel});
+    auto ids = bench.indices({tokens}, dimVocab);
+    auto Y = bench.empty({tokens, dimModel});
+    bench.run("rows/embedding", shapeStr({E->shape(), ids->shape()}), 0, [&]() {
+      CopyRows(Y, E, ids);
+    });
+
+    int rows = batch * beamSize;
+    auto S = bench.uniform({rows, length, dimModel});
+    // Select() gathers with indices broadcast to the output shape, one hypothesis per row
+    auto hyps = bench.indices({rows, 1, 1}, rows);
+    auto Z = bench.empty({rows, length, dimModel});
+    bench.run("index-select/beam", shapeStr({S->shape(), hyps->shape()}), 0, [&]() {
+      marian::Select(Z, S, hyps, 0);
+    });
+  }
+
+  auto output = options->get<std::string>("output");
+  if(output == "-") {
+    bench.writeJson(std::cout);
+  } else if(!output.empty()) {
+    io::OutputFileStream out(output);
+    bench.writeJson(out);
+    LOG(info, "[bench] Results written to {}", output);
+  }
+
+  return 0;
+}
@@ -0,0 +1,26 @@
+#include "marian.h"
+
+#include "common/config.h"
+#include "common/logging.h"
+#include "data/corpus_binary.h"
+
+// Encodes training corpora once into the memory-mappable format read by --binary-corpus. Takes the
+// same data options as marian training, e.g.:
+//   ./marian-binarize -t corpus.src corpus.trg -v vocab.spm vocab.spm --binary-corpus corpus.bin
+int main(int argc, char** argv) {
+  using namespace marian;
+
+  // training options without the checks for a model, only the data options are used
+  auto options = parseOptions(argc, argv, cli::mode::training, /*validate=*/false);
+
+  ABORT_IF(options->get<std::vector<std::string>>("train-sets").empty(),
+           "No training corpora given with --train-sets");
+  ABORT_IF(!options->hasAndNotEmpty("binary-corpus"),
+           "No output file given with --binary-corpus");
+
+  data::CorpusBinary::create(options);
+
+  LOG(info, "Finished");
+
+  return 0;
+}
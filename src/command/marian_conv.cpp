@@ -5,7 +5,10 @@
 #include <sstream>
 
 #include "tensors/cpu/fbgemm/expression_graph_packable.h"
+#include "tensors/cpu/fbgemm/quantization_calibrator.h"
 #include "onnx/expression_graph_onnx_exporter.h"
+#include "models/model_factory.h"
+#include "layers/lsh.h"
 
 int main(int argc, char** argv) {
   using namespace marian;
@@ -20,12 +23,29 @@ int main(int argc, char** argv) {
         "Convert a model in the .npz format and normal memory layout to a mmap-able binary model which could be in normal memory layout or packed memory layout",
         "Allowed options",
         "Examples:\n"
-        "  ./marian-conv -f model.npz -t model.bin --gemm-type packed16");
+        "  ./marian-conv -f model.npz -t model.bin --gemm-type packed16\n"
+        "  ./marian-conv -f model.npz -t model.bin --gemm-type packed8avx512 -V vocab.src.spm vocab.trg.spm --calibration-data sample.src sample.trg\n"
+        "  ./marian-conv -f model.npz -t model.bin --gemm-type intgemm8\n"
+        "  ./marian-conv -f model.npz -t model.bin --gemm-type intgemm8 --embedding-type int8\n"
+        "  ./marian-conv -f model.npz -t model.bin --output-approx-knn-bits 1024");
     cli->add<std::string>("--from,-f", "Input model", "model.npz");
     cli->add<std::string>("--to,-t", "Output model", "model.bin");
     cli->add<std::string>("--export-as", "Kind of conversion: marian-bin or onnx-{encode,decoder-step,decoder-init,decoder-stop}", "marian-bin");
-    cli->add<std::string>("--gemm-type,-g", "GEMM Type to be used: float32, packed16, packed8avx2, packed8avx512", "float32");
-    cli->add<std::vector<std::string>>("--vocabs,-V", "Vocabulary file, required for ONNX export");
+    cli->add<std::string>("--gemm-type,-g", "GEMM Type to be used: float32, packed16, packed8avx2, packed8avx512, intgemm8", "float32");
+    cli->add<std::string>("--embedding-type",
+        "Storage type of the embedding matrices: float32, int8 (one scale per row, dequantized during lookup)", "float32");
+    cli->add<std::vector<std::string>>("--vocabs,-V", "Vocabulary file, required for ONNX export and calibration");
+    cli->add<std::vector<std::string>>("--calibration-data",
+        "Parallel corpus (source and target files) used to compute static quantization ranges of the activations "
+        "for packed8 and intgemm8 GEMM types. Requires --vocabs");
+    cli->add<std::string>("--calibration-method",
+        "Method to choose the clipping threshold of activations: max, percentile, kl", "kl");
+    cli->add<float>("--calibration-percentile",
+        "Percentile of absolute activation values used as threshold with --calibration-method percentile", 99.99f);
+    cli->add<int>("--calibration-mini-batch", "Size of mini-batches used for calibration", 32);
+    cli->add<int>("--output-approx-knn-bits",
+        "Precompute the LSH index of the output layer with this many bits and store it in the model. "
+        "Used by --output-approx-knn with the same number of bits instead of building the index at load time", 0);
     cli->parse(argc, argv);
     options->merge(config);
   }
@@ -45,11 +65,23 @@ int main(int argc, char** argv) {
     saveGemmType = Type::packed8avx2;
   } else if(saveGemmTypeStr == "packed8avx512") { // packed8 for AVX512
     saveGemmType = Type::packed8avx512;
+  } else if(saveGemmTypeStr == "intgemm8") { // int8 with runtime selection of AVX512-VNNI, AVX512BW or reference kernels
+    saveGemmType = Type::intgemm8;
   } else {
     ABORT("Unknown gemm-type: {}", saveGemmTypeStr);
   }
 
-  LOG(info, "Outputting {}, precision: {}", modelTo, saveGemmType);
+  auto embeddingTypeStr = options->get<std::string>("embedding-type", "float32");
+  Type embeddingType;
+  if(embeddingTypeStr == "float32") {
+    embeddingType = Type::float32;
+  } else if(embeddingTypeStr == "int8") { // int8 with one float scale per row
+    embeddingType = Type::rowquant8;
+  } else {
+    ABORT("Unknown embedding-type: {}", embeddingTypeStr);
+  }
+
+  LOG(info, "Outputting {}, precision: {}, embeddings: {}", modelTo, saveGemmType, embeddingType);
 
   YAML::Node config;
   std::stringstream configStr;
@@ -64,11 +96,93 @@ int main(int argc, char** argv) {
     graph->forward();  // run the initializers
   };
 
+  // Run the calibration corpus through the float model with teacher forcing and collect the inputs of every
+  // GEMM with a packable weight. The ranges derived from the histograms are saved with the packed weights.
+  auto calibrate = [&](Ptr<ExpressionGraphPackable> graph) -> Ptr<cpu::variant::QuantizationCalibrator> {
+    auto calibrationData = options->get<std::vector<std::string>>("calibration-data");
+    if(calibrationData.empty())
+      return nullptr;
+
+    ABORT_IF(saveGemmType != Type::packed8avx2 && saveGemmType != Type::packed8avx512 && saveGemmType != Type::intgemm8,
+             "--calibration-data is only supported with --gemm-type packed8avx2, packed8avx512 or intgemm8");
+    ABORT_IF(calibrationData.size() != vocabPaths.size(),
+             "Number of calibration files ({}) and vocab files ({}) does not agree",
+             calibrationData.size(), vocabPaths.size());
+
+    auto calibrationOptions = New<Options>(config)->with(
+        "inference", true,
+        "cost-type", "ce-sum",
+        "max-length", (size_t)1000,
+        "max-length-crop", true,
+        "right-left", config["right-left"] && config["right-left"].as<bool>(),
+        "mini-batch", options->get<int>("calibration-mini-batch"),
+        "maxi-batch", 1,
+        "maxi-batch-sort", "none",
+        "shuffle", "none");
+
+    std::vector<Ptr<Vocab>> vocabs;
+    for(size_t i = 0; i < vocabPaths.size(); ++i) {
+      vocabs.emplace_back(New<Vocab>(calibrationOptions, i));
+      vocabs.back()->load(vocabPaths[i]);
+    }
+
+    auto calibrator = New<cpu::variant::QuantizationCalibrator>(
+        cpu::variant::calibrationMethodFromString(options->get<std::string>("calibration-method")),
+        options->get<float>("calibration-percentile"));
+
+    auto corpus = New<data::Corpus>(calibrationData, vocabs, calibrationOptions);
+    auto batchGenerator = New<data::BatchGenerator<data::Corpus>>(corpus, calibrationOptions);
+    batchGenerator->prepare();
+
+    auto builder = models::createCriterionFunctionFromOptions(calibrationOptions, models::usage::scoring);
+
+    // build in training mode to keep the executed nodes on the backward tape for inspection
+    graph->setInference(false);
+    size_t sentences = 0;
+    for(auto batch : *batchGenerator) {
+      builder->build(graph, batch);
+      graph->forward();
+      graph->collectActivationStats(*calibrator);
+      sentences += batch->size();
+    }
+    graph->clear();
+    graph->setInference(true);
+
+    LOG(info, "Calibrated {} GEMM inputs on {} sentences using method {}",
+        calibrator->size(), sentences, options->get<std::string>("calibration-method"));
+    return calibrator;
+  };
+
+  // LSH codes (and rotation) of the output matrix, computed from the float values before packing
+  auto lshIndex = [&](Ptr<ExpressionGraph> graph) -> std::vector<io::Item> {
+    int nbits = options->get<int>("output-approx-knn-bits");
+    if(nbits <= 0)
+      return {};
+
+    // output matrix of models with untied, tied and all tied embeddings
+    std::string name;
+    for(auto candidate : {"decoder_ff_logit_out_Wt", "decoder_Wemb", "Wemb"}) {
+      if(graph->get(candidate)) {
+        name = candidate;
+        break;
+      }
+    }
+    ABORT_IF(name.empty(), "--output-approx-knn-bits requires a model with a transposed output layer");
+
+    auto W = graph->get(name);
+    std::vector<float> values;
+    W->val()->get(values);
+    LOG(info, "Computing LSH index for {} with {} bits", name, nbits);
+    return lsh::indexItems(name, values, W->shape()[-1], nbits);
+  };
+
   if (exportAs == "marian-bin") {
     auto graph = New<ExpressionGraphPackable>();
     load(graph);
+    auto calibrator = calibrate(graph);
+    auto lshItems = lshIndex(graph);
     // added a flag if the weights needs to be packed or not
-    graph->packAndSave(modelTo, configStr.str(), /* --gemm-type */ saveGemmType, Type::float32);
+    graph->packAndSave(modelTo, configStr.str(), /* --gemm-type */ saveGemmType, Type::float32, calibrator, /* --embedding-type */ embeddingType, lshItems);
   }
   else if (exportAs == "onnx-encode") {
 #ifdef USE_ONNX
@@ -1,5 +1,6 @@
 #include "marian.h"
 #include "translator/beam_search.h"
+#include "translator/greedy_search.h"
 #include "translator/translator.h"
 #include "common/timer.h"
 #ifdef _WIN32
@@ -9,7 +10,13 @@
 int main(int argc, char** argv) {
   using namespace marian;
   auto options = parseOptions(argc, argv, cli::mode::translation);
-  auto task = New<Translate<BeamSearch>>(options);
+  Ptr<ModelTask> task;
+  if(GreedySearch::isApplicable(options)) {
+    LOG(info, "[translate] Using greedy search for beam size 1");
+    task = New<Translate<GreedySearch>>(options);
+  } else {
+    task = New<Translate<BeamSearch>>(options);
+  }
 
   timer::Timer timer;
   task->run();
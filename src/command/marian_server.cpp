@@ -1,7 +1,9 @@
 #include "marian.h"
 #include "translator/beam_search.h"
+#include "translator/greedy_search.h"
 #include "translator/translator.h"
 #include "common/timer.h"
+#include "common/filesystem.h"
 #include "common/utils.h"
 
 #include "3rd_party/simple-websocket-server/server_ws.hpp"
@@ -13,7 +15,11 @@ int main(int argc, char **argv) {
 
   // Initialize translation task
   auto options = parseOptions(argc, argv, cli::mode::server, true);
-  auto task = New<TranslateService<BeamSearch>>(options);
+  Ptr<ModelServiceTask> task;
+  if(GreedySearch::isApplicable(options))
+    task = New<TranslateService<GreedySearch>>(options);
+  else
+    task = New<TranslateService<BeamSearch>>(options);
   auto quiet = options->get<bool>("quiet-translation");
 
   // Initialize web server
@@ -42,6 +48,53 @@ int main(int argc, char **argv) {
     });
   };
 
+  // Operational metrics in the Prometheus text format, sent back for any message
+  auto &metrics = server.endpoint["^/metrics/?$"];
+
+  metrics.on_message = [&task](Ptr<WSServer::Connection> connection,
+                               Ptr<WSServer::InMessage> /*message*/) {
+    auto sendStream = std::make_shared<WSServer::OutMessage>();
+    *sendStream << task->metrics();
+    connection->send(sendStream, [](const SimpleWeb::error_code &ec) {
+      if(ec)
+        LOG(error, "Error sending message: ({}) {}", ec.value(), ec.message());
+    });
+  };
+
+  // Hot reload: loads the model files listed in the message (the current ones if empty) next to
+  // the models in use and switches to them when ready, requests in flight finish on the old ones
+  auto &reload = server.endpoint["^/reload/?$"];
+
+  reload.on_message = [&task](Ptr<WSServer::Connection> connection,
+                              Ptr<WSServer::InMessage> message) {
+    auto send = [connection](const std::string& text) {
+      auto sendStream = std::make_shared<WSServer::OutMessage>();
+      *sendStream << text << std::endl;
+      connection->send(sendStream, [](const SimpleWeb::error_code &ec) {
+        if(ec)
+          LOG(error, "Error sending message: ({}) {}", ec.value(), ec.message());
+      });
+    };
+
+    auto models = utils::split(message->string(), " \t\r\n", /*keepEmpty=*/false, /*anyOf=*/true);
+    for(const auto& model : models) {
+      if(!filesystem::exists(model)) {
+        send("Error: model file " + model + " does not exist");
+        return;
+      }
+    }
+
+    // loading takes a while, do not block the server thread
+    auto service = task;
+    std::thread([service, models, send]() {
+      timer::Timer timer;
+      if(service->reload(models))
+        send("Reloaded in " + std::to_string(timer.elapsed()) + "s");
+      else
+        send("Error: reloading is not supported");
+    }).detach();
+  };
+
   // Error Codes for error code meanings
   // http://www.boost.org/doc/libs/1_55_0/doc/html/boost_asio/reference.html
   translate.on_error = [](Ptr<WSServer::Connection> /*connection*/,
@@ -22,6 +22,11 @@ io::Item getItem(const std::string& fileName, const std::string& vName);
 
 void saveItems(const std::string& fileName, const std::vector<io::Item>& items);
 
+// Serializes items into buffer in the same format and returns the number of bytes.
+// If buffer is nullptr, only the required size is returned. The buffer should be
+// 256-byte aligned for the item data to be aligned, e.g. for memory-mapping.
+size_t saveItems(char* buffer, const std::vector<io::Item>& items);
+
 }  // namespace binary
 }  // namespace io
 }  // namespace marian
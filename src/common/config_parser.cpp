@@ -45,6 +45,9 @@ const std::set<std::string> PATHS = {
   "data-weighting",
   "log",
   "sqlite",           // except: 'temporary', handled in the processPaths function
+  "binary-corpus",
+  "autotune-gemm-cache",
+  "warmup-input",
   "shortlist",        // except: only the first element in the sequence is a path, handled in the
                       //  processPaths function
 };
@@ -161,6 +164,16 @@ void ConfigParser::addOptionsServer(cli::CLIWrapper& cli) {
   cli.add<size_t>("--port,-p",
       "Port number for web socket server",
       8080);
+  cli.add<size_t>("--cache-size",
+      "Keep translations of this many source sentences in an LRU cache to answer repeated requests, 0 to disable",
+      0);
+  cli.add<bool>("--warmup",
+      "Before listening, translate sample inputs with every worker to have workspaces and model caches ready");
+  cli.add<std::string>("--warmup-input",
+      "Sentences to use for --warmup instead of generated ones of several lengths");
+  cli.add<size_t>("--metrics-log-freq",
+      "Log the metrics served at /metrics every arg requests, 0 to disable",
+      0);
   cli.switchGroup(previous_group);
   // clang-format on
 }
@@ -424,6 +437,9 @@ void ConfigParser::addOptionsTraining(cli::CLIWrapper& cli) {
     ->implicit_val("temporary");
   cli.add<bool>("--sqlite-drop",
       "Drop existing tables in sqlite3 database");
+  cli.add<std::string>("--binary-corpus",
+      "Read training data from this memory-mapped file of pre-encoded word ids, "
+      "created from --train-sets with marian-binarize or on first use if it does not exist");
 
   addSuboptionsDevices(cli);
   addSuboptionsBatching(cli);
@@ -652,6 +668,20 @@ void ConfigParser::addOptionsTranslation(cli::CLIWrapper& cli) {
       3);
   cli.add<float>("--word-penalty",
       "Subtract (arg * translation length) from translation score");
+  cli.add<float>("--beam-prune-relative",
+      "Prune hypotheses with a probability below arg times the probability of the best hypothesis in the beam. "
+      "0 to disable",
+      0);
+  cli.add<float>("--beam-prune-absolute",
+      "Prune hypotheses with a score more than arg below the score of the best hypothesis in the beam. "
+      "0 to disable",
+      0);
+  cli.add<size_t>("--beam-max-candidates-per-node",
+      "Keep at most arg hypotheses in the beam that expand the same previous hypothesis. 0 to disable",
+      0);
+  cli.add<bool>("--early-stop",
+      "Stop searching a sentence once no unfinished hypothesis can outscore the best finished one "
+      "under the length normalization and word penalty in use. May return fewer than beam-size n-best entries");
   cli.add<bool>("--allow-unk",
       "Allow unknown words to appear in output");
   cli.add<bool>("--n-best",
@@ -673,6 +703,18 @@ void ConfigParser::addOptionsTranslation(cli::CLIWrapper& cli) {
 
   cli.add<bool>("--optimize",
       "Optimize speed aggressively sacrificing memory or precision");
+  cli.add<bool>("--autotune-gemm",
+      "On CPU, time float, int16 and packed GEMM per matrix shape and use the fastest one");
+  cli.add<std::string>("--autotune-gemm-cache",
+      "Load --autotune-gemm decisions from and save new ones to this file");
+  cli.add<bool>("--shared-params",
+      "Share one read-only copy of the model parameters between all CPU threads and ensemble members loading the same file");
+  cli.add<std::string>("--cpu-affinity",
+      "Placement of CPU threads: none, core (pin each to one core) or numa (pin each to the cores of a NUMA node). "
+      "Threads are spread evenly over the NUMA nodes and --shared-params keeps one copy per node",
+      "none");
+  cli.add<bool>("--static-memory-planning",
+      "Place the tensors of each decoding step at precomputed offsets of one allocation to reduce peak workspace memory");
   cli.add<bool>("--skip-cost",
       "Ignore model cost during translation, not recommended for beam-size > 1");
   cli.add<bool>("--fp16",
@@ -688,9 +730,26 @@ void ConfigParser::addOptionsTranslation(cli::CLIWrapper& cli) {
   cli.add<bool>("--output-sampling",
      "Noise output layer with gumbel noise",
       false);
+  cli.add<size_t>("--output-sampling-top-k",
+     "With --output-sampling and beam size 1: sample from the arg most probable words only, 0 for all",
+      0);
+  cli.add<float>("--output-sampling-top-p",
+     "With --output-sampling and beam size 1: sample from the smallest set of most probable words "
+     "with a total probability of at least arg (nucleus sampling)",
+      1.f);
+  cli.add<float>("--output-sampling-temperature",
+     "With --output-sampling and beam size 1: divide log probabilities by arg before sampling",
+      1.f);
   cli.add<std::vector<int>>("--output-approx-knn",
      "Use approximate knn search in output layer (currently only in transformer)")
      ->implicit_val("100 1024");
+  cli.add<bool>("--benchmark",
+      "Report throughput, per-sentence latency percentiles, the time spent in encoder, decoder steps and "
+      "search bookkeeping, and the peak workspace after translating the input");
+  cli.add<float>("--benchmark-arrival-rate",
+      "With --benchmark, simulate input sentences arriving at arg sentences per second (Poisson process) "
+      "and measure latency from arrival. 0 makes the whole input available at the start",
+      0);
 
 #if 0 // @TODO: Ask Hany if there are any decoding-time options
   // add ULR settings
@@ -721,6 +780,9 @@ void ConfigParser::addOptionsScoring(cli::CLIWrapper& cli) {
       "Score n-best list instead of plain text corpus");
   cli.add<std::string>("--n-best-feature",
       "Feature name to be inserted into n-best list", "Score");
+  cli.add<bool>("--n-best-share-encoder",
+      "Encode each distinct source sentence in a batch only once and score all its candidates against the shared "
+      "encoder states. Most effective with --maxi-batch-sort none or src, which keep the candidates of a source together");
   cli.add<bool>("--normalize,-n",
       "Divide translation score by translation length");
   cli.add<std::string>("--summary",
@@ -836,6 +898,13 @@ void ConfigParser::addSuboptionsBatching(cli::CLIWrapper& cli) {
     cli.add<size_t>("--mini-batch-fit-step",
       "Step size for mini-batch-fit statistics",
       10);
+    cli.add<bool>("--mini-batch-fit-plan",
+      "Determine mini-batch-fit sizes from a shape-only memory plan of the training graph instead of trial runs");
+    cli.add<float>("--mini-batch-fit-plan-margin",
+      "Fraction of the workspace kept free with --mini-batch-fit-plan for memory the plan does not cover",
+      0.1f);
+    cli.add<bool>("--mini-batch-fit-cache",
+      "Save mini-batch-fit statistics to model.batch-stats.yml and reuse them when restarting with the same model, memory and length options");
     cli.add<bool>("--gradient-checkpointing",
       "Enable gradient-checkpointing to minimize memory usage");
   }
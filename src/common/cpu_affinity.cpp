@@ -0,0 +1,123 @@
+#include "common/cpu_affinity.h"
+#include "common/logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace marian {
+namespace affinity {
+
+namespace {
+
+#ifdef __linux__
+// parses a Linux CPU list such as "0-15,32-47"
+std::vector<int> parseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  std::istringstream ranges(list);
+  std::string range;
+  while(std::getline(ranges, range, ',')) {
+    if(range.empty() || range == "\n")
+      continue;
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for(int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+#endif
+
+std::vector<std::vector<int>> detectNumaNodes() {
+  std::vector<int> allowed;
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if(sched_getaffinity(0, sizeof(mask), &mask) == 0)
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if(CPU_ISSET(cpu, &mask))
+        allowed.push_back(cpu);
+
+  // node ids can have gaps, so all possible ones are probed
+  std::vector<std::vector<int>> nodes;
+  for(int node = 0; node < 1024; ++node) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if(!file)
+      continue;
+    std::string list;
+    std::getline(file, list);
+    std::vector<int> cpus;
+    for(int cpu : parseCpuList(list))
+      if(CPU_ISSET(cpu, &mask))
+        cpus.push_back(cpu);
+    if(!cpus.empty())
+      nodes.push_back(cpus);
+  }
+  if(!nodes.empty())
+    return nodes;
+#endif
+  if(allowed.empty())
+    for(int cpu = 0; cpu < (int)std::max(std::thread::hardware_concurrency(), 1u); ++cpu)
+      allowed.push_back(cpu);
+  return {allowed};
+}
+
+}  // namespace
+
+const std::vector<std::vector<int>>& numaNodes() {
+  static const std::vector<std::vector<int>> nodes = detectNumaNodes();
+  return nodes;
+}
+
+size_t nodeOfWorker(size_t workerId, size_t numWorkers, size_t numNodes) {
+  return workerId * numNodes / numWorkers;
+}
+
+size_t firstWorkerOnNode(size_t node, size_t numWorkers, size_t numNodes) {
+  // smallest workerId with workerId * numNodes >= node * numWorkers
+  return (node * numWorkers + numNodes - 1) / numNodes;
+}
+
+int numaNodeOf(const std::string& mode, size_t workerId, size_t numWorkers) {
+  if(mode.empty() || mode == "none")
+    return -1;
+  ABORT_IF(mode != "core" && mode != "numa", "Unknown CPU affinity '{}', expected none, core or numa", mode);
+  ABORT_IF(workerId >= numWorkers, "Worker {} out of {} workers", workerId, numWorkers);
+  return (int)nodeOfWorker(workerId, numWorkers, numaNodes().size());
+}
+
+int pinWorker(const std::string& mode, size_t workerId, size_t numWorkers) {
+  int node = numaNodeOf(mode, workerId, numWorkers);
+  if(node < 0)
+    return node;
+
+  const auto& cpus = numaNodes()[node];
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if(mode == "core") {
+    // position of the worker within the contiguous block of workers on its node
+    size_t firstWorker = firstWorkerOnNode(node, numWorkers, numaNodes().size());
+    CPU_SET(cpus[(workerId - firstWorker) % cpus.size()], &mask);
+  } else {
+    for(int cpu : cpus)
+      CPU_SET(cpu, &mask);
+  }
+  int rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+  if(rc != 0)
+    LOG(warn, "[cpu] Could not pin worker {} to NUMA node {}, error {}", workerId, node, rc);
+#else
+  (void)cpus;
+#endif
+  return node;
+}
+
+}  // namespace affinity
+}  // namespace marian
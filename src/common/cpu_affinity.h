@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace marian {
+namespace affinity {
+
+// Placement of CPU workers (--cpu-affinity). With "core" every worker is pinned to one core, with
+// "numa" to all cores of one NUMA node. In both cases the workers are spread evenly over the NUMA
+// nodes in contiguous blocks, i.e. with 2 nodes workers 0..N/2-1 run on the first one. Memory is
+// placed by first touch, so what a pinned worker allocates and writes first (its workspace, its
+// parameters or its per-node copy of shared parameters) ends up on its local node.
+//
+// Pinning is only implemented for Linux, elsewhere the workers are not pinned and all of them are
+// reported to run on node 0.
+
+// CPUs this process may run on grouped by NUMA node, a single group if the topology is not known
+const std::vector<std::vector<int>>& numaNodes();
+
+// Node of worker workerId when numWorkers workers are spread over numNodes nodes in contiguous blocks.
+// The blocks differ in size by at most one worker.
+size_t nodeOfWorker(size_t workerId, size_t numWorkers, size_t numNodes);
+
+// First worker of the block of the given node, i.e. the smallest workerId with nodeOfWorker() == node.
+// numWorkers if there are fewer workers than nodes and the node gets none.
+size_t firstWorkerOnNode(size_t node, size_t numWorkers, size_t numNodes);
+
+// NUMA node (index into numaNodes()) worker workerId out of numWorkers is placed on. -1 if mode is
+// "none" or empty.
+int numaNodeOf(const std::string& mode, size_t workerId, size_t numWorkers);
+
+// Pins the calling thread to the CPUs of the given worker according to mode ("none", "core" or
+// "numa") and returns its NUMA node as numaNodeOf()
+int pinWorker(const std::string& mode, size_t workerId, size_t numWorkers);
+
+}  // namespace affinity
+}  // namespace marian
@@ -105,6 +105,11 @@ namespace filesystem {
     return p.getImpl().size();
   }
 
+  // time of the last modification in seconds since the epoch
+  static inline time_t lastWriteTime(const Path& p) {
+    return p.getImpl().mtime();
+  }
+
   static inline bool isDirectory(const Path& p) {
     return p.getImpl().is_directory();
   }
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <string>
 
 namespace marian {
 namespace util {
@@ -17,5 +19,20 @@ inline void hash_combine(std::size_t& seed, T const& v) {
     seed ^= hasher(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
 }
 
+// 64-bit FNV-1a. Unlike std::hash the result does not depend on the compiler or standard library,
+// use it for hashes that are persisted.
+inline uint64_t hashFNV(const void* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+  auto bytes = (const unsigned char*)data;
+  for(size_t i = 0; i < size; ++i) {
+    seed ^= bytes[i];
+    seed *= 1099511628211ull;
+  }
+  return seed;
+}
+
+inline uint64_t hashFNV(const std::string& s, uint64_t seed = 14695981039346656037ull) {
+  return hashFNV(s.data(), s.size(), seed);
+}
+
 }
 }
\ No newline at end of file
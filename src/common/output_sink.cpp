@@ -0,0 +1,79 @@
+#include "common/output_sink.h"
+
+#include <vector>
+
+namespace marian {
+
+OutputSink::OutputSink(UPtr<std::ostream> strm, WriteCallback onWrite)
+    : strm_(std::move(strm)), onWrite_(onWrite) {
+  writer_ = std::thread([this]() { writeLoop(); });
+}
+
+OutputSink::~OutputSink() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  pushed_.notify_one();
+  writer_.join();
+}
+
+void OutputSink::push(long id, std::string&& text, std::string&& note) {
+  bool isNext;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.emplace(id, Entry{std::move(text), std::move(note)});
+    isNext = id == nextId_;
+  }
+  // later ids are picked up together with the next one, no need to wake up the writer
+  if(isNext)
+    pushed_.notify_one();
+}
+
+void OutputSink::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  written_.wait(lock, [this]() { return pending_.empty() && writtenId_ == nextId_; });
+}
+
+void OutputSink::writeLoop() {
+  std::vector<std::pair<long, Entry>> ready;
+  std::string buffer;
+  for(;;) {
+    bool caughtUp;
+    long collectedId;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      pushed_.wait(lock, [this]() { return stop_ || pending_.count(nextId_) > 0; });
+      for(auto it = pending_.find(nextId_); it != pending_.end(); it = pending_.find(nextId_)) {
+        ready.emplace_back(nextId_++, std::move(it->second));
+        pending_.erase(it);
+      }
+      if(ready.empty()) // stopped and nothing left that can be written
+        return;
+      caughtUp = pending_.count(nextId_) == 0;
+      collectedId = nextId_;
+    }
+
+    buffer.clear();
+    for(auto& entry : ready) {
+      if(onWrite_)
+        onWrite_(entry.first, entry.second.note);
+      buffer += entry.second.text;
+    }
+    ready.clear();
+
+    if(strm_) {
+      strm_->write(buffer.data(), buffer.size());
+      if(caughtUp)
+        *strm_ << std::flush;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      writtenId_ = collectedId;
+    }
+    written_.notify_all();
+  }
+}
+
+}  // namespace marian
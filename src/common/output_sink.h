@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common/definitions.h"
+
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace marian {
+
+// Writes pre-formatted outputs of worker threads in the order of their ids. Workers only move their
+// buffer into a reorder table under a short lock and return; a single writer thread collects the
+// entries that became contiguous, concatenates them and emits them with one write. The stream is
+// flushed whenever the writer has caught up with the workers, so interactive use still sees every
+// line immediately while large outputs are written in big blocks.
+//
+// Ids have to start at 0 and be contiguous, entries behind a missing id are never written.
+class OutputSink {
+public:
+  // Called on the writer thread for every entry in id order, with the note given to push(), e.g.
+  // to log outputs in order
+  typedef std::function<void(long id, const std::string& note)> WriteCallback;
+
+  // If strm is null nothing is written, but the callback is still called
+  OutputSink(UPtr<std::ostream> strm, WriteCallback onWrite = nullptr);
+  OutputSink(const OutputSink&) = delete;
+
+  // writes all contiguous entries that were pushed and stops the writer thread
+  ~OutputSink();
+
+  // Queues text (written as is, no newline is added) for the given id. Thread-safe.
+  void push(long id, std::string&& text, std::string&& note = std::string());
+
+  // Blocks until all entries pushed so far are written and the stream is flushed. Requires the
+  // pushed ids to be contiguous.
+  void flush();
+
+private:
+  struct Entry {
+    std::string text;
+    std::string note;
+  };
+
+  UPtr<std::ostream> strm_;
+  WriteCallback onWrite_;
+
+  std::mutex mutex_;
+  std::condition_variable pushed_;  // signals the writer that the next entry has arrived or to stop
+  std::condition_variable written_; // signals flush() that the writer has caught up
+  std::unordered_map<long, Entry> pending_;
+  long nextId_{0};     // next id to be collected by the writer
+  long writtenId_{0};  // all ids below have been written and flushed
+  bool stop_{false};
+
+  std::thread writer_;
+
+  void writeLoop();
+};
+
+}  // namespace marian
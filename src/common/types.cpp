@@ -1,5 +1,6 @@
 #include "common/types.h"
 #include "tensors/cpu/fbgemm/packed_gemm.h"
+#include "tensors/cpu/sharp/int_gemm.h"
 
 namespace marian {
 
@@ -8,6 +9,14 @@ namespace marian {
 // But for instance, for intransparent types like packed tensors, it cannot easily be inferred by
 // multiplying. All cases are handed here and can later be passed to allocators etc. 
 size_t requiredBytes(const Shape& shape, Type type) {
+  // prepared int8 matrices carry padding, per-column quantization multipliers and compensation terms
+  if (isIntgemm(type))
+    return cpu::int16::PreparedInt8Bytes(shape);
+
+  // row-quantized int8 matrices are followed by one float scale per row
+  if (isRowQuant(type))
+    return shape.elements() + (shape.elements() / shape[-1]) * sizeof(float);
+
 #if USE_FBGEMM
   if (isPacked(type)) {
     if (sizeOf(type) == 1) {
@@ -150,6 +150,16 @@ struct packed8avx512 {
   uint8_t x;
 };
 
+// small struct to enable templating based on types use for prepared int8 matrices. This is a memory holder.
+struct intgemm8 {
+  uint8_t x;
+};
+
+// small struct to enable templating based on types use for row-quantized int8 matrices. This is a memory holder.
+struct rowquant8 {
+  uint8_t x;
+};
+
 #ifndef __CUDACC__ // vectorized types not available from .cu files
 
 // @TODO: check what intrinsics are actually available.
@@ -222,6 +232,8 @@ enum class TypeClass : size_t {
   packed_type   = 0x0800, // special packed (CPU cache friendly) type class, used in FBGEMM, not meant to be used anywhere else
   avx2_type     = 0x1000, // processor-specific layout for avx2, currently used for FBGEMM only
   avx512_type   = 0x2000, // processor-specific layout for avx512, currently used for FBGEMM only
+  intgemm_type  = 0x4000, // prepared int8 layout for the sharp CPU GEMMs with runtime dispatch (AVX512-VNNI, AVX512BW, reference)
+  rowquant_type = 0x8000, // int8 matrix with one float scale per row, dequantized on the fly by row lookups (CPU only)
 
   size_mask     = 0x00FF,
   class_mask    = 0xFF00
@@ -255,6 +267,9 @@ enum class Type : size_t {
   packed8avx2   = TypeClass::packed_type + 1u + TypeClass::avx2_type,   // special type for FBGEMM with AVX2, not meant to be used anywhere else, not meant to be accessed invidually. Internal actual type (uint8) is meaningless.
   packed8avx512 = TypeClass::packed_type + 1u + TypeClass::avx512_type, // special type for FBGEMM with AVX512, not meant to be used anywhere else, not meant to be accessed invidually. Internal actual type (uint8) is meaningless.
 
+  intgemm8      = TypeClass::intgemm_type + 1u,                         // prepared int8 matrix for cpu::int16::ProdPreparedInt8, not meant to be accessed invidually. Internal actual type (uint8) is meaningless.
+  rowquant8     = TypeClass::rowquant_type + 1u,                        // int8 rows with per-row scales for embedding lookups, see cpu::QuantizeRows8. Internal actual type (uint8) is meaningless.
+
 };
 
 static inline size_t operator&(TypeClass typeClass, Type type) {
@@ -297,6 +312,14 @@ static inline bool isAvx512(Type type) {
   return (TypeClass::avx512_type & type) != 0;
 }
 
+static inline bool isIntgemm(Type type) {
+  return (TypeClass::intgemm_type & type) != 0;
+}
+
+static inline bool isRowQuant(Type type) {
+  return (TypeClass::rowquant_type & type) != 0;
+}
+
 size_t requiredBytes(const Shape& shape, Type type); // towards Frank's vision of joint Shape/Type
 
 template <typename T>
@@ -321,6 +344,8 @@ template <> inline bool matchType<double>(Type type)   { return type == Type::fl
 template <> inline bool matchType<packed16>(Type type)       { return type == Type::packed16;       }
 template <> inline bool matchType<packed8avx2>(Type type)    { return type == Type::packed8avx2;    }
 template <> inline bool matchType<packed8avx512>(Type type)  { return type == Type::packed8avx512;  }
+template <> inline bool matchType<intgemm8>(Type type)       { return type == Type::intgemm8;       }
+template <> inline bool matchType<rowquant8>(Type type)      { return type == Type::rowquant8;      }
 // clang-format on
 
 static inline std::ostream& operator<<(std::ostream& out, Type type) {
@@ -342,6 +367,9 @@ static inline std::ostream& operator<<(std::ostream& out, Type type) {
     case Type::packed16      : out << "packed16"; break;
     case Type::packed8avx2   : out << "packed8avx2"; break;
     case Type::packed8avx512 : out << "packed8avx512"; break;
+
+    case Type::intgemm8      : out << "intgemm8"; break;
+    case Type::rowquant8     : out << "rowquant8"; break;
   }
   return out;
 }
@@ -367,6 +395,8 @@ template <> inline std::string request<double>()   { return "float64"; }
 template <> inline std::string request<packed16>() { return "packed16"; }
 template <> inline std::string request<packed8avx2>()  { return "packed8avx2"; }
 template <> inline std::string request<packed8avx512>()  { return "packed8avx512"; }
+template <> inline std::string request<intgemm8>()  { return "intgemm8"; }
+template <> inline std::string request<rowquant8>()  { return "rowquant8"; }
 // clang-format on
 
 static Type inline typeFromString(const std::string& str) {
@@ -402,6 +432,11 @@ static Type inline typeFromString(const std::string& str) {
   if(str == "packed8avx512")
     return Type::packed8avx512;
 
+  if(str == "intgemm8")
+    return Type::intgemm8;
+  if(str == "rowquant8")
+    return Type::rowquant8;
+
   ABORT("Unknown type {}", str);
 }
 
@@ -425,6 +460,8 @@ template <> inline Type typeId<double>()   { return Type::float64; }
 template <> inline Type typeId<packed16>()      { return Type::packed16; }
 template <> inline Type typeId<packed8avx2>()   { return Type::packed8avx2; }
 template <> inline Type typeId<packed8avx512>() { return Type::packed8avx512; }
+template <> inline Type typeId<intgemm8>()      { return Type::intgemm8; }
+template <> inline Type typeId<rowquant8>()     { return Type::rowquant8; }
 
 // Abort if given C++ does not correspond to runtime type
 template <typename T>
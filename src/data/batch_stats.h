@@ -1,8 +1,12 @@
 #pragma once
 
 #include <deque>
+#include <fstream>
 #include <queue>
 
+#include "common/filesystem.h"
+#include "common/hash.h"
+#include "common/version.h"
 #include "data/corpus.h"
 #include "data/vocab.h"
 
@@ -61,7 +65,7 @@ public:
     return sum / map_.size();
   }
 
-  // helpers for multi-node  --note: presently unused, but keeping them around for later use
+  // helpers for multi-node and for saving the statistics, see save() and load()
   // serialize into a flat vector, for MPI data exchange
   std::vector<size_t> flatten() const {
     std::vector<size_t> res;
@@ -99,6 +103,65 @@ public:
     //dump();
   }
 
+  // Key of the configuration that the statistics are collected for: a hash of the options that affect the
+  // memory use of a batch (model type and dimensions, dropout, workspace, devices, precision, lengths,
+  // fitting), the number of MPI processes and the version. Other options, e.g. the training data, the
+  // schedule or the logging, can change without invalidating the statistics.
+  static std::string configKey(Ptr<Options> options, size_t numMPIProcesses) {
+    static const char* const keys[] = {
+        // model type and dimensions
+        "type", "dim-vocabs", "dim-emb", "lemma-dim-emb", "dim-rnn", "enc-type", "enc-cell", "enc-cell-depth",
+        "enc-depth", "dec-cell", "dec-cell-base-depth", "dec-cell-high-depth", "dec-depth", "skip",
+        "layer-normalization", "right-left", "input-types", "best-deep", "tied-embeddings", "tied-embeddings-src",
+        "tied-embeddings-all", "output-omit-bias", "transformer-heads", "transformer-no-projection",
+        "transformer-pool", "transformer-dim-ffn", "transformer-ffn-depth", "transformer-dim-aan",
+        "transformer-aan-depth", "transformer-decoder-autoreg", "transformer-tied-layers", "transformer-preprocess",
+        "transformer-postprocess", "transformer-postprocess-emb", "transformer-postprocess-top", "ulr",
+        "ulr-dim-emb",
+        // dropout masks
+        "dropout-rnn", "dropout-src", "dropout-trg", "transformer-dropout", "transformer-dropout-attention",
+        "transformer-dropout-ffn",
+        // memory and devices
+        "workspace", "devices", "num-devices", "cpu-threads", "precision", "gradient-checkpointing",
+        "sync-sgd", "optimizer-delay", "mini-batch-warmup",
+        // fitting
+        "max-length", "mini-batch-fit-step", "mini-batch-fit-plan", "mini-batch-fit-plan-margin"};
+
+    const YAML::Node all = options->cloneToYamlNode();
+    size_t seed = 0;
+    for(auto key : keys) {
+      util::hash_combine(seed, std::string(key));
+      util::hash_combine(seed, all[key] ? YAML::Dump(all[key]) : std::string());
+    }
+    util::hash_combine(seed, numMPIProcesses);
+    util::hash_combine(seed, buildVersion());
+    return fmt::format("{:016x}", seed);
+  }
+
+  // Loads statistics written by save() if they were saved under the same key, i.e. for the same
+  // configuration. Returns false if there is no such file or it belongs to a different configuration.
+  bool load(const std::string& fileName, const std::string& key) {
+    if(!filesystem::exists(fileName))
+      return false;
+
+    YAML::Node config = YAML::LoadFile(fileName);
+    if(!config["key"] || config["key"].as<std::string>() != key)
+      return false;
+
+    *this = BatchStats(config["stats"].as<std::vector<size_t>>());
+    return !map_.empty();
+  }
+
+  // Saves the statistics together with the key of the configuration they were collected for
+  void save(const std::string& fileName, const std::string& key) const {
+    YAML::Node config;
+    config["key"] = key;
+    config["stats"] = flatten();
+
+    std::ofstream fout(fileName);
+    fout << config;
+  }
+
   void dump() { // (for debugging)
     for (const auto& entry : map_) {
       for (auto streamLen : entry.first)
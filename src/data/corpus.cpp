@@ -11,8 +11,8 @@
 namespace marian {
 namespace data {
 
-Corpus::Corpus(Ptr<Options> options, bool translate /*= false*/)
-    : CorpusBase(options, translate),
+Corpus::Corpus(Ptr<Options> options, bool translate /*= false*/, bool openFiles /*= true*/)
+    : CorpusBase(options, translate, openFiles),
         shuffleInRAM_(options_->get<bool>("shuffle-in-ram", false)),
         allCapsEvery_(options_->get<size_t>("all-caps-every", 0)),
         titleCaseEvery_(options_->get<size_t>("english-title-case-every", 0)) {}
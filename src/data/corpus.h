@@ -34,7 +34,7 @@ private:
 
 public:
   // @TODO: check if translate can be replaced by an option in options
-  Corpus(Ptr<Options> options, bool translate = false);
+  Corpus(Ptr<Options> options, bool translate = false, bool openFiles = true);
 
   Corpus(std::vector<std::string> paths,
          std::vector<Ptr<Vocab>> vocabs,
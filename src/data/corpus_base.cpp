@@ -61,7 +61,7 @@ CorpusBase::CorpusBase(const std::vector<std::string>& paths,
   initEOS(/*training=*/true);
 }
 
-CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
+CorpusBase::CorpusBase(Ptr<Options> options, bool translate, bool openFiles)
     : DatasetBase(options),
       maxLength_(options_->get<size_t>("max-length")),
       maxLengthCrop_(options_->get<bool>("max-length-crop")),
@@ -340,20 +340,22 @@ CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
     options_->set("dim-vocabs", vocabDims);
   }
 
-  for(auto path : paths_) {
-    if(path == "stdin" || path == "-")
-      files_.emplace_back(new std::istream(std::cin.rdbuf()));
-    else {
-      io::InputFileStream *strm = new io::InputFileStream(path);
-      ABORT_IF(strm->empty(), "File '{}' is empty", path);
-      files_.emplace_back(strm);
+  if(openFiles) {
+    for(auto path : paths_) {
+      if(path == "stdin" || path == "-")
+        files_.emplace_back(new std::istream(std::cin.rdbuf()));
+      else {
+        io::InputFileStream *strm = new io::InputFileStream(path);
+        ABORT_IF(strm->empty(), "File '{}' is empty", path);
+        files_.emplace_back(strm);
+      }
     }
   }
 
-  ABORT_IF(!tsv_ && vocabs_.size() != files_.size(),
+  ABORT_IF(!tsv_ && vocabs_.size() != paths_.size(),
            "Number of {} files ({}) and vocab files ({}) does not agree",
            training ? "corpus" : "input",
-           files_.size(),
+           paths_.size(),
            vocabs_.size());
 
   // Handle guided alignment and data weighting files. Alignments and weights in TSV input were
@@ -367,9 +369,11 @@ CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
 
       alignFileIdx_ = (int)paths_.size();
       paths_.emplace_back(path);
-      io::InputFileStream* strm = new io::InputFileStream(path);
-      ABORT_IF(strm->empty(), "File with alignments '{}' is empty", path);
-      files_.emplace_back(strm);
+      if(openFiles) {
+        io::InputFileStream* strm = new io::InputFileStream(path);
+        ABORT_IF(strm->empty(), "File with alignments '{}' is empty", path);
+        files_.emplace_back(strm);
+      }
     }
 
     if(useDataWeighting) {
@@ -380,9 +384,11 @@ CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
 
       weightFileIdx_ = (int)paths_.size();
       paths_.emplace_back(path);
-      io::InputFileStream* strm = new io::InputFileStream(path);
-      ABORT_IF(strm->empty(), "File with weights '{}' is empty", path);
-      files_.emplace_back(strm);
+      if(openFiles) {
+        io::InputFileStream* strm = new io::InputFileStream(path);
+        ABORT_IF(strm->empty(), "File with weights '{}' is empty", path);
+        files_.emplace_back(strm);
+      }
     }
   }
 }
@@ -223,6 +223,30 @@ public:
     return splits;
   }
 
+  /**
+   * @brief Creates a sub-batch of the sentences at the given batch indices, in that order.
+   *
+   * The width is kept, so that the result can stand in for this sub-batch in computations that
+   * depend on the padded length.
+   *
+   * @param batchIndices indices of the sentences to copy, may contain repetitions
+   */
+  Ptr<SubBatch> select(const std::vector<size_t>& batchIndices) const {
+    auto sb = New<SubBatch>(batchIndices.size(), width_, vocab_);
+
+    size_t words = 0;
+    for(size_t s = 0; s < width_; ++s) {
+      for(size_t b = 0; b < batchIndices.size(); ++b) {
+        sb->data()[locate(b, s, batchIndices.size())] = indices_[locate(batchIndices[b], s)];
+        sb->mask()[locate(b, s, batchIndices.size())] = mask_[locate(batchIndices[b], s)];
+        if(mask_[locate(batchIndices[b], s)] != 0)
+          words++;
+      }
+    }
+    sb->setWords(words);
+    return sb;
+  }
+
   void setWords(size_t words) { words_ = words; }
 
   // experimental: hide inline-fix source tokens from cross attention
@@ -514,7 +538,9 @@ class CorpusBase : public DatasetBase<SentenceTuple, CorpusIterator, CorpusBatch
 public:
   typedef SentenceTuple Sample;
 
-  CorpusBase(Ptr<Options> options, bool translate = false);
+  // openFiles = false sets up paths, vocabularies and alignment/weight indices without opening the
+  // text files, for corpora that read the data from elsewhere (CorpusBinary)
+  CorpusBase(Ptr<Options> options, bool translate = false, bool openFiles = true);
 
   CorpusBase(const std::vector<std::string>& paths,
       const std::vector<Ptr<Vocab>>& vocabs,
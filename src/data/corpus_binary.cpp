@@ -0,0 +1,320 @@
+#include "data/corpus_binary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+
+#include "common/filesystem.h"
+#include "common/hash.h"
+#include "training/training_state.h"
+
+namespace marian {
+namespace data {
+
+namespace {
+
+const char MAGIC[8] = {'M', 'A', 'R', 'I', 'A', 'N', 'B', 'C'};
+const uint64_t VERSION = 2;
+const size_t HEADER_SIZE = 6; // number of uint64 in the header after the magic
+
+// One section of the file while it is being created
+template <typename T>
+struct SectionBuilder {
+  std::vector<uint64_t> offsets{0};
+  std::vector<T> data;
+
+  void close() { offsets.push_back(data.size()); }
+};
+
+size_t padded(size_t bytes) {
+  return (bytes + 7) / 8 * 8;
+}
+
+template <typename T>
+void writePadded(std::ofstream& out, const std::vector<T>& v) {
+  size_t bytes = v.size() * sizeof(T);
+  out.write((const char*)v.data(), bytes);
+  const char zeros[8] = {0};
+  out.write(zeros, padded(bytes) - bytes);
+}
+
+template <typename T>
+void writeSection(std::ofstream& out, const SectionBuilder<T>& section) {
+  writePadded(out, section.offsets);
+  writePadded(out, section.data);
+}
+
+// Walks over the sections of a mapped binary corpus
+struct MappedReader {
+  const char* ptr;
+  const char* end;
+  const std::string& path;
+
+  const char* take(size_t bytes) {
+    ABORT_IF((size_t)(end - ptr) < padded(bytes), "Binary corpus {} is truncated", path);
+    const char* current = ptr;
+    ptr += padded(bytes);
+    return current;
+  }
+
+  template <typename T>
+  void section(size_t numSentences, const uint64_t*& offsets, const T*& data) {
+    offsets = (const uint64_t*)take((numSentences + 1) * sizeof(uint64_t));
+    data = (const T*)take((size_t)offsets[numSentences] * sizeof(T));
+  }
+};
+
+// Text files the binary corpus is created from: --train-sets and the files with alignments and
+// weights, which are part of the TSV input otherwise
+std::vector<std::string> sourcePaths(Ptr<Options> options) {
+  auto paths = options->get<std::vector<std::string>>("train-sets");
+  if(!options->get<bool>("tsv", false)) {
+    if(options->get("guided-alignment", std::string("none")) != "none")
+      paths.push_back(options->get<std::string>("guided-alignment"));
+    if(options->hasAndNotEmpty("data-weighting"))
+      paths.push_back(options->get<std::string>("data-weighting"));
+  }
+  return paths;
+}
+
+// Fingerprint of the text files (path, size and modification time) and the vocabularies (all
+// tokens) a binary corpus is created from
+uint64_t fingerprint(const std::vector<std::string>& paths, const std::vector<Ptr<Vocab>>& vocabs) {
+  uint64_t hash = util::hashFNV(std::to_string(VERSION));
+  for(const auto& path : paths) {
+    hash = util::hashFNV(path + "\n", hash);
+    if(filesystem::exists(path)) {
+      hash = util::hashFNV(std::to_string(filesystem::fileSize(path)) + "\n", hash);
+      hash = util::hashFNV(std::to_string((int64_t)filesystem::lastWriteTime(path)) + "\n", hash);
+    }
+  }
+  for(const auto& vocab : vocabs) {
+    hash = util::hashFNV(vocab->type() + "\n" + std::to_string(vocab->size()) + "\n", hash);
+    for(size_t id = 0; id < vocab->size(); ++id)
+      hash = util::hashFNV((*vocab)[Word::fromWordIndex(id)] + "\n", hash);
+  }
+  return hash;
+}
+
+// Fingerprint stored in the header of the binary corpus at path, 0 if it is not a binary corpus of
+// the current version
+uint64_t storedFingerprint(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(MAGIC)];
+  uint64_t header[HEADER_SIZE];
+  if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+     || !in.read((char*)header, sizeof(header)) || header[0] != VERSION)
+    return 0;
+  return header[1];
+}
+
+}  // namespace
+
+CorpusBinary::CorpusBinary(Ptr<Options> options, bool translate /*= false*/)
+    : Corpus(options, translate, /*openFiles=*/false) {
+  auto path = options_->get<std::string>("binary-corpus");
+  uint64_t expected = fingerprint(sourcePaths(options_), vocabs_);
+  if(!filesystem::exists(path)) {
+    create(options_);
+  } else if(storedFingerprint(path) != expected) {
+    LOG(info, "[data] Binary corpus {} does not match the training data or vocabularies, recreating it", path);
+    create(options_);
+  } else {
+    LOG(info, "[data] Reusing binary corpus {}", path);
+  }
+  map(path);
+
+  ABORT_IF(fingerprint_ != expected,
+           "Binary corpus {} does not match the training data or vocabularies", path);
+
+  ABORT_IF(streams_.size() != vocabs_.size(),
+           "Binary corpus {} has {} streams, but {} vocabularies are given",
+           path, streams_.size(), vocabs_.size());
+  ABORT_IF(alignFileIdx_ > -1 && !alignments_.data,
+           "Guided alignment requested, but binary corpus {} contains no alignments", path);
+  ABORT_IF(weightFileIdx_ > -1 && !weights_.data,
+           "Data weighting requested, but binary corpus {} contains no weights", path);
+
+  // a corrupted file must not lead to out-of-bounds embedding lookups
+  for(size_t i = 0; i < streams_.size(); ++i) {
+    size_t vocabSize = vocabs_[i]->size();
+    const uint32_t* begin = streams_[i].data;
+    const uint32_t* end = begin + streams_[i].offsets[numSentences_];
+    ABORT_IF(std::any_of(begin, end, [=](uint32_t id) { return id >= vocabSize; }),
+             "Binary corpus {} contains word ids out of the range of vocabulary {} of size {}",
+             path, i, vocabSize);
+  }
+}
+
+void CorpusBinary::map(const std::string& path) {
+  mmap_ = mio::mmap_source(path);
+  ABORT_IF(mmap_.size() < sizeof(MAGIC) || std::memcmp(mmap_.data(), MAGIC, sizeof(MAGIC)) != 0,
+           "File {} is not a binary corpus", path);
+
+  MappedReader reader{mmap_.data() + sizeof(MAGIC), mmap_.data() + mmap_.size(), path};
+  auto header = (const uint64_t*)reader.take(HEADER_SIZE * sizeof(uint64_t));
+  ABORT_IF(header[0] != VERSION,
+           "Binary corpus {} has version {}, expected {}", path, header[0], VERSION);
+  fingerprint_ = header[1];
+  numSentences_ = (size_t)header[2];
+  size_t numStreams = (size_t)header[3];
+
+  streams_.resize(numStreams);
+  for(auto& stream : streams_)
+    reader.section(numSentences_, stream.offsets, stream.data);
+  if(header[4])
+    reader.section(numSentences_, alignments_.offsets, alignments_.data);
+  if(header[5])
+    reader.section(numSentences_, weights_.offsets, weights_.data);
+
+  LOG(info, "[data] Mapped binary corpus {} with {} sentences", path, numSentences_);
+}
+
+SentenceTuple CorpusBinary::next() {
+  while(pos_ < numSentences_) {
+    size_t curId = order_.empty() ? pos_ : order_[pos_];
+    pos_++;
+
+    SentenceTuple tup(curId);
+    for(size_t i = 0; i < streams_.size(); ++i) {
+      const auto& stream = streams_[i];
+      Words words(stream.size(curId));
+      const uint32_t* ids = stream.begin(curId);
+      for(size_t j = 0; j < words.size(); ++j)
+        words[j] = Word::fromWordIndex(ids[j]);
+
+      if(maxLengthCrop_ && words.size() > maxLength_) {
+        words.resize(maxLength_);
+        if(addEOS_[i])
+          words.back() = vocabs_[i]->getEosId();
+      }
+
+      if(rightLeft_ && !words.empty())
+        std::reverse(words.begin(), words.end() - 1);
+
+      tup.push_back(words);
+    }
+
+    if(alignFileIdx_ > -1) {
+      ABORT_IF(rightLeft_,
+               "Guided alignment and right-left model cannot be used "
+               "together at the moment");
+      WordAlignment alignment;
+      const uint32_t* points = alignments_.begin(curId);
+      for(size_t j = 0; j + 1 < alignments_.size(curId); j += 2)
+        alignment.push_back(points[j], points[j + 1], 1.f);
+      tup.setAlignment(alignment);
+    }
+
+    if(weightFileIdx_ > -1) {
+      std::vector<float> weights(weights_.begin(curId), weights_.begin(curId) + weights_.size(curId));
+      if(maxLengthCrop_ && weights.size() > maxLength_)
+        weights.resize(maxLength_);
+      if(rightLeft_)
+        std::reverse(weights.begin(), weights.end());
+      if(!weights.empty())
+        tup.setWeights(weights);
+    }
+
+    // same filtering as for text corpora: all streams non-empty and not longer than allowed
+    if(std::all_of(tup.begin(), tup.end(), [=](const Words& words) {
+         return words.size() > 0 && words.size() <= maxLength_;
+       }))
+      return tup;
+  }
+  return SentenceTuple(0);
+}
+
+void CorpusBinary::shuffle() {
+  LOG(info, "[data] Shuffling binary corpus");
+  order_.resize(numSentences_);
+  std::iota(order_.begin(), order_.end(), 0);
+  std::shuffle(order_.begin(), order_.end(), eng_);
+  pos_ = 0;
+}
+
+void CorpusBinary::reset() {
+  order_.clear();
+  pos_ = 0;
+}
+
+void CorpusBinary::restore(Ptr<TrainingState> ts) {
+  setRNGState(ts->seedCorpus);
+}
+
+void CorpusBinary::create(Ptr<Options> options) {
+  auto path = options->get<std::string>("binary-corpus");
+  LOG(info, "[data] Creating binary corpus {}", path);
+
+  // read everything as is, length limits and reversal are applied when reading the binary corpus.
+  // The maximum of size_t does not survive the round trip through the YAML options, it reads back as 0.
+  Corpus corpus(options->with("max-length", (size_t)std::numeric_limits<uint32_t>::max(),
+                              "max-length-crop", false,
+                              "right-left", false,
+                              "all-caps-every", (size_t)0,
+                              "english-title-case-every", (size_t)0));
+  uint64_t hash = fingerprint(sourcePaths(options), corpus.getVocabs());
+  bool hasAlignments = options->get("guided-alignment", std::string("none")) != "none";
+  bool hasWeights = options->hasAndNotEmpty("data-weighting");
+
+  std::vector<SectionBuilder<uint32_t>> streams;
+  SectionBuilder<uint32_t> alignments;
+  SectionBuilder<float> weights;
+  size_t numSentences = 0;
+  for(;;) {
+    auto tup = corpus.next();
+    if(tup.empty())
+      break;
+
+    if(streams.empty())
+      streams.resize(tup.size());
+    ABORT_IF(tup.size() != streams.size(), "Sentence {} has an unexpected number of streams", numSentences);
+    for(size_t i = 0; i < tup.size(); ++i) {
+      for(auto word : tup[i])
+        streams[i].data.push_back(word.toWordIndex());
+      streams[i].close();
+    }
+    if(hasAlignments) {
+      for(auto point : tup.getAlignment()) {
+        alignments.data.push_back((uint32_t)point.srcPos);
+        alignments.data.push_back((uint32_t)point.tgtPos);
+      }
+      alignments.close();
+    }
+    if(hasWeights) {
+      for(auto w : tup.getWeights())
+        weights.data.push_back(w);
+      weights.close();
+    }
+
+    if(++numSentences % 1000000 == 0)
+      LOG(info, "[data] Encoded {} sentences", numSentences);
+  }
+
+  // write to a temporary file first so that an interrupted run does not leave a truncated corpus
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::binary);
+    ABORT_IF(!out, "Could not open {} for writing", tempPath);
+    out.write(MAGIC, sizeof(MAGIC));
+    std::vector<uint64_t> header = {VERSION, hash, numSentences, streams.size(), hasAlignments, hasWeights};
+    writePadded(out, header);
+    for(const auto& stream : streams)
+      writeSection(out, stream);
+    if(hasAlignments)
+      writeSection(out, alignments);
+    if(hasWeights)
+      writeSection(out, weights);
+    ABORT_IF(!out, "Error writing binary corpus {}", tempPath);
+  }
+  ABORT_IF(std::rename(tempPath.c_str(), path.c_str()) != 0,
+           "Could not rename {} to {}", tempPath, path);
+
+  LOG(info, "[data] Wrote {} sentences to binary corpus {}", numSentences, path);
+}
+
+}  // namespace data
+}  // namespace marian
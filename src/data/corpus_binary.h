@@ -0,0 +1,79 @@
+#pragma once
+
+#include "common/definitions.h"
+#include "common/options.h"
+#include "data/corpus.h"
+
+#include "3rd_party/mio/mio.hpp"
+
+namespace marian {
+namespace data {
+
+/**
+ * @brief Training corpus read from a memory-mapped file of pre-encoded word ids.
+ *
+ * The file is created once from the text corpora given with --train-sets (either by
+ * marian-binarize or by the first training run with --binary-corpus) and stores every input stream
+ * as an array of word ids plus an offset index with one entry per sentence. Guided alignments and
+ * data weights are stored the same way if present. Reading a sentence tuple does not tokenize or
+ * look up anything in the vocabularies and shuffling only permutes sentence indices, the data stays
+ * where it is in the mapped file.
+ *
+ * Sentences are stored without length filtering, cropping or reversal; --max-length,
+ * --max-length-crop and --right-left are applied when reading.
+ *
+ * The header contains a fingerprint of the text files (paths, sizes, modification times) and of
+ * the vocabularies. A file that does not match the current --train-sets and --vocabs is created
+ * anew, and word ids are checked against the vocabulary sizes when the file is mapped.
+ *
+ * Layout, all integers little-endian, every section padded to 8 bytes:
+ *   header:  char[8] magic "MARIANBC", uint64 version, uint64 fingerprint, uint64 sentences,
+ *            uint64 word streams, uint64 has alignments, uint64 has weights
+ *   streams: uint64 offsets[sentences + 1], uint32 word ids[offsets[sentences]]
+ *   aligns:  uint64 offsets[sentences + 1], uint32 (src, trg) pairs[offsets[sentences]]
+ *   weights: uint64 offsets[sentences + 1], float weights[offsets[sentences]]
+ */
+class CorpusBinary : public Corpus {
+private:
+  // A section of the mapped file: offsets into the data array, one per sentence plus one
+  template <typename T>
+  struct Section {
+    const uint64_t* offsets{nullptr};
+    const T* data{nullptr};
+
+    size_t size(size_t id) const { return (size_t)(offsets[id + 1] - offsets[id]); }
+    const T* begin(size_t id) const { return data + offsets[id]; }
+  };
+
+  mio::mmap_source mmap_;
+  uint64_t fingerprint_{0};
+  size_t numSentences_{0};
+
+  std::vector<Section<uint32_t>> streams_;
+  Section<uint32_t> alignments_;  // data is empty if the file has no alignments
+  Section<float> weights_;        // data is empty if the file has no weights
+
+  std::vector<size_t> order_;  // sentence indices in reading order, empty if not shuffled
+
+  void map(const std::string& path);
+
+public:
+  CorpusBinary(Ptr<Options> options, bool translate = false);
+
+  Sample next() override;
+
+  void shuffle() override;
+
+  void reset() override;
+
+  void restore(Ptr<TrainingState>) override;
+
+  /**
+   * @brief Encodes the text corpora from --train-sets with the vocabularies from --vocabs and
+   * writes them to the file given with --binary-corpus.
+   */
+  static void create(Ptr<Options> options);
+};
+
+}  // namespace data
+}  // namespace marian
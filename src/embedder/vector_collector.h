@@ -3,15 +3,16 @@
 #include "common/options.h"
 #include "common/definitions.h"
 #include "common/file_stream.h"
+#include "common/output_sink.h"
 
-#include <map>
-#include <mutex>
+#include <string>
 
 namespace marian {
 
 // This class manages multi-threaded writing of embedded vectors to stdout or an output file.
 // It will either output string versions of float vectors or binary equal length versions depending
-// on its binary_ flag.
+// on its binary_ flag. Vectors are formatted by the calling thread and written in order by an
+// OutputSink.
 class VectorCollector {
 public:
   VectorCollector(const Ptr<Options>& options);
@@ -20,15 +21,10 @@ public:
   virtual void Write(long id, const std::vector<float>& vec);
 
 protected:
-  long nextId_{0};
-  UPtr<std::ostream> outStrm_;
   bool binary_; // output binary floating point vectors if set
+  UPtr<OutputSink> sink_;
 
-  std::mutex mutex_;
-
-  typedef std::map<long, std::vector<float>> Outputs;
-  Outputs outputs_;
-
-  virtual void WriteVector(const std::vector<float>& vec);
+  // the text or binary representation of a vector as it is written to the output
+  virtual std::string FormatVector(const std::vector<float>& vec);
 };
 }  // namespace marian
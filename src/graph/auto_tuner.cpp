@@ -0,0 +1,106 @@
+#include "graph/auto_tuner.h"
+#include "common/filesystem.h"
+#include "common/logging.h"
+#include "common/utils.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace marian {
+
+std::mutex AutoTunerCache::mutex_;
+std::map<uint64_t, std::string> AutoTunerCache::decisions_;
+std::string AutoTunerCache::fileName_;
+size_t AutoTunerCache::unsaved_ = 0;
+
+void AutoTunerCache::load(const std::string& fileName) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  fileName_ = fileName;
+  if(!filesystem::exists(fileName))
+    return;
+
+  // a "marian-autotune-cache <version>" line, then one "<hash> <name>" per line
+  std::ifstream in(fileName);
+  std::string tag;
+  int version = 0;
+  if(!(in >> tag >> version) || tag != "marian-autotune-cache" || version != VERSION) {
+    LOG(info, "[autotuner] Ignoring decisions in {} written by a different version", fileName);
+    return;
+  }
+  uint64_t hash;
+  std::string name;
+  while(in >> hash >> name)
+    decisions_[hash] = name;
+  LOG(info, "[autotuner] Loaded {} decisions from {}", decisions_.size(), fileName);
+}
+
+bool AutoTunerCache::get(uint64_t hash, std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = decisions_.find(hash);
+  if(it == decisions_.end())
+    return false;
+  name = it->second;
+  return true;
+}
+
+void AutoTunerCache::put(uint64_t hash, const std::string& name) {
+  std::string fileName;
+  std::map<uint64_t, std::string> decisions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = decisions_.find(hash);
+    if(it != decisions_.end() && it->second == name)
+      return;
+    decisions_[hash] = name;
+    if(fileName_.empty() || ++unsaved_ < SAVE_INTERVAL)
+      return;
+    unsaved_ = 0;
+    fileName = fileName_;
+    decisions = decisions_;
+  }
+  // written without holding the lock, other threads keep deciding meanwhile
+  save(fileName, decisions);
+}
+
+void AutoTunerCache::flush() {
+  std::string fileName;
+  std::map<uint64_t, std::string> decisions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(fileName_.empty() || unsaved_ == 0)
+      return;
+    unsaved_ = 0;
+    fileName = fileName_;
+    decisions = decisions_;
+  }
+  save(fileName, decisions);
+}
+
+void AutoTunerCache::save(const std::string& fileName, const std::map<uint64_t, std::string>& decisions) {
+  // write a complete new file and move it into place, so concurrent readers never see a partial one.
+  // The temporary name is unique per process and call, concurrent writers do not clobber each other.
+  std::random_device rd;
+  std::string tmpName = fileName + "." + std::to_string(utils::hostnameAndProcessId().second) + "."
+                        + std::to_string(rd()) + ".tmp";
+  {
+    std::ofstream out(tmpName);
+    out << "marian-autotune-cache " << VERSION << "\n";
+    for(const auto& decision : decisions)
+      out << decision.first << " " << decision.second << "\n";
+    if(!out) {
+      LOG(warn, "[autotuner] Could not write decisions to {}", tmpName);
+      std::remove(tmpName.c_str());
+      return;
+    }
+  }
+#ifdef _WIN32
+  std::remove(fileName.c_str()); // rename does not replace an existing file on Windows
+#endif
+  if(std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+    LOG(warn, "[autotuner] Could not move {} to {}", tmpName, fileName);
+    std::remove(tmpName.c_str());
+  }
+}
+
+}  // namespace marian
@@ -1,14 +1,52 @@
 #pragma once
 
+#include "common/definitions.h"
 #include "common/timer.h"
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace marian {
 
+// Process-wide decisions of all autotuners, maps the hash of the winning algorithm for an operation
+// size to the algorithm's name. Autotuners of different threads (e.g. CPU workers) share what was
+// decided. After load(), the decisions from the file are used right away and new decisions are
+// written back to it in batches and by flush() when translation ends, so later runs do not need to
+// time the algorithms again.
+// The hashes are persisted, hence they have to be stable across builds (see util::hashFNV).
+class AutoTunerCache {
+public:
+  // Reads decisions from fileName if it exists and saves all further decisions to it
+  static void load(const std::string& fileName);
+
+  static bool get(uint64_t hash, std::string& name);
+  static void put(uint64_t hash, const std::string& name);
+
+  // Writes all decisions to the file given to load() if any are unsaved
+  static void flush();
+
+private:
+  // files with a different version are ignored and overwritten
+  static const int VERSION = 2;
+  // number of new decisions after which they are saved without waiting for the exit
+  static const size_t SAVE_INTERVAL = 16;
+
+  static std::mutex mutex_;
+  static std::map<uint64_t, std::string> decisions_;
+  static std::string fileName_;
+  static size_t unsaved_;
+
+  static void save(const std::string& fileName, const std::map<uint64_t, std::string>& decisions);
+};
+
 class AutoTunerRecorder {
 public:
   virtual void start(size_t hash) = 0;
@@ -31,9 +69,11 @@ private:
   // hash: a unique hash key for each operation size
   //      (e.g. m, n, k, transpose A, transpose B, bias size for GEMM)
   // algorithm: a function that holds an algorithm
+  // name: identifies the algorithm in the AutoTunerCache, has to be stable across runs
   struct HashedAlgorithm {
     size_t hash;
     Algorithm algorithm;
+    std::string name;
   };
 
   // This structure represents the collected statistics.
@@ -53,11 +93,21 @@ private:
     size_t best = 0;
     double bestTime = std::numeric_limits<double>::max();
 
+    auto doneIt = done_.find(algorithms_[0].hash);
+    if(doneIt != done_.end())
+      return doneIt->second;
+
+    // decided by another autotuner or in an earlier run
     for(size_t i = 0; i < algorithms_.size(); ++i) {
-      auto doneIt = done_.find(algorithms_[i].hash);
-      if(doneIt != done_.end())
-        return doneIt->second;
+      std::string name;
+      if(AutoTunerCache::get(algorithms_[i].hash, name) && name == algorithms_[i].name) {
+        for(auto& a : algorithms_)
+          done_[a.hash] = i;
+        return i;
+      }
+    }
 
+    for(size_t i = 0; i < algorithms_.size(); ++i) {
       auto it = stats_.find(algorithms_[i].hash);
       if(it != stats_.end()) {
         auto& stat = it->second;
@@ -78,6 +128,7 @@ private:
 
     for(auto& a : algorithms_)
       done_[a.hash] = best;
+    AutoTunerCache::put(algorithms_[best].hash, algorithms_[best].name);
 
     return best;
   }
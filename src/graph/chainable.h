@@ -75,6 +75,9 @@ public:
   virtual bool memoize() = 0;
   virtual void setMemoize(bool) = 0;
 
+  // true if the node does not own its memory, but views the memory of another node
+  virtual bool isView() const = 0;
+
   virtual void setId(size_t) = 0;
   virtual size_t getId() = 0;
 
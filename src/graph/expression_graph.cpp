@@ -98,7 +98,14 @@ void ExpressionGraph::forwardNext() {
     }
   }
 
+  bool staticMemory = inferenceOnly_ && staticMemory_;
+  if(staticMemory)
+    tensors_->planArena(nodesForward_);
+
   forward(nodesForward_, /*finalPass=*/!checkpointing_); // if checkPointing, this is not final
+
+  if(staticMemory)
+    tensors_->freeArena();
 }
 
 void ExpressionGraph::forward(std::list<Expr>& forwardTape, bool finalPass) {
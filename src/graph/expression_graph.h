@@ -7,10 +7,12 @@
 #include "tensors/tensor_allocator.h"
 
 #include "graph/chainable.h"
+#include "graph/memory_planner.h"
 #include "graph/node_initializers.h"
 #include "graph/node_operators.h"
 #include "graph/parameters.h"
 
+#include <algorithm>
 #include <map>
 #include <unordered_set>
 
@@ -30,18 +32,52 @@ private:
   Ptr<WeakMemory> shortterm_;
   Ptr<Memory> longterm_;
 
+  // statically planned memory of the current forward pass, see planArena()
+  Ptr<Backend> backend_;
+  MemoryPiece::PtrType arena_; // kept between passes and reused as long as the plans fit
+  std::unordered_map<Chainable<Tensor>*, size_t> arenaOffsets_; // planned nodes that are not allocated yet
+  std::vector<MemoryPiece::PtrType> arenaPieces_;
+
+  // arena plans by the signature of the tape, see MemoryPlanner::arenaSignature()
+  struct ArenaPlan {
+    std::vector<size_t> signature;
+    size_t bytes;
+    std::vector<std::pair<size_t, size_t>> offsets; // tape position and offset of the planned nodes
+  };
+  std::unordered_map<size_t, ArenaPlan> arenaPlans_;
+  static const size_t MAX_ARENA_PLANS = 256;
+
+  // arenas of earlier passes with tensors that are still alive, freed once these are gone
+  std::vector<std::pair<MemoryPiece::PtrType, std::vector<MemoryPiece::PtrType>>> retiredArenas_;
+
+  static bool inPiece(const Tensor& tensor, const MemoryPiece::PtrType& piece) {
+    auto data = tensor->memory()->data();
+    return piece && data >= piece->data() && data < piece->data() + piece->size();
+  }
+
+  bool inArena(const Tensor& tensor) const { return inPiece(tensor, arena_); }
+
+  bool inRetiredArena(const Tensor& tensor) const {
+    for(const auto& retired : retiredArenas_)
+      if(inPiece(tensor, retired.first))
+        return true;
+    return false;
+  }
+
 public:
   Tensors(Ptr<Backend> backend)
       : tensors_(New<TensorAllocator>(backend)),
         cache_(New<TensorAllocator>(backend)),
         shortterm_(New<WeakMemory>()),
-        longterm_(New<Memory>()) {}
+        longterm_(New<Memory>()),
+        backend_(backend) {}
 
   Tensors(Ptr<Backend> backend, Ptr<Device> device)
       : tensors_(New<TensorAllocator>(backend, device)),
         cache_(New<TensorAllocator>(backend)),
         shortterm_(New<WeakMemory>()),
-        longterm_(New<Memory>()) {}
+        longterm_(New<Memory>()),
+        backend_(backend) {}
 
   void reserve(size_t bytes) { tensors_->reserve(bytes); }
 
@@ -49,9 +85,86 @@ public:
     tensors_->throwAtReallocation(throwAtRealloc);
   }
 
+  // Places the values of nodes on an inference forward tape that are released during the pass at
+  // fixed offsets in one allocation, see MemoryPlanner::planArena(). Call freeArena() after the pass.
+  // Plans are cached by the signature of the tape, so only new shapes are planned.
+  void planArena(const std::list<Expr>& forwardTape) {
+    freeRetiredArenas();
+
+    MemoryPlanner planner;
+    auto signature = planner.arenaSignature(forwardTape);
+    size_t hash = 0;
+    for(auto value : signature)
+      util::hash_combine(hash, value);
+
+    auto it = arenaPlans_.find(hash);
+    if(it == arenaPlans_.end() || it->second.signature != signature) {
+      if(arenaPlans_.size() >= MAX_ARENA_PLANS)
+        arenaPlans_.clear();
+      ArenaPlan plan{std::move(signature), planner.planArena(forwardTape), {}};
+      for(const auto& interval : planner.intervals())
+        plan.offsets.push_back({interval.begin, interval.offset});
+      it = arenaPlans_.emplace(hash, std::move(plan)).first;
+    }
+    const auto& plan = it->second;
+    if(plan.bytes == 0)
+      return;
+
+    auto allocator = tensors_->allocator();
+    if(arena_ && arena_->size() < plan.bytes) {
+      allocator->free(arena_);
+      arena_ = nullptr;
+    }
+    if(!arena_)
+      arena_ = allocator->alloc(plan.bytes);
+
+    std::vector<Chainable<Tensor>*> nodes;
+    for(const auto& node : forwardTape)
+      nodes.push_back(node.get());
+    for(const auto& offset : plan.offsets)
+      arenaOffsets_[nodes[offset.first]] = offset.second;
+  }
+
+  void freeArena() {
+    if(arena_) {
+      // a piece is referenced by the allocator and here only, unless its tensor is still alive
+      bool alive = std::any_of(arenaPieces_.begin(), arenaPieces_.end(), [](MemoryPiece::PtrType& piece) {
+        return piece.useCount() > 2;
+      });
+      if(alive) {
+        // should not happen as such nodes are not planned, but if it does the memory stays valid
+        LOG_ONCE(warn, "A tensor in the planned arena outlives the forward pass, keeping its memory");
+        retiredArenas_.push_back({arena_, std::move(arenaPieces_)});
+        arena_ = nullptr;
+      } else {
+        tensors_->allocator()->dropViews(arena_);
+      }
+      arenaPieces_.clear();
+    }
+    arenaOffsets_.clear();
+  }
+
+  void freeRetiredArenas() {
+    auto allocator = tensors_->allocator();
+    retiredArenas_.erase(std::remove_if(retiredArenas_.begin(), retiredArenas_.end(), [&](decltype(retiredArenas_)::value_type& retired) {
+      for(auto& piece : retired.second)
+        if(piece.useCount() > 2)
+          return false;
+      allocator->free(retired.first);
+      return true;
+    }), retiredArenas_.end());
+  }
+
   void allocateForward(Expr node) {
     if(!node->val()) {
-      if(node->memoize())
+      auto planned = arenaOffsets_.find(node.get());
+      if(planned != arenaOffsets_.end()) {
+        auto bytes = requiredBytes(node->shape(), node->value_type());
+        auto mem = tensors_->allocator()->view(arena_, planned->second, bytes);
+        node->val() = TensorBase::New(mem, node->shape(), node->value_type(), backend_);
+        arenaPieces_.push_back(mem);
+        arenaOffsets_.erase(planned);
+      } else if(node->memoize())
         cache_->allocate(node->val(), node->shape(), node->value_type());
       else
         tensors_->allocate(node->val(), node->shape(), node->value_type());
@@ -63,7 +176,10 @@ public:
       tensors_->allocate(node->grad(), node->shape(), node->value_type());
   }
 
-  void free(const Tensor& tensor) { tensors_->free(tensor); }
+  void free(const Tensor& tensor) {
+    if(!inArena(tensor) && !inRetiredArena(tensor)) // memory of the arena is released as a whole
+      tensors_->free(tensor);
+  }
 
   Ptr<Allocator>       getAllocator() { return tensors_->allocator(); }
   Ptr<TensorAllocator> getTensorAllocator() { return tensors_; }
@@ -103,6 +219,11 @@ public:
   void clear() {
     tensors_->clear();
     shortterm_->clear();
+    // the arenas were part of the cleared workspace
+    arena_ = nullptr;
+    arenaOffsets_.clear();
+    arenaPieces_.clear();
+    retiredArenas_.clear();
   }
 
   void clearShorttermMemory() { shortterm_->clear(); }
@@ -134,6 +255,8 @@ private:
 
   bool checkpointing_{false}; // use gradient checkpointing if true
 
+  bool staticMemory_{false}; // plan inference memory ahead of each forward pass if true
+
   bool reloaded_{false};
 
   bool throwNaN_{false};
@@ -180,6 +303,11 @@ public:
   void setCheckpointing(bool checkpointing) { checkpointing_ = checkpointing; }
   bool isCheckpointing() { return checkpointing_; }
 
+  // Place the values of an inference forward pass at statically planned offsets of one allocation
+  // instead of allocating them one by one, see MemoryPlanner::planArena()
+  void setStaticMemoryPlanning(bool staticMemory) { staticMemory_ = staticMemory; }
+  bool isStaticMemoryPlanning() { return staticMemory_; }
+
   void switchParams(const std::string& newNamespace) {
     namespace_ = newNamespace;
   }
@@ -223,6 +351,24 @@ public:
     return true;
   }
 
+  /**
+   * @brief Shape-only estimate of the peak workspace memory in bytes that a forward and, if training,
+   * backward pass over the current graph needs. Unlike fits() this executes no kernels and does not
+   * allocate anything, see MemoryPlanner for what is not covered by the estimate.
+   */
+  size_t planWorkspace() {
+    MemoryPlanner planner;
+    planner.plan(nodesForward_, nodesBackward_, inferenceOnly_);
+    return planner.peakBytes();
+  }
+
+  // size of the reserved workspace memory in bytes
+  size_t workspaceBytes() { return tensors_->getAllocator()->size(); }
+
+  // maximum number of workspace bytes that were in use at the same time so far, can be read while
+  // another thread runs the graph
+  size_t workspacePeakBytes() { return tensors_->getAllocator()->peak(); }
+
   void checkNaN(Tensor t, bool& isNaN, bool& isInf);
 
   void forward() {
@@ -354,6 +354,8 @@ Expr index_select(Expr a, int axis, Expr indices) {
   ABORT_IF(indices->shape().size() != 1, "Indices must be a 1D tensor");
   // We have specialized kernels for non-batched indexing of first or last axis of a 2D tensor.
   auto rank = a->shape().size();
+  ABORT_IF(isRowQuant(a->value_type()) && !(rank == 2 && (axis == 0 || axis == -2)),
+           "Only rows can be selected from row-quantized matrices");
   if (rank == 2) {
     if (axis == 0 || axis == -2)
       return Expression<RowsNodeOp>(a, indices);
@@ -464,6 +466,92 @@ Expr weighted_average(Expr in, Expr weights, int ax) {
   return p / s;
 }
 
+static Expr affineDefault(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
+  // general version, MKL, CBlas or CUDA
+
+  // if clipValue > 0, the inputs will be clipped to range [-clipValue,
+  // clipValue] This is meant to keep values at the same range as used during
+  // training when optimizing for 8-bit integer products. Likely to be removed
+  // in the future when we explore better ways to handle this.
+  float clipValue = a->graph()->getBackend()->getClip();
+
+  int rows = a->shape().elements() / a->shape()[-1];
+  Expr ones = a->graph()->ones({ rows, 1 });
+  std::vector<Expr> nodes
+    = { clip(a, clipValue), clip(b, clipValue), bias, ones };
+  return Expression<AffineNodeOp>(nodes, transA, transB, scale);
+}
+
+// CPU matrix product (with bias if not null) that lets an AutoTuner choose between float GEMM
+// (BLAS), int16 GEMM and, if FBGEMM is available, fp16 packed GEMM with B packed on the fly
+// (--autotune-gemm). Each variant is timed for a number of runs per class of operation sizes, then
+// the fastest one is kept. Decisions are shared between threads and can be persisted with
+// --autotune-gemm-cache, see AutoTunerCache.
+static Expr gemmAutotuned(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
+  // each thread times its own graphs
+  thread_local Ptr<AutoTuner<Expr>> threadTuner = New<AutoTuner<Expr>>();
+  auto tuner = threadTuner;
+  float clipValue = a->graph()->getBackend()->getClip();
+
+  // start with new set of algorithms
+  tuner->clear();
+
+  // lower precision for shapes, reduces data sparsity
+  auto sh = [](Shape sh) {
+    for(size_t i = 0; i < sh.size(); ++i)
+      sh.set(i, sh[i] / 4);
+    return sh;
+  };
+
+  // create context for current call as hash, the hashes are persisted by AutoTunerCache and need
+  // to be the same in every build
+  std::string context = sh(a->shape()).toString() + " " + sh(b->shape()).toString()
+                        + " bias=" + std::to_string(bias != nullptr)
+                        + " transA=" + std::to_string(transA) + " transB=" + std::to_string(transB);
+  uint64_t hash = util::hashFNV(context);
+
+  // float GEMM, only the product is timed as clipping is shared by all variants
+  uint64_t hashFloat = util::hashFNV(std::string("float32"), hash);
+  tuner->insert({hashFloat, [=]() -> Expr {
+    auto e = bias != nullptr
+      ? affineDefault(a, b, bias, transA, transB, scale)
+      : Expression<DotNodeOp>(clip(a, clipValue), clip(b, clipValue), transA, transB, scale);
+    e->record(tuner, hashFloat, /*stop=*/true);
+    return e;
+  }, "float32"});
+
+  // int16 GEMM, timed from the quantization of A, B is a constant and quantized once
+  uint64_t hashInt16 = util::hashFNV(std::string("int16"), hash);
+  tuner->insert({hashInt16, [=]() -> Expr {
+    auto qa = cpu::int16::quantize(transA ? transpose(a) : a, clipValue);
+    qa->record(tuner, hashInt16, /*stop=*/false);
+    auto qb = cpu::int16::quantize(transB ? b : transpose(b), clipValue);
+    auto e = bias != nullptr
+      ? cpu::int16::affine(qa, qb, bias, scale)
+      : cpu::int16::dot(qa, qb, scale);
+    e->record(tuner, hashInt16, /*stop=*/true);
+    return e;
+  }, "int16"});
+
+#if USE_FBGEMM
+  // packed GEMM requires a constant B, which is then packed only once
+  if(fbgemm::fbgemmHasAvx2Support() && b->memoize()) {
+    uint64_t hashPacked = util::hashFNV(std::string("packed16"), hash);
+    tuner->insert({hashPacked, [=]() -> Expr {
+      auto packedB = cpu::variant::pack(Type::packed16, b, cpu::variant::PackMatrix::B, transB, clipValue);
+      auto e = bias != nullptr
+        ? cpu::variant::affine(clip(a, clipValue), packedB, b->shape(), bias, transA, transB, scale)
+        : cpu::variant::dot(clip(a, clipValue), packedB, b->shape(), transA, transB, scale);
+      e->record(tuner, hashPacked, /*stop=*/true);
+      return e;
+    }, "packed16"});
+  }
+#endif  // USE_FBGEMM
+
+  // execute algorithm with autotuning
+  return tuner->run();
+}
+
 Expr dot(Expr a, Expr b, bool transA, bool transB, float scale) {
   auto device = a->graph()->getDeviceId().type;
   float clipValue = a->graph()->getBackend()->getClip();
@@ -475,7 +563,9 @@ Expr dot(Expr a, Expr b, bool transA, bool transB, float scale) {
   // --optimize --cpu-thread=N with N > 0 are set.
   if(device == DeviceType::cpu) {
     if(isFloat(aElementType) && isFloat(bElementType)) {
-      if(a->graph()->getBackend()->isOptimized()) {
+      if(a->graph()->getBackend()->isAutotune()) {
+        return gemmAutotuned(a, b, /*bias=*/nullptr, transA, transB, scale);
+      } else if(a->graph()->getBackend()->isOptimized()) {
         // dotInt16 computes A * B.T, hence the transpose for B to get A * B
         // if transA = false and transB = false.
 
@@ -487,6 +577,14 @@ Expr dot(Expr a, Expr b, bool transA, bool transB, float scale) {
         return Expression<DotNodeOp>(
           clip(a, clipValue), clip(b, clipValue), transA, transB, scale);
       }
+    } else if(isFloat(aElementType) && isIntgemm(bElementType)) {
+      // B was prepared offline by marian-conv, the kernel (AVX512-VNNI, AVX512BW or reference) is selected at runtime
+      return cpu::int16::affinePrepared(clip(transA ? transpose(a) : a, clipValue),
+                                        b,
+                                        /*bias=*/nullptr,
+                                        transB,
+                                        scale,
+                                        cpu::variant::quantRangeA(b));
     } else if(isFloat(aElementType) && isPacked(bElementType)) {
 #if USE_FBGEMM
       // 07/10/2019 - Use packed GEMM only if the cpu architecture supports AVX2
@@ -521,27 +619,6 @@ Expr bdot(Expr a, Expr b, bool transA, bool transB, float scale) {
   return Expression<DotBatchedNodeOp>(a, b, transA, transB, scale);
 }
 
-static Expr affineDefault(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
-  // general version, MKL, CBlas or CUDA
-
-  // if clipValue > 0, the inputs will be clipped to range [-clipValue,
-  // clipValue] This is meant to keep values at the same range as used during
-  // training when optimizing for 8-bit integer products. Likely to be removed
-  // in the future when we explore better ways to handle this.
-  float clipValue = a->graph()->getBackend()->getClip();
-
-  int rows = a->shape().elements() / a->shape()[-1];
-  Expr ones = a->graph()->ones({ rows, 1 });
-  std::vector<Expr> nodes
-    = { clip(a, clipValue), clip(b, clipValue), bias, ones };
-  return Expression<AffineNodeOp>(nodes, transA, transB, scale);
-}
-
-// This operation used to implement auto-tuning. We have removed it for now due to complexity, but plan to revisit it in the future. 
-// The last branch with auto-tuner is: 
-// youki/packed-model-pr-backup1031
-// https://machinetranslation.visualstudio.com/Marian/_git/marian-dev?version=GByouki%2Fpacked-model-pr-backup1031
-// SHA: 3456a7ed1d1608cfad74cd2c414e7e8fe141aa52
 Expr affine(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
   auto device = a->graph()->getDeviceId().type;
 
@@ -551,7 +628,9 @@ Expr affine(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
 
   if(device == DeviceType::cpu) {
     if(isFloat(aElementType) && isFloat(bElementType)) {
-      if(a->graph()->getBackend()->isOptimized()) {
+      if(a->graph()->getBackend()->isAutotune()) {
+        return gemmAutotuned(a, b, bias, transA, transB, scale);
+      } else if(a->graph()->getBackend()->isOptimized()) {
         // cpu int16 version
         return cpu::int16::affine(
           cpu::int16::quantize(transA ? transpose(a) : a, clipValue),
@@ -561,6 +640,13 @@ Expr affine(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
       } else {
         return affineDefault(a, b, bias, transA, transB, scale);
       }
+    } else if(isFloat(aElementType) && isIntgemm(bElementType)) {
+      return cpu::int16::affinePrepared(clip(transA ? transpose(a) : a, clipValue),
+                                        b,
+                                        bias,
+                                        transB,
+                                        scale,
+                                        cpu::variant::quantRangeA(b));
     } else if(isFloat(aElementType) && isPacked(bElementType)) {
 #if USE_FBGEMM
       // 07/10/2019 - Use packed GEMM only if the cpu architecture supports AVX2
@@ -595,6 +681,26 @@ Expr affine(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
   }
 }
 
+Expr affineSelect(Expr a, Expr b, Expr bias, const std::vector<IndexType>& indices, bool transB, float scale) {
+  if(a->graph()->getDeviceId().type == DeviceType::cpu && isFloat(a->value_type()) && isIntgemm(b->value_type())) {
+    // the kernel gathers the selected columns from the prepared tiles
+    float clipValue = a->graph()->getBackend()->getClip();
+    return cpu::int16::affinePreparedSelect(clip(a, clipValue),
+                                            b,
+                                            bias,
+                                            a->graph()->indices(indices),
+                                            transB,
+                                            scale,
+                                            cpu::variant::quantRangeA(b));
+  }
+
+  auto bSelected = index_select(b, transB ? 0 : -1, indices);
+  if(bias)
+    return affine(a, bSelected, index_select(bias, -1, indices), false, transB, scale);
+  else
+    return dot(a, bSelected, false, transB, scale);
+}
+
 // multiply a CSR matrix A with a matrix B
 // A[i,j] is at A_values[A_offsets[i]+k], where k is position of j in A_indices[A_offsets[i]:A_offsets[i+1]]
 // @TODO: Define a proper sparse tensor type.
@@ -149,6 +149,16 @@ Expr affine(Expr a,
             bool transB = false,
             float scalar = 1.f);
 
+// affine(a, index_select(b, transB ? 0 : -1, indices), index_select(bias, -1, indices), false, transB),
+// i.e. only the output columns in indices, e.g. of a vocabulary shortlist. A weight matrix b prepared as
+// int8 (Type::intgemm8) is multiplied directly, without gathering a sub-matrix. bias may be nullptr.
+Expr affineSelect(Expr a,
+                  Expr b,
+                  Expr bias,
+                  const std::vector<IndexType>& indices,
+                  bool transB = false,
+                  float scalar = 1.f);
+
 Expr csr_dot(const Shape& A_shape, Expr Avalues, Expr Aindices, Expr Aoffsets, Expr B, bool transA = false);
 Expr dot_csr(Expr A, const Shape& B_shape, Expr B_values, Expr B_indices, Expr B_offsets, bool transB = false);
 
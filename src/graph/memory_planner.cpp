@@ -0,0 +1,219 @@
+#include "graph/memory_planner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace marian {
+
+size_t MemoryPlanner::alignedBytes(Expr node) const {
+  size_t bytes = requiredBytes(node->shape(), node->value_type());
+  return (size_t)(std::ceil(bytes / (double)alignment_) * alignment_);
+}
+
+void MemoryPlanner::plan(const std::list<Expr>& forwardTape,
+                         const std::list<Expr>& backwardTape,
+                         bool inferenceOnly) {
+  const size_t NONE = std::numeric_limits<size_t>::max();
+
+  intervals_.clear();
+
+  // nodes in order of the forward tape, children always come before their parents
+  std::vector<Expr> nodes(forwardTape.begin(), forwardTape.end());
+  std::unordered_map<Chainable<Tensor>*, size_t> forwardStep;
+  for(size_t i = 0; i < nodes.size(); ++i)
+    forwardStep[nodes[i].get()] = i;
+
+  std::unordered_map<Chainable<Tensor>*, std::vector<size_t>> parents; // indices into nodes
+  for(size_t i = 0; i < nodes.size(); ++i)
+    for(auto& child : nodes[i]->children())
+      if(forwardStep.count(child.get()) > 0)
+        parents[child.get()].push_back(i);
+
+  // the backward tape is processed from the back
+  std::unordered_map<Chainable<Tensor>*, size_t> backwardStep;
+  if(!inferenceOnly) {
+    size_t step = nodes.size();
+    for(auto it = backwardTape.rbegin(); it != backwardTape.rend(); ++it)
+      backwardStep[it->get()] = step++;
+  }
+  steps_ = nodes.size() + backwardStep.size();
+  if(steps_ == 0)
+    return;
+
+  // Visit parents before children to determine when a node is released and when its gradient is
+  // allocated. A node is referenced by the tapes until it has been executed, by its parents until
+  // they clear their children after execution (views keep their viewed node for their own lifetime)
+  // and by the caller if it has no parents.
+  std::vector<size_t> release(nodes.size());
+  std::vector<size_t> gradAlloc(nodes.size(), NONE);
+  for(size_t i = nodes.size(); i-- > 0;) {
+    auto node = nodes[i].get();
+    auto bwd = backwardStep.find(node);
+
+    size_t end = bwd != backwardStep.end() ? bwd->second : i;
+    auto it = parents.find(node);
+    if(it == parents.end()) {
+      end = steps_ - 1;
+      if(bwd != backwardStep.end()) // top node, its gradient is initialized first
+        gradAlloc[i] = nodes.size();
+    } else {
+      for(auto p : it->second) {
+        auto parent = nodes[p].get();
+        auto parentBwd = backwardStep.find(parent);
+        if(parent->isView())
+          end = std::max(end, release[p]);
+        else if(inferenceOnly) // children are cleared right after the forward step
+          end = std::max(end, p);
+        else if(parentBwd == backwardStep.end()) // not on the backward tape, keeps its children until released
+          end = std::max(end, release[p]);
+        else
+          end = std::max(end, parentBwd->second);
+
+        // the gradient is zero-initialized when the first parent runs backward, views pass this on
+        if(bwd != backwardStep.end() && node->type() != "param") {
+          size_t alloc = parent->isView() ? gradAlloc[p] : (parentBwd != backwardStep.end() ? parentBwd->second : NONE);
+          gradAlloc[i] = std::min(gradAlloc[i], alloc);
+        }
+      }
+    }
+    release[i] = end;
+  }
+
+  for(size_t i = 0; i < nodes.size(); ++i) {
+    auto& node = nodes[i];
+    if(node->isView() || node->type() == "param" || node->memoize())
+      continue; // no workspace memory of their own
+    size_t bytes = alignedBytes(node);
+    if(!node->val())
+      intervals_.push_back({node, /*grad=*/false, bytes, i, release[i], /*offset=*/0});
+    if(gradAlloc[i] != NONE && !node->grad())
+      intervals_.push_back({node, /*grad=*/true, bytes, gradAlloc[i], std::max(gradAlloc[i], release[i]), /*offset=*/0});
+  }
+}
+
+std::vector<bool> MemoryPlanner::outliving(std::vector<Expr>& nodes) {
+  // Within the graph a node is referenced by the tape, by its parents' children and additionally by
+  // parents that view its memory. Any other reference is external. Nodes without parents are kept,
+  // their value is the result of the pass.
+  std::unordered_map<Chainable<Tensor>*, size_t> index;
+  for(size_t i = 0; i < nodes.size(); ++i)
+    index[nodes[i].get()] = i;
+
+  std::vector<size_t> internalRefs(nodes.size(), 2); // the tape and nodes above
+  std::vector<std::vector<size_t>> viewParents(nodes.size());
+  std::vector<bool> hasParents(nodes.size(), false);
+  for(size_t i = 0; i < nodes.size(); ++i) {
+    for(auto& child : nodes[i]->children()) {
+      auto it = index.find(child.get());
+      if(it == index.end())
+        continue;
+      hasParents[it->second] = true;
+      internalRefs[it->second]++;
+      if(nodes[i]->isView()) {
+        internalRefs[it->second]++;
+        viewParents[it->second].push_back(i);
+      }
+    }
+  }
+
+  std::vector<bool> pinned(nodes.size());
+  for(size_t i = nodes.size(); i-- > 0;) { // parents first
+    pinned[i] = !hasParents[i] || nodes[i].useCount() > internalRefs[i];
+    for(auto p : viewParents[i]) // a view keeps the viewed node alive
+      pinned[i] = pinned[i] || pinned[p];
+  }
+  return pinned;
+}
+
+size_t MemoryPlanner::planArena(const std::list<Expr>& forwardTape) {
+  // find nodes that may outlive the forward pass
+  std::vector<Expr> nodes(forwardTape.begin(), forwardTape.end());
+  std::unordered_map<Chainable<Tensor>*, size_t> index;
+  for(size_t i = 0; i < nodes.size(); ++i)
+    index[nodes[i].get()] = i;
+  auto pinned = outliving(nodes);
+
+  plan(forwardTape, {}, /*inferenceOnly=*/true);
+  intervals_.erase(std::remove_if(intervals_.begin(), intervals_.end(), [&](const Interval& interval) {
+    return pinned[index[interval.node.get()]];
+  }), intervals_.end());
+
+  // place largest tensors first, each at the lowest offset that does not overlap with an already
+  // placed tensor that is alive at the same time
+  std::vector<size_t> order(intervals_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return intervals_[a].bytes > intervals_[b].bytes;
+  });
+
+  arenaBytes_ = 0;
+  std::vector<size_t> placed;
+  for(auto i : order) {
+    auto& interval = intervals_[i];
+
+    std::vector<std::pair<size_t, size_t>> occupied; // [offset, offset + bytes) of overlapping tensors
+    for(auto j : placed) {
+      const auto& other = intervals_[j];
+      if(other.begin <= interval.end && interval.begin <= other.end)
+        occupied.push_back({other.offset, other.offset + other.bytes});
+    }
+    std::sort(occupied.begin(), occupied.end());
+
+    size_t offset = 0;
+    for(const auto& range : occupied) {
+      if(range.first >= offset + interval.bytes)
+        break; // fits into the gap before this range
+      offset = std::max(offset, range.second);
+    }
+
+    interval.offset = offset;
+    arenaBytes_ = std::max(arenaBytes_, offset + interval.bytes);
+    placed.push_back(i);
+  }
+  return arenaBytes_;
+}
+
+std::vector<size_t> MemoryPlanner::arenaSignature(const std::list<Expr>& forwardTape) const {
+  const size_t NONE = std::numeric_limits<size_t>::max();
+
+  std::vector<Expr> nodes(forwardTape.begin(), forwardTape.end());
+  std::unordered_map<Chainable<Tensor>*, size_t> index;
+  for(size_t i = 0; i < nodes.size(); ++i)
+    index[nodes[i].get()] = i;
+  auto pinned = outliving(nodes);
+
+  std::vector<size_t> signature;
+  for(size_t i = 0; i < nodes.size(); ++i) {
+    const auto& node = nodes[i];
+    size_t flags = (size_t)node->isView() | (size_t)(node->type() == "param") << 1 | (size_t)node->memoize() << 2
+                   | (size_t)(node->val() != nullptr) << 3 | (size_t)pinned[i] << 4;
+    signature.push_back(alignedBytes(node));
+    signature.push_back(flags);
+    signature.push_back(node->children().size());
+    for(auto& child : node->children()) {
+      auto it = index.find(child.get());
+      signature.push_back(it != index.end() ? it->second : NONE);
+    }
+  }
+  return signature;
+}
+
+size_t MemoryPlanner::peakBytes() const {
+  std::vector<long long> delta(steps_ + 1, 0);
+  for(const auto& interval : intervals_) {
+    delta[interval.begin]   += (long long)interval.bytes;
+    delta[interval.end + 1] -= (long long)interval.bytes;
+  }
+
+  long long current = 0, peak = 0;
+  for(auto d : delta) {
+    current += d;
+    peak = std::max(peak, current);
+  }
+  return (size_t)peak;
+}
+
+}  // namespace marian
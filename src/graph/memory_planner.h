@@ -0,0 +1,80 @@
+#pragma once
+
+#include "graph/node.h"
+
+#include <list>
+#include <vector>
+
+namespace marian {
+
+/**
+ * Shape-only planner for the workspace memory of an expression graph.
+ *
+ * Simulates the allocations and de-allocations that ExpressionGraph::forward() and
+ * ExpressionGraph::backward() perform on the workspace for the current tapes without
+ * executing any kernels or touching device memory. Values are allocated when a node is
+ * executed on the forward tape, gradients when they are first needed on the backward tape,
+ * and both are released once no node that is still alive references the node anymore.
+ *
+ * Not covered are parameters and memoized nodes (which live in their own memory), scratch
+ * memory that operators allocate internally, fragmentation of the workspace and the memory
+ * savings of gradient checkpointing. The peak is hence an estimate and callers should keep
+ * a safety margin.
+ */
+class MemoryPlanner {
+public:
+  // lifetime of one tensor in the workspace, in steps of the simulated tapes (both inclusive)
+  struct Interval {
+    Expr node;    // node that owns the tensor
+    bool grad;    // gradient (true) or value (false) of the node
+    size_t bytes; // size including alignment padding
+    size_t begin; // step in which the tensor is allocated
+    size_t end;   // last step in which the tensor is alive
+    size_t offset; // position in the arena, see planArena()
+  };
+
+private:
+  size_t alignment_;
+  size_t steps_{0};
+  std::vector<Interval> intervals_;
+  size_t arenaBytes_{0};
+
+  size_t alignedBytes(Expr node) const;
+
+  // nodes of forwardTape that may outlive the forward pass, see planArena()
+  static std::vector<bool> outliving(std::vector<Expr>& nodes);
+
+public:
+  MemoryPlanner(size_t alignment = 256) : alignment_(alignment) {}
+
+  // Computes the lifetimes of all workspace tensors for executing forwardTape and, unless
+  // inferenceOnly, backwardTape afterwards. Steps [0, forwardTape.size()) are forward steps,
+  // the following ones backward steps. The tapes are not modified.
+  void plan(const std::list<Expr>& forwardTape, const std::list<Expr>& backwardTape, bool inferenceOnly);
+
+  const std::vector<Interval>& intervals() const { return intervals_; }
+
+  // number of simulated steps
+  size_t steps() const { return steps_; }
+
+  // maximum number of bytes alive at the same time over all steps
+  size_t peakBytes() const;
+
+  // Plans one arena for running forwardTape in an inference graph. Every value tensor that is
+  // released during the forward pass gets a fixed offset in the arena, such that tensors which are
+  // alive at the same time do not overlap (greedy interval coloring, largest tensors first).
+  // Tensors that may outlive the pass, i.e. of nodes that are still referenced from outside the
+  // tape, e.g. by the caller or by scorer states, are left out and have to be allocated as usual.
+  // Returns the size of the arena, intervals() then holds the placed tensors.
+  size_t planArena(const std::list<Expr>& forwardTape);
+
+  // Everything planArena() depends on, i.e. for every node of forwardTape its size, the positions of
+  // its children on the tape and whether it is a view, has its own memory or may outlive the pass.
+  // Tapes with equal signatures get the same arena plan (with Interval::begin as the tape position),
+  // so a plan can be reused for all forward passes of the same shapes.
+  std::vector<size_t> arenaSignature(const std::list<Expr>& forwardTape) const;
+
+  size_t arenaBytes() const { return arenaBytes_; }
+};
+
+}  // namespace marian
@@ -82,6 +82,8 @@ public:
   virtual bool memoize() override { return memoize_; };
   virtual void setMemoize(bool memoize) override { memoize_ = memoize; };
 
+  virtual bool isView() const override { return !destroy_; }
+
   virtual void setId(size_t id) override { id_ = id; }
 
   virtual size_t getId() override { return id_; }
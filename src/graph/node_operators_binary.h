@@ -662,10 +662,14 @@ struct ScalarProductNodeOp : public NaryNodeOp {
   int axis_;
 };
 
+// Row lookup, e.g. of embeddings. Rows of row-quantized int8 matrices (Type::rowquant8) are
+// dequantized into float32 while they are gathered.
 struct RowsNodeOp : public NaryNodeOp {
   RowsNodeOp(Expr a, Expr indices)
-    : NaryNodeOp({a, indices}, newShape(a, indices), a->value_type()) {
+    : NaryNodeOp({a, indices}, newShape(a, indices), isRowQuant(a->value_type()) ? Type::float32 : a->value_type()) {
       matchOrAbort<IndexType>(indices->value_type());
+      ABORT_IF(isRowQuant(a->value_type()) && a->graph()->getDeviceId().type != DeviceType::cpu,
+               "Row-quantized matrices ({}) are only supported on the CPU", a->name());
   }
 
   NodeOps forwardOps() override {
@@ -674,6 +678,7 @@ struct RowsNodeOp : public NaryNodeOp {
   }
 
   NodeOps backwardOps() override {
+    ABORT_IF(isRowQuant(child(0)->value_type()), "Row-quantized matrices do not support gradients");
     return {NodeOp(PasteRows(child(0)->grad(), adj_, child(1)->val()))};
   }
 
@@ -0,0 +1,49 @@
+#include "graph/parameter_store.h"
+#include "common/binary.h"
+#include "common/io.h"
+#include "common/logging.h"
+
+#include <cmath>
+
+namespace marian {
+
+std::mutex ParameterStore::mutex_;
+std::map<std::tuple<std::string, Type, int, size_t>, Weak<ParameterStore::Model>> ParameterStore::models_;
+
+ParameterStore::Model::Model(const std::string& fileName, Type elementType) {
+  auto items = io::loadItems(fileName);
+  for(auto& item : items) {
+    if(item.name.substr(0, 8) != "special:" && isSameTypeClass(item.type, elementType))
+      item.convert(elementType);
+
+    // pad to 256 bytes, so every item starts at an aligned address in the serialized model
+    size_t multiplier = (size_t)std::ceil((float)item.bytes.size() / (float)256);
+    item.bytes.resize(multiplier * 256);
+  }
+
+  size_ = io::binary::saveItems(nullptr, items);
+  memory_ = New<cpu::Device>(DeviceId(0, DeviceType::cpu), /*alignment=*/256);
+  memory_->reserve(size_);
+  io::binary::saveItems((char*)memory_->data(), items);
+}
+
+Ptr<ParameterStore::Model> ParameterStore::get(const std::string& fileName,
+                                               Type elementType,
+                                               int numaNode,
+                                               size_t generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto key = std::make_tuple(fileName, elementType, numaNode, generation);
+  auto model = models_[key].lock();
+  if(!model) {
+    if(numaNode >= 0)
+      LOG(info, "Loading model from {} into shared parameter store as {} for NUMA node {}", fileName, elementType, numaNode);
+    else
+      LOG(info, "Loading model from {} into shared parameter store as {}", fileName, elementType);
+    model = New<Model>(fileName, elementType);
+    models_[key] = model;
+  }
+  return model;
+}
+
+}  // namespace marian
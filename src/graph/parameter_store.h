@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common/definitions.h"
+#include "common/types.h"
+#include "tensors/device.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace marian {
+
+// Process-wide read-only store of model files for CPU inference. Each model file is loaded once per
+// element type and kept in memory in the binary model format (256-byte aligned). CPU graphs memory-map
+// that shared copy (see ExpressionGraph::mmap) instead of allocating their own parameters, so N CPU
+// workers and ensemble members loading the same file hold only one copy of the weights. This includes
+// weights that were packed offline by marian-conv, which are hence packed and stored once.
+// A model is released when the last user drops its pointer.
+//
+// With pinned CPU workers (--cpu-affinity) the store keeps one copy per NUMA node. A copy is written by
+// the first worker of its node asking for it, so its pages are local to that node.
+class ParameterStore {
+public:
+  class Model {
+  private:
+    Ptr<Device> memory_;
+    size_t size_;
+
+  public:
+    Model(const std::string& fileName, Type elementType);
+
+    // pointer to the model in binary format, can be passed to ExpressionGraph::mmap(...)
+    const void* data() const { return memory_->data(); }
+    size_t size() const { return size_; }
+  };
+
+  // Returns the shared copy of the model, loading it if it is not in the store yet.
+  // Parameters of the same type class as elementType are converted to elementType,
+  // others (e.g. packed or int8 types) are kept as they are. numaNode selects the per-node
+  // copy, -1 for one copy without placement. A new generation reads the file again, e.g. when the
+  // server reloads a changed model while the previous copy is still in use.
+  static Ptr<Model> get(const std::string& fileName, Type elementType, int numaNode = -1, size_t generation = 0);
+
+private:
+  static std::mutex mutex_;
+  static std::map<std::tuple<std::string, Type, int, size_t>, Weak<Model>> models_;
+};
+
+}  // namespace marian
@@ -8,6 +8,8 @@
 #include "models/states.h" // for EncoderState
 #include "layers/lsh.h"
 
+#include <numeric>
+
 namespace marian {
   Logits::Logits(Expr logits) : Logits(New<RationalLoss>(logits, nullptr)) {} // single-output constructor from Expr only (RationalLoss has no count)
 
@@ -281,7 +283,10 @@ namespace marian {
         }
       };
 
-      if (shortlist_ && !cachedShortWt_) { // shortlisted versions of parameters are cached within one batch, then clear()ed
+      // int8 prepared output weights (marian-conv --gemm-type intgemm8) are multiplied with the shortlisted rows directly
+      bool selectPrepared = shortlist_ && !factoredVocab_ && !lsh_ && isIntgemm(Wt_->value_type());
+
+      if (shortlist_ && !cachedShortWt_ && !selectPrepared) { // shortlisted versions of parameters are cached within one batch, then clear()ed
         cachedShortWt_  = index_select(Wt_, isLegacyUntransposedW ? -1 : 0, shortlist_->indices());
         if(hasBias_)
           cachedShortb_ = index_select(b_ ,                             -1, shortlist_->indices());
@@ -427,8 +432,17 @@ namespace marian {
           }
         }
         return Logits(std::move(allLogits), factoredVocab_);
+      } else if (selectPrepared) {
+        return Logits(affineSelect(input, Wt_, b_, shortlist_->indices(), /*transB=*/isLegacyUntransposedW ? false : true));
       } else if (shortlist_) {
         return Logits(affineOrLSH(input, cachedShortWt_, cachedShortb_, false, /*transB=*/isLegacyUntransposedW ? false : true));
+      } else if (isRowQuant(Wt_->value_type())) {
+        // int8 embeddings tied to the output layer (marian-conv --embedding-type int8) can only be
+        // multiplied after dequantizing them, which the shortlist above does for the selected rows only
+        LOG_ONCE(warn, "[embedding] Dequantizing the int8 output embeddings for the full vocabulary in every step, use a shortlist for speed");
+        std::vector<IndexType> allRows(Wt_->shape()[0]);
+        std::iota(allRows.begin(), allRows.end(), 0);
+        return Logits(affineOrLSH(input, rows(Wt_, allRows), b_, false, /*transB=*/true));
       } else {
         return Logits(affineOrLSH(input, Wt_, b_, false, /*transB=*/isLegacyUntransposedW ? false : true));
       }
@@ -466,6 +480,7 @@ namespace marian {
   // helper to embed a sequence of words (given as indices) via factored embeddings
   /*private*/ Expr Embedding::multiRows(const Words& data, float dropProb) const
   {
+    ABORT_IF(isRowQuant(E_->value_type()), "Factored embeddings cannot be row-quantized");
     auto graph = E_->graph();
     auto factoredData = factoredVocab_->csr_rows(data);
     // multi-hot factor vectors are represented as a sparse CSR matrix
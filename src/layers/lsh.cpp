@@ -3,16 +3,363 @@
 #include "tensors/cpu/prod_blas.h"
 
 #if BLAS_FOUND
-#include "3rd_party/faiss/IndexLSH.h"
+#include "3rd_party/faiss/VectorTransform.h"
+#endif
+
+#include <immintrin.h>
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+// The Hamming distance kernels are compiled for AVX2 and AVX512 independently of the global compiler
+// flags and selected at runtime, like the prepared int8 GEMM (tensors/cpu/sharp/prepared_int8_gemm.cpp).
+#if defined(_MSC_VER)
+#define TARGET_AVX2
+#define TARGET_AVX512VPOPCNTDQ
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512VPOPCNTDQ __attribute__((target("avx512f,avx512vpopcntdq")))
+#endif
+
+// avx512vpopcntdq is known to GCC from version 7 on
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 7
+#define NO_AVX512VPOPCNTDQ 1
 #endif
 
 namespace marian {
 
+namespace lsh {
+
+int bytesPerCode(int nbits) {
+  return (nbits + 63) / 64 * 8;
+}
+
+std::vector<float> randomRotation(int dim, int nbits) {
+#if BLAS_FOUND
+  faiss::RandomRotationMatrix rrot(dim, nbits);
+  rrot.init(5); // seed of faiss::IndexLSH, keeps the hashes of indexes built by earlier versions
+  return rrot.A;
+#else
+  dim; nbits;
+  ABORT("LSH output layer requires a CPU BLAS library");
+#endif
+}
+
+void encode(const float* x, int rows, int dim, const float* rotation, int nbits, uint8_t* codes) {
+  ABORT_IF(!rotation && nbits != dim, "LSH with {} bits for vector dim {} requires a rotation", nbits, dim);
+  int bytes = bytesPerCode(nbits);
+  std::memset(codes, 0, (size_t)rows * bytes);
+
+  // rotate blocks of rows to bound the size of the temporary buffer
+  const int blockRows = 256;
+  std::vector<float> rotated(rotation ? (size_t)std::min(rows, blockRows) * nbits : 0);
+  for(int row0 = 0; row0 < rows; row0 += blockRows) {
+    int n = std::min(blockRows, rows - row0);
+    const float* y = x + (size_t)row0 * dim;
+    if(rotation) {
+#if BLAS_FOUND
+      sgemm(false, true, n, nbits, dim, 1.0f, const_cast<float*>(y), dim,
+            const_cast<float*>(rotation), dim, 0.0f, rotated.data(), nbits);
+      y = rotated.data();
+#endif
+    }
+    for(int i = 0; i < n; ++i) {
+      const float* yi = y + (size_t)i * nbits;
+      uint8_t* code = codes + (size_t)(row0 + i) * bytes;
+      for(int j = 0; j < nbits; ++j)
+        if(yi[j] >= 0)
+          code[j / 8] |= (uint8_t)(1 << (j % 8));
+    }
+  }
+}
+
+namespace {
+
+enum class HammingKernel { scalar, avx2, avx512vpopcntdq };
+
+void cpuid(int info[4], int leaf, int subleaf) {
+#if defined(_MSC_VER)
+  __cpuidex(info, leaf, subleaf);
+#elif defined(__GNUC__)
+  unsigned int a, b, c, d;
+  __cpuid_count(leaf, subleaf, a, b, c, d);
+  info[0] = (int)a; info[1] = (int)b; info[2] = (int)c; info[3] = (int)d;
+#else
+  info[0] = info[1] = info[2] = info[3] = 0;
+#endif
+}
+
+uint64_t xgetbv() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#elif defined(__GNUC__)
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t)edx << 32) | eax;
+#else
+  return 0;
+#endif
+}
+
+HammingKernel detectKernel() {
+  int info[4];
+  cpuid(info, 0, 0);
+  if(info[0] < 7)
+    return HammingKernel::scalar;
+
+  cpuid(info, 1, 0);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  if(!osxsave)
+    return HammingKernel::scalar;
+  uint64_t xcr0 = xgetbv();
+
+  cpuid(info, 7, 0);
+  bool avx2            = (info[1] & (1 << 5)) != 0;
+  bool avx512f         = (info[1] & (1 << 16)) != 0;
+  bool avx512vpopcntdq = (info[2] & (1 << 14)) != 0;
+
+#ifndef NO_AVX512VPOPCNTDQ
+  // the OS has to save the opmask and all zmm registers on context switches
+  if(avx512f && avx512vpopcntdq && (xcr0 & 0xE6) == 0xE6)
+    return HammingKernel::avx512vpopcntdq;
+#else
+  (void)avx512f; (void)avx512vpopcntdq;
+#endif
+  if(avx2 && (xcr0 & 0x6) == 0x6)
+    return HammingKernel::avx2;
+  return HammingKernel::scalar;
+}
+
+HammingKernel selectedKernel() {
+  static const HammingKernel kernel = detectKernel();
+  return kernel;
+}
+
+inline int popcount64(uint64_t x) {
+#if defined(__GNUC__)
+  return __builtin_popcountll(x);
+#else
+  return (int)std::bitset<64>(x).count();
+#endif
+}
+
+// Hamming distance of two codes of words 64-bit words. Codes of mapped models are not necessarily
+// aligned, hence the unaligned loads.
+struct HammingScalar {
+  static inline int distance(const uint8_t* a, const uint8_t* b, int words) {
+    int distance = 0;
+    for(int i = 0; i < words; ++i) {
+      uint64_t x, y;
+      std::memcpy(&x, a + 8 * i, sizeof(x));
+      std::memcpy(&y, b + 8 * i, sizeof(y));
+      distance += popcount64(x ^ y);
+    }
+    return distance;
+  }
+};
+
+struct HammingAvx2 {
+  TARGET_AVX2 static inline int distance(const uint8_t* a, const uint8_t* b, int words) {
+    // popcount of each nibble by table lookup, summed up per 64-bit lane
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    __m256i acc256 = _mm256_setzero_si256();
+    int i = 0;
+    for(; i + 4 <= words; i += 4) {
+      __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + 8 * i)),
+                                   _mm256_loadu_si256((const __m256i*)(b + 8 * i)));
+      __m256i lo = _mm256_and_si256(x, lowMask);
+      __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), lowMask);
+      __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+      acc256 = _mm256_add_epi64(acc256, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+    }
+    int distance = (int)(_mm256_extract_epi64(acc256, 0) + _mm256_extract_epi64(acc256, 1)
+                       + _mm256_extract_epi64(acc256, 2) + _mm256_extract_epi64(acc256, 3));
+    return distance + HammingScalar::distance(a + 8 * i, b + 8 * i, words - i);
+  }
+};
+
+#ifndef NO_AVX512VPOPCNTDQ
+struct HammingAvx512vpopcntdq {
+  TARGET_AVX512VPOPCNTDQ static inline int distance(const uint8_t* a, const uint8_t* b, int words) {
+    __m512i acc512 = _mm512_setzero_si512();
+    int i = 0;
+    for(; i + 8 <= words; i += 8) {
+      __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + 8 * i), _mm512_loadu_si512(b + 8 * i));
+      acc512 = _mm512_add_epi64(acc512, _mm512_popcnt_epi64(x));
+    }
+    // summed through memory, _mm512_reduce_add_epi64 trips -Wuninitialized in the headers of GCC 12
+    alignas(64) int64_t lanes[8];
+    _mm512_store_si512(lanes, acc512);
+    int distance = 0;
+    for(int j = 0; j < 8; ++j)
+      distance += (int)lanes[j];
+    return distance + HammingAvx2::distance(a + 8 * i, b + 8 * i, words - i);
+  }
+};
+#endif
+
+struct DistanceArgs {
+  const uint8_t* queries; // n query codes
+  int n;
+  const uint8_t* codes;   // numCodes codes
+  int numCodes;
+  int words;              // 64-bit words per code
+  uint16_t* distances;    // n x numCodes
+};
+
+// The distances of a block of queries are computed in one pass over the codes, so that every code
+// is loaded once per block instead of once per query
+template <class Hamming>
+inline void blockDistances(const DistanceArgs& args) {
+  size_t bytes = (size_t)args.words * 8;
+  for(int c = 0; c < args.numCodes; ++c) {
+    const uint8_t* code = args.codes + c * bytes;
+    for(int q = 0; q < args.n; ++q)
+      args.distances[(size_t)q * args.numCodes + c]
+          = (uint16_t)Hamming::distance(args.queries + q * bytes, code, args.words);
+  }
+}
+
+void scalarDistances(const DistanceArgs& args) {
+  blockDistances<HammingScalar>(args);
+}
+
+TARGET_AVX2 void avx2Distances(const DistanceArgs& args) {
+  blockDistances<HammingAvx2>(args);
+}
+
+#ifndef NO_AVX512VPOPCNTDQ
+TARGET_AVX512VPOPCNTDQ void avx512vpopcntdqDistances(const DistanceArgs& args) {
+  blockDistances<HammingAvx512vpopcntdq>(args);
+}
+#endif
+
+}  // namespace
+
+void search(const uint8_t* queries, int numQueries,
+            const uint8_t* codes, int numCodes,
+            int nbits, int k, IndexType* ids) {
+  ABORT_IF(k > numCodes, "Cannot search for {} nearest neighbors among {} vectors", k, numCodes);
+  ABORT_IF(nbits > 65535, "LSH supports at most 65535 bits, not {}", nbits);
+  int bytes = bytesPerCode(nbits);
+  int words = bytes / 8;
+
+  const int blockQueries = 16;
+  std::vector<uint16_t> distances((size_t)std::min(numQueries, blockQueries) * numCodes);
+  std::vector<int> offsets(nbits + 1);
+
+  for(int q0 = 0; q0 < numQueries; q0 += blockQueries) {
+    int n = std::min(blockQueries, numQueries - q0);
+    DistanceArgs args{queries + (size_t)q0 * bytes, n, codes, numCodes, words, distances.data()};
+    switch(selectedKernel()) {
+#ifndef NO_AVX512VPOPCNTDQ
+      case HammingKernel::avx512vpopcntdq: avx512vpopcntdqDistances(args); break;
+#endif
+      case HammingKernel::avx2:            avx2Distances(args); break;
+      default:                             scalarDistances(args); break;
+    }
+
+    // distances are bounded by nbits, so the k smallest are selected with a counting sort
+    for(int q = 0; q < n; ++q) {
+      const uint16_t* dist = distances.data() + (size_t)q * numCodes;
+      IndexType* out = ids + (size_t)(q0 + q) * k;
+
+      std::fill(offsets.begin(), offsets.end(), 0);
+      for(int c = 0; c < numCodes; ++c)
+        offsets[dist[c]]++;
+      int start = 0;
+      for(auto& offset : offsets) { // histogram to first output position of each distance
+        int count = offset;
+        offset = start;
+        start += count;
+      }
+      for(int c = 0; c < numCodes; ++c) {
+        int& pos = offsets[dist[c]];
+        if(pos < k)
+          out[pos++] = (IndexType)c;
+      }
+    }
+  }
+}
+
+std::vector<io::Item> indexItems(const std::string& name, const std::vector<float>& values, int dim, int nbits) {
+  int rows = (int)(values.size() / dim);
+  std::vector<io::Item> items;
+
+  std::vector<float> rotation;
+  if(nbits != dim) {
+    rotation = randomRotation(dim, nbits);
+
+    io::Item item;
+    item.name = name + "_lsh_rotation";
+    item.shape = Shape({nbits, dim});
+    item.type = Type::float32;
+    item.bytes.resize(rotation.size() * sizeof(float));
+    std::copy((char*)rotation.data(), (char*)rotation.data() + item.bytes.size(), item.bytes.data());
+    items.emplace_back(std::move(item));
+  }
+
+  io::Item item;
+  item.name = name + "_lsh_codes";
+  item.shape = Shape({rows, bytesPerCode(nbits)});
+  item.type = Type::uint8;
+  item.bytes.resize((size_t)rows * bytesPerCode(nbits));
+  encode(values.data(), rows, dim, rotation.empty() ? nullptr : rotation.data(), nbits, (uint8_t*)item.bytes.data());
+  items.emplace_back(std::move(item));
+
+  return items;
+}
+
+}  // namespace lsh
+
 Expr LSH::apply(Expr input, Expr W, Expr b) {
   auto idx = search(input, W);
   return affine(idx, input, W, b);
 }
 
+// Index precomputed by marian-conv for values, empty if the model has none or it does not match
+// the current --output-approx-knn settings
+std::vector<Expr> LSH::storedIndex(Expr values) {
+  if(values->type() != "param")
+    return {};
+
+  // graph->get() prepends the current namespace (e.g. of an ensemble member) itself
+  std::string name = values->name();
+  auto pos = name.rfind("::");
+  if(pos != std::string::npos)
+    name = name.substr(pos + 2);
+
+  auto graph = values->graph();
+  auto codes = graph->get(name + "_lsh_codes");
+  if(!codes)
+    return {};
+  auto rotation = graph->get(name + "_lsh_rotation");
+
+  int dim  = values->shape()[-1];
+  int rows = values->shape().elements() / dim;
+  bool matches = codes->value_type() == Type::uint8
+                 && codes->shape()[-2] == rows
+                 && codes->shape()[-1] == lsh::bytesPerCode(nbits_)
+                 && (nbits_ == dim ? !rotation : rotation && rotation->shape()[-2] == nbits_ && rotation->shape()[-1] == dim);
+  if(!matches) {
+    LOG_ONCE(warn, "LSH index {}_lsh_codes in the model does not match {} bits, building a new one", name, nbits_);
+    return {};
+  }
+
+  // the search reads the rotation as float32, it is converted e.g. when loaded with --precision float16
+  if(rotation)
+    return {codes, rotation->value_type() == Type::float32 ? rotation : cast(rotation, Type::float32)};
+  return {codes};
+}
+
 Expr LSH::search(Expr query, Expr values) {
 #if BLAS_FOUND
   ABORT_IF(query->graph()->getDeviceId().type == DeviceType::gpu,
@@ -25,35 +372,44 @@ Expr LSH::search(Expr query, Expr values) {
     auto query  = inputs[0];
     auto values = inputs[1];
 
-    int dim = values->shape()[-1];
-
-    if(!index_ || indexHash_ != values->hash()) {
-      LOG(info, "Building LSH index for vector dim {} and with hash size {} bits", dim, nbits_);
-      index_.reset(new faiss::IndexLSH(dim, nbits_, 
-                                       /*rotate=*/dim != nbits_, 
-                                       /*train_thesholds*/false));
-      int vRows = values->shape().elements() / dim;
-      index_->train(vRows, values->val()->data<float>());
-      index_->add(  vRows, values->val()->data<float>());
-      indexHash_ = values->hash();
+    int dim   = values->shape()[-1];
+    int vRows = values->shape().elements() / dim;
+
+    const uint8_t* codes;
+    const float* rotation;
+    if(inputs.size() > 2) { // stored in the model
+      codes    = inputs[2]->val()->data<uint8_t>();
+      ABORT_IF(inputs.size() > 3 && inputs[3]->value_type() != Type::float32, "LSH rotation has to be float32");
+      rotation = inputs.size() > 3 ? inputs[3]->val()->data<float>() : nullptr;
+    } else {
+      if(codes_.empty() || indexHash_ != values->hash()) {
+        LOG(info, "Building LSH index for vector dim {} and with hash size {} bits", dim, nbits_);
+        if(dim != nbits_)
+          rotation_ = lsh::randomRotation(dim, nbits_);
+        codes_.resize((size_t)vRows * lsh::bytesPerCode(nbits_));
+        lsh::encode(values->val()->data<float>(), vRows, dim,
+                    rotation_.empty() ? nullptr : rotation_.data(), nbits_, codes_.data());
+        indexHash_ = values->hash();
+      }
+      codes    = codes_.data();
+      rotation = rotation_.empty() ? nullptr : rotation_.data();
     }
 
     int qRows = query->shape().elements() / dim;
-    std::vector<float> distances(qRows * k_);
-    std::vector<faiss::Index::idx_t> ids(qRows * k_);
+    std::vector<uint8_t> queryCodes((size_t)qRows * lsh::bytesPerCode(nbits_));
+    lsh::encode(query->val()->data<float>(), qRows, dim, rotation, nbits_, queryCodes.data());
 
-    index_->search(qRows, query->val()->data<float>(), k_,
-                   distances.data(), ids.data());
-    
-    std::vector<IndexType> vOut;
-    vOut.reserve(ids.size());
-    for(auto id : ids)
-      vOut.push_back((IndexType)id);
+    std::vector<IndexType> vOut((size_t)qRows * k_);
+    lsh::search(queryCodes.data(), qRows, codes, vRows, nbits_, k_, vOut.data());
 
     out->val()->set(vOut);
   };
 
-  return lambda({query, values}, kShape, Type::uint32, forward);
+  std::vector<Expr> nodes = {query, values};
+  for(auto index : storedIndex(values))
+    nodes.push_back(index);
+
+  return lambda(nodes, kShape, Type::uint32, forward);
 #else
   query; values;
   ABORT("LSH output layer requires a CPU BLAS library");
@@ -1,13 +1,42 @@
+#pragma once
+
 #include "graph/expression_graph.h"
-#include <memory>
+#include "common/io_item.h"
 
-namespace faiss {
-  struct IndexLSH;
-}
+#include <memory>
+#include <vector>
 
 namespace marian {
 
-class LSH {  
+// Building blocks of the LSH index used by --output-approx-knn. A vector is hashed to nbits bits,
+// bit j is set if the j-th element of the randomly rotated vector is not negative. If nbits equals
+// the vector dimension the vector is not rotated. Codes are padded to whole 64-bit words.
+namespace lsh {
+
+// size of one code in bytes
+int bytesPerCode(int nbits);
+
+// Random rotation matrix [nbits, dim], the same as used by faiss::IndexLSH
+std::vector<float> randomRotation(int dim, int nbits);
+
+// Hashes rows vectors of size dim from x into codes (rows * bytesPerCode(nbits) bytes).
+// rotation is [nbits, dim] or nullptr if nbits == dim.
+void encode(const float* x, int rows, int dim, const float* rotation, int nbits, uint8_t* codes);
+
+// For each of numQueries query codes writes the ids of the k codes with the smallest Hamming
+// distance to ids, ordered by distance and ties by id
+void search(const uint8_t* queries, int numQueries,
+            const uint8_t* codes, int numCodes,
+            int nbits, int k, IndexType* ids);
+
+// Precomputed index for the output matrix values [rows, dim] called name, stored by marian-conv as
+// items "<name>_lsh_codes" (uint8, [rows, bytesPerCode(nbits)]) and, if nbits != dim,
+// "<name>_lsh_rotation" (float32, [nbits, dim])
+std::vector<io::Item> indexItems(const std::string& name, const std::vector<float>& values, int dim, int nbits);
+
+}  // namespace lsh
+
+class LSH {
 public:
   LSH(int k, int nbits) : k_{k}, nbits_{nbits} {
 #if !BLAS_FOUND
@@ -18,7 +47,9 @@ public:
   Expr apply(Expr query, Expr values, Expr bias);
 
 private:
-  Ptr<faiss::IndexLSH> index_;
+  // index built on first use if the model does not contain a matching one
+  std::vector<float> rotation_;
+  std::vector<uint8_t> codes_;
   size_t indexHash_{0};
 
   int k_{100};
@@ -26,6 +57,7 @@ private:
 
   Expr search(Expr query, Expr values);
   Expr affine(Expr idx, Expr query, Expr values, Expr bias);
+  std::vector<Expr> storedIndex(Expr values);
 };
 
-}
\ No newline at end of file
+}
@@ -3,6 +3,9 @@
 #include "common/filesystem.h"
 #include "common/version.h"
 
+#include <limits>
+#include <unordered_map>
+
 namespace marian {
 
 EncoderDecoder::EncoderDecoder(Ptr<ExpressionGraph> graph, Ptr<Options> options)
@@ -174,11 +177,60 @@ void EncoderDecoder::clear(Ptr<ExpressionGraph> graph) {
     dec->clear();
 }
 
+Ptr<data::CorpusBatch> EncoderDecoder::distinctSources(Ptr<data::CorpusBatch> batch,
+                                                       std::vector<IndexType>& sourceMap) {
+  if(!inference_ || !opt<bool>("n-best-share-encoder", false) || batch->sets() < 2)
+    return nullptr;
+
+  // key of a sentence: its words in all source streams, separated by a marker that is no word index
+  std::unordered_map<std::string, IndexType> positions;
+  std::vector<size_t> distinct; // batch index of the first sentence with each distinct source
+  sourceMap.resize(batch->size());
+  for(size_t b = 0; b < batch->size(); ++b) {
+    std::string key;
+    for(size_t j = 0; j + 1 < batch->sets(); ++j) {
+      auto sb = (*batch)[j];
+      for(size_t s = 0; s < sb->batchWidth() && sb->mask()[sb->locate(b, s)] != 0; ++s) {
+        auto word = sb->data()[sb->locate(b, s)].toWordIndex();
+        key.append((const char*)&word, sizeof(word));
+      }
+      auto sep = std::numeric_limits<WordIndex>::max();
+      key.append((const char*)&sep, sizeof(sep));
+    }
+
+    auto it = positions.find(key);
+    if(it == positions.end()) {
+      it = positions.emplace(key, (IndexType)distinct.size()).first;
+      distinct.push_back(b);
+    }
+    sourceMap[b] = it->second;
+  }
+
+  if(distinct.size() == batch->size())
+    return nullptr;
+
+  std::vector<Ptr<data::SubBatch>> subBatches;
+  for(size_t j = 0; j < batch->sets(); ++j)
+    subBatches.push_back((*batch)[j]->select(distinct));
+  return New<data::CorpusBatch>(subBatches);
+}
+
 Ptr<DecoderState> EncoderDecoder::startState(Ptr<ExpressionGraph> graph,
                                              Ptr<data::CorpusBatch> batch) {
+  // encode sources that occur repeatedly in the batch (e.g. in n-best lists) only once and
+  // expand the encoder states to the full batch
+  std::vector<IndexType> sourceMap;
+  auto sourceBatch = distinctSources(batch, sourceMap);
+
   std::vector<Ptr<EncoderState>> encoderStates;
-  for(auto& encoder : encoders_)
-    encoderStates.push_back(encoder->build(graph, batch));
+  for(auto& encoder : encoders_) {
+    if(sourceBatch) {
+      // a copy of the encoder's own state type, so that derived states keep their members
+      encoderStates.push_back(encoder->build(graph, sourceBatch)->select(sourceMap, batch));
+    } else {
+      encoderStates.push_back(encoder->build(graph, batch));
+    }
+  }
 
   // initialize shortlist here
   if(shortlistGenerator_) {
@@ -76,6 +76,11 @@ protected:
 
   virtual void createDecoderConfig(const std::string& name);
 
+  // With --n-best-share-encoder, returns a batch with every distinct source (all streams but the target)
+  // of batch only once and sets sourceMap[i] to the position of the source of sentence i in it. Returns
+  // nullptr if all sources are distinct.
+  Ptr<data::CorpusBatch> distinctSources(Ptr<data::CorpusBatch> batch, /*out*/ std::vector<IndexType>& sourceMap);
+
 public:
   typedef data::Corpus dataset_type;
 
@@ -13,6 +13,8 @@
 #include "models/laser.h"
 #include "models/transformer_factory.h"
 
+#include "translator/sampling.h"
+
 #ifdef CUDNN
 #include "models/char_s2s.h"
 #endif
@@ -370,7 +372,8 @@ Ptr<IModel> createModelFromOptions(Ptr<Options> options, usage use) {
   // add (log)softmax if requested
   if (use == usage::translation) {
     if(std::dynamic_pointer_cast<EncoderDecoder>(baseModel)) {
-      if(options->get<bool>("output-sampling", false))
+      // restricted sampling draws from the log probabilities in the search, see OutputSampler
+      if(options->get<bool>("output-sampling", false) && !OutputSampler::isEnabled(options))
         return New<Stepwise>(std::dynamic_pointer_cast<EncoderDecoder>(baseModel), New<GumbelSoftmaxStep>());
       else
         return New<Stepwise>(std::dynamic_pointer_cast<EncoderDecoder>(baseModel), New<LogSoftmaxStep>());
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace marian {
 
@@ -12,5 +13,9 @@ struct ModelTask {
 struct ModelServiceTask {
   virtual ~ModelServiceTask() {}
   virtual std::string run(const std::string&) = 0;
+  // operational statistics as text, empty if not collected
+  virtual std::string metrics() { return ""; }
+  // switches to the given model files (or reloads the current ones if empty), false if not supported
+  virtual bool reload(const std::vector<std::string>& /*models*/) { return false; }
 };
 }  // namespace marian
@@ -27,10 +27,24 @@ public:
     return batch_->front()->data();
   }
 
+  // Copy of this state; derived states with additional members must override it, so that
+  // select() keeps them
+  virtual Ptr<EncoderState> clone() const { return New<EncoderState>(*this); }
+
   // Sub-select active batch entries from encoder context and context mask
-  Ptr<EncoderState> select(const std::vector<IndexType>& batchIndices) { // [batchIndex] indices of active batch entries
+  Ptr<EncoderState> select(const std::vector<IndexType>& batchIndices) const { // [batchIndex] indices of active batch entries
+    return select(batchIndices, batch_);
+  }
+
+  // Same as above, but the selected state belongs to batch, e.g. the full batch when expanding the states
+  // of distinct sources. Entries of batchIndices may repeat.
+  Ptr<EncoderState> select(const std::vector<IndexType>& batchIndices, Ptr<data::CorpusBatch> batch) const {
+    auto state = clone();
     // Dimension -2 is OK for both, RNN and Transformer models as the encoder context in Transformer gets transposed to the same dimension layout
-    return New<EncoderState>(index_select(context_, -2, batchIndices), index_select(mask_, -2, batchIndices), batch_);
+    state->context_ = index_select(context_, -2, batchIndices);
+    state->mask_ = index_select(mask_, -2, batchIndices);
+    state->batch_ = batch;
+    return state;
   }
 };
 
@@ -9,10 +9,21 @@ void Elementwise::clip(Tensor t) {
   Element(_1 = functional::clip(_1, c_), t);
 }
 
+void Elementwise::clipArgs(Tensor /*t*/, float& scale, float& value) {
+  scale = 1.f;
+  value = c_;
+}
+
 void Norm::clip(Tensor t) {
   using namespace functional;
   float l2Norm = L2Norm(t, nullptr); // @TODO: this is a placeholder for a memory allocator, will be replaced with better version in a PR or two.
   if(l2Norm >= c_)
     Element(_1 = (c_ / l2Norm) * _1, t);
 }
+
+void Norm::clipArgs(Tensor t, float& scale, float& value) {
+  float l2Norm = L2Norm(t, nullptr);
+  scale = l2Norm >= c_ ? c_ / l2Norm : 1.f;
+  value = 0.f;
+}
 }  // namespace marian
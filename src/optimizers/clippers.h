@@ -16,6 +16,12 @@ namespace marian {
 class ClipperBase {
 public:
   virtual void clip(Tensor) = 0;
+
+  // Describes what clip() would do to t without modifying it, for optimizers that apply the
+  // clipping in their own pass over the gradient: multiply by scale, then clip each value to
+  // [-value, value] unless value is 0.
+  virtual void clipArgs(Tensor t, /*out*/ float& scale, /*out*/ float& value) = 0;
+
   virtual ~ClipperBase() {}
 };
 
@@ -26,6 +32,7 @@ public:
   Elementwise(float c = 10.0) : c_(c) {}
 
   void clip(Tensor t) override;
+  void clipArgs(Tensor t, float& scale, float& value) override;
 
 private:
   float c_;
@@ -36,6 +43,7 @@ public:
   Norm(float c = 1.0) : c_(c) {}
 
   void clip(Tensor t) override;
+  void clipArgs(Tensor t, float& scale, float& value) override;
 
 private:
   float c_;
@@ -6,6 +6,27 @@
 
 namespace marian {
 
+void OptimizerBase::update(Tensor params, Tensor grads, size_t mbSize, Tensor paramsAvg, float avgDecay, bool resetGrads) {
+  if(!hasFusedUpdate(params)) {
+    update(params, grads, mbSize);
+    if(paramsAvg) {
+      using namespace functional;
+      Element(_1 = ((1.f - avgDecay) * _1) + (avgDecay * _2), paramsAvg, params);
+    }
+    if(resetGrads)
+      grads->set(0.f);
+    return;
+  }
+
+  float gradScale = 1.f, clipValue = 0.f;
+  if(clipper_)
+    clipper_->clipArgs(grads, gradScale, clipValue);
+
+  size_t refMBWords = refMBWordsParam_;
+  adjustMBSize(mbSize, refMBWords);
+  updateFusedImpl(params, grads, mbSize, refMBWords, gradScale, clipValue, paramsAvg, avgDecay, resetGrads);
+}
+
 void Sgd::updateImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t refMBWords) {
   actualMBSize, refMBWords; // (no correction for base update needed beyond using ce-sum)
   using namespace functional;
@@ -121,7 +142,7 @@ void Adagrad::resetStats() {
 
 // Adam
 
-void Adam::updateImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t refMBWords) {
+cpu::AdamUpdateArgs Adam::prepareUpdate(Tensor params, size_t actualMBSize, size_t refMBWords) {
   // lazy allocation
   if(!alloc_)
     alloc_ = New<TensorAllocator>(params->getBackend());
@@ -157,17 +178,36 @@ void Adam::updateImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t r
   denom1_ = (beta1 * denom1_) + (1 - beta1); // momentum smoothing
   denom2_ = (beta2 * denom2_) + (1 - beta2); // RMS normalization
 
+  cpu::AdamUpdateArgs args;
+  args.gradScale = 1.f;
+  args.clipValue = 0.f;
   // numerators. Divide by T to convert ce-sum gradient to avg gradient.
+  args.beta1  = (float)beta1;
+  args.mScale = float((1 - beta1) / T);
+  args.beta2  = (float)beta2;
+  args.vScale = float((1 - beta2) / T / T);
+  args.eta    = (float)eta;
+  args.denom1 = (float)denom1_;
+  args.denom2 = (float)denom2_;
+  args.eps    = eps_;
+  args.decay  = (float)decay;
+  args.avgDecay = 0.f;
+  args.resetGrads = false;
+  return args;
+}
+
+void Adam::updateImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t refMBWords) {
+  auto args = prepareUpdate(params, actualMBSize, refMBWords);
+
   using namespace functional;
-  Element(_1 = ((float)beta1 * _1) + float((1 - beta1) / T    ) *  _2,       mt_, grads); // momentum smoothing. At steady state: =smoothed avg gradient
-  Element(_1 = ((float)beta2 * _1) + float((1 - beta2) / T / T) * (_2 * _2), vt_, grads); // RMS normalization.  At steady state: =mean square of the avg gradients
+  Element(_1 = (args.beta1 * _1) + args.mScale *  _2,       mt_, grads); // momentum smoothing. At steady state: =smoothed avg gradient
+  Element(_1 = (args.beta2 * _1) + args.vScale * (_2 * _2), vt_, grads); // RMS normalization.  At steady state: =mean square of the avg gradients
 
   // apply Adam normalization
-  float etaf = (float)eta, denom1f = (float)denom1_, denom2f = (float)denom2_, decayf = (float)decay; // (get casts out of Element expression for readability)
-  Element(_1 -= etaf                               // learning-rate: x_t = x_{t-1} - \eta * (...)
-                * ((  (     _2 / denom1f)          // momentum-smoothed per-sample gradient: m_{t-1}
-                    / (sqrt(_3 / denom2f) + eps_)) // normalize by RMS: \sqrt(v_{t-1})
-                   + decayf * _1),                 // weight-decay: w * x_{t-1}
+  Element(_1 -= args.eta                               // learning-rate: x_t = x_{t-1} - \eta * (...)
+                * ((  (     _2 / args.denom1)          // momentum-smoothed per-sample gradient: m_{t-1}
+                    / (sqrt(_3 / args.denom2) + eps_)) // normalize by RMS: \sqrt(v_{t-1})
+                   + args.decay * _1),                 // weight-decay: w * x_{t-1}
           params, // =_1
           mt_,    // =_2
           vt_     // =_3
@@ -176,6 +216,22 @@ void Adam::updateImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t r
   params->getBackend()->synchronize(); // @TODO: This should not be in here. Maybe in the wrapper. Why is it needed at all?
 }
 
+// the fused update is a CPU kernel, GPUs run the separate element-wise passes
+bool Adam::hasFusedUpdate(Tensor params) const {
+  return params->getBackend()->getDeviceId().type == DeviceType::cpu;
+}
+
+void Adam::updateFusedImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t refMBWords,
+                           float gradScale, float clipValue,
+                           Tensor paramsAvg, float avgDecay, bool resetGrads) {
+  auto args = prepareUpdate(params, actualMBSize, refMBWords);
+  args.gradScale  = gradScale;
+  args.clipValue  = clipValue;
+  args.avgDecay   = avgDecay;
+  args.resetGrads = resetGrads;
+  cpu::AdamUpdate(params, grads, mt_, vt_, paramsAvg, args);
+}
+
 void Adam::load(const std::string& name,
                 const std::vector<Ptr<OptimizerBase>>& opts,
                 const std::vector<Ptr<Backend>>& backends,
@@ -5,6 +5,7 @@
 #include "optimizers/clippers.h"
 #include "tensors/backend.h"
 #include "tensors/tensor.h"
+#include "tensors/tensor_operators.h"
 #include "training/training_state.h"
 
 #include <algorithm>
@@ -45,17 +46,16 @@ public:
       clipper_->clip(grads); //@BUGBUG: take into account actual mini-batch size since gradients are not normalized
 
     size_t refMBWords = refMBWordsParam_;
-    if (refMBWords == 0) { // optimizer not configured to use hyper-parameter auto-adjustment
-      refMBWords = mbSize = 1; // neutral settings that keep the standard behavior
-    }
-    else { // optimizer is configured to auto-adjust hyper-parameters
-      ABORT_IF(mbSize == mbSizeNotProvided, "Using rational optimizer auto-adjustment with trainer that does not provide MB size");
-      // note: this behavior is only meaningful if using the ce-sum criterion
-    }
-
+    adjustMBSize(mbSize, refMBWords);
     updateImpl(params, grads, mbSize, refMBWords);
   }
 
+  // Same as update(params, grads, mbSize), followed by the exponential smoothing
+  // paramsAvg = (1 - avgDecay) * paramsAvg + avgDecay * params if paramsAvg is given and by
+  // resetting the gradients if resetGrads. Optimizers with a fused implementation do all of this,
+  // including the gradient clipping, in a single pass over the tensors.
+  void update(Tensor params, Tensor grads, size_t mbSize, Tensor paramsAvg, float avgDecay, bool resetGrads);
+
   virtual void init(TrainingState& state) override {
     eta_ = state.eta;
   }
@@ -101,6 +101,25 @@ protected:
   virtual void updateImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t refMBWords) = 0;
   virtual void resetStats() = 0;
 
+  // Fused implementation of update(params, grads, mbSize, paramsAvg, avgDecay, resetGrads) with the
+  // clipping given as by ClipperBase::clipArgs(), only called if hasFusedUpdate(params)
+  virtual bool hasFusedUpdate(Tensor /*params*/) const { return false; }
+  virtual void updateFusedImpl(Tensor /*params*/, Tensor /*grads*/, size_t /*actualMBSize*/, size_t /*refMBWords*/,
+                               float /*gradScale*/, float /*clipValue*/,
+                               Tensor /*paramsAvg*/, float /*avgDecay*/, bool /*resetGrads*/) {
+    ABORT("Optimizer has no fused update");
+  }
+
+  void adjustMBSize(size_t& mbSize, size_t& refMBWords) const {
+    if (refMBWords == 0) { // optimizer not configured to use hyper-parameter auto-adjustment
+      refMBWords = mbSize = 1; // neutral settings that keep the standard behavior
+    }
+    else { // optimizer is configured to auto-adjust hyper-parameters
+      ABORT_IF(mbSize == mbSizeNotProvided, "Using rational optimizer auto-adjustment with trainer that does not provide MB size");
+      // note: this behavior is only meaningful if using the ce-sum criterion
+    }
+  }
+
   // Learning rate
   float eta_;
   // Reference MB size. This enables automatic adjustment of optimizer hyper-parameters to MB size.
@@ -180,8 +199,16 @@ public:
 
 private:
   void updateImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t refMBWords) override;
+  bool hasFusedUpdate(Tensor params) const override;
+  void updateFusedImpl(Tensor params, Tensor grads, size_t actualMBSize, size_t refMBWords,
+                       float gradScale, float clipValue,
+                       Tensor paramsAvg, float avgDecay, bool resetGrads) override;
   void resetStats() override;
 
+  // allocates the moments on first use, advances the denominators and returns the scalars of this
+  // update for updateImpl() and updateFusedImpl()
+  cpu::AdamUpdateArgs prepareUpdate(Tensor params, size_t actualMBSize, size_t refMBWords);
+
   // Adam parameters:
   // [beta1, beta2, eps, w, refMBWords]
   virtual void setParams(const std::vector<float>& params) override {
@@ -8,50 +8,19 @@
 namespace marian {
 
 ScoreCollector::ScoreCollector(const Ptr<Options>& options)
-    : nextId_(0),
-      alignment_(options->get<std::string>("alignment", "")),
+    : alignment_(options->get<std::string>("alignment", "")),
       alignmentThreshold_(getAlignmentThreshold(alignment_)) {
 
+    UPtr<std::ostream> outStrm;
     if(options->get<std::string>("output") == "stdout")
-      outStrm_.reset(new std::ostream(std::cout.rdbuf()));
+      outStrm.reset(new std::ostream(std::cout.rdbuf()));
     else
-      outStrm_.reset(new io::OutputFileStream(options->get<std::string>("output")));
+      outStrm.reset(new io::OutputFileStream(options->get<std::string>("output")));
+    sink_.reset(new OutputSink(std::move(outStrm)));
   }
 
 void ScoreCollector::Write(long id, const std::string& message) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if(id == nextId_) {
-    *outStrm_ << message << std::endl;
-
-    ++nextId_;
-
-    typename Outputs::const_iterator iter, iterNext;
-    iter = outputs_.begin();
-    while(iter != outputs_.end()) {
-      long currId = iter->first;
-
-      if(currId == nextId_) {
-        // 1st element in the map is the next
-        *outStrm_ << iter->second << std::endl;
-
-        ++nextId_;
-
-        // delete current record, move iter on 1
-        iterNext = iter;
-        ++iterNext;
-        outputs_.erase(iter);
-        iter = iterNext;
-      } else {
-        // not the next. stop iterating
-        assert(nextId_ < currId);
-        break;
-      }
-    }
-
-  } else {
-    // save for later
-    outputs_[id] = message;
-  }
+  sink_->push(id, message + "\n");
 }
 
 void ScoreCollector::Write(long id,
@@ -3,6 +3,7 @@
 #include "common/options.h"
 #include "common/definitions.h"
 #include "common/file_stream.h"
+#include "common/output_sink.h"
 #include "data/alignment.h"
 
 #include <map>
@@ -22,13 +23,9 @@ public:
                      const std::vector<float>& wordScores = {});
 
 protected:
-  long nextId_{0};
-  UPtr<std::ostream> outStrm_;
+  UPtr<OutputSink> sink_;
   std::mutex mutex_;
 
-  typedef std::map<long, std::string> Outputs;
-  Outputs outputs_;
-
   std::string alignment_;
   float alignmentThreshold_{0.f};
 
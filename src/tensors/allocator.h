@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <memory>
@@ -82,6 +84,7 @@ class Allocator {
 private:
   Ptr<Device> device_;
   size_t available_{0};
+  std::atomic<size_t> peak_{0}; // maximum number of bytes in use at the same time, read by other threads for metrics
   size_t step_{128 * 1024 * 1024};
   size_t alignment_{256};
 
@@ -89,6 +92,7 @@ private:
 
   std::set<Gap> gaps_;
   std::unordered_map<uint8_t*, MemoryPiece::PtrType> allocated_;
+  std::unordered_map<uint8_t*, std::vector<MemoryPiece::PtrType>> views_; // see view(), by allocated piece
 
   void grow(size_t add) {
     add = alignedSize(add);
@@ -112,6 +116,15 @@ private:
       allocated_[newPtr] = oldAllocated[it.first];
       allocated_[newPtr]->setPtr(newPtr);
     }
+
+    std::unordered_map<uint8_t*, std::vector<MemoryPiece::PtrType>> oldViews;
+    views_.swap(oldViews);
+    for(auto& it : oldViews) {
+      uint8_t* newPtr = device_->data() + std::distance(oldData, it.first);
+      for(auto& view : it.second)
+        view->setPtr(device_->data() + std::distance(oldData, view->data()));
+      views_[newPtr] = it.second;
+    }
   }
 
   Gap getGap(size_t size) {
@@ -206,6 +219,11 @@ public:
       insertGap(gap.rest(bytes), false);
     }
 
+    // only the thread that allocates writes the peak
+    size_t inUse = size() - available_;
+    if(inUse > peak_.load(std::memory_order_relaxed))
+      peak_.store(inUse, std::memory_order_relaxed);
+
     auto ptr = gap.data();
     auto mp = MemoryPiece::New(ptr, bytes);
     allocated_[ptr] = mp;
@@ -223,6 +241,7 @@ public:
     auto it = allocated_.find(ptr);
     if(it != allocated_.end()) {
       allocated_.erase(ptr);
+      views_.erase(ptr);
       insertGap(Gap(ptr, bytes), true);
       return true;
     }
@@ -237,10 +256,24 @@ public:
     return false;
   }
 
+  // Returns a piece of bytes memory at offset inside the allocated piece mp, e.g. for tensors
+  // placed by a memory plan. A view is not freed on its own, but moves along with mp when the
+  // allocator grows and must not be used anymore once mp is freed.
+  MemoryPiece::PtrType view(MemoryPiece::PtrType mp, size_t offset, size_t bytes) {
+    ABORT_IF(offset + bytes > mp->size(), "View of {} bytes at offset {} exceeds memory piece of {} bytes", bytes, offset, mp->size());
+    auto piece = MemoryPiece::New(mp->data() + offset, bytes);
+    views_[mp->data()].push_back(piece);
+    return piece;
+  }
+
+  // Forgets all views into mp, e.g. before mp is reused for new views
+  void dropViews(MemoryPiece::PtrType mp) { views_.erase(mp->data()); }
+
   void clear() {
     available_ = 0;
     gaps_.clear();
     allocated_.clear();
+    views_.clear();
     insertGap({device_->data(), device_->size()}, false);
   }
 
@@ -252,6 +285,9 @@ public:
 
   size_t available() { return available_; }
 
+  // high-water mark of the bytes in use since construction, safe to call from any thread
+  size_t peak() const { return peak_.load(std::memory_order_relaxed); }
+
   DeviceId getDeviceId() { return device_->getDeviceId(); }
 };
 }  // namespace marian
@@ -14,6 +14,9 @@ protected:
   // global clipping value for matrix-multiplies, should soon be removed.
   float clipValue_{0.f};
 
+  // for CPU inference, choose the fastest GEMM variant per matrix shape, see gemmAutotuned()
+  bool autotune_{false};
+
 public:
   Backend(DeviceId deviceId, size_t seed)
       : deviceId_(deviceId), seed_(seed), randomGenerator_(createRandomGenerator(seed, deviceId)) {}
@@ -28,6 +31,9 @@ public:
   virtual void setClip(float clipValue) { clipValue_ = clipValue; }
   float getClip() { return clipValue_; }
 
+  void setAutotune(bool autotune) { autotune_ = autotune; }
+  bool isAutotune() { return autotune_; }
+
   // for CPU, sets to use optimized code for inference.
   // for GPU, this is invalid. for gpu, isOptimized() function always returns false.
   virtual void setOptimized(bool optimize) = 0;
@@ -280,6 +280,7 @@ public:
 // size_t k_: the number of columns in A and the number of rows in C
 // bool transA_: transpose A
 // bool transB_: transpose B
+// bool staticRangeA_: the last child holds a calibrated quantization range [min, max] for A
 class FbgemmPacked8AffineNodeOp : public NaryNodeOp {
 private:
   size_t m_;
@@ -287,12 +288,14 @@ private:
   size_t k_;
   bool transA_;
   bool transB_;
+  bool staticRangeA_;
 
 public:
- FbgemmPacked8AffineNodeOp(const std::vector<Expr>& nodes, Shape bShape, bool transA, bool transB, float /*scalar*/)
+ FbgemmPacked8AffineNodeOp(const std::vector<Expr>& nodes, Shape bShape, bool transA, bool transB, float /*scalar*/, bool staticRangeA = false)
    : NaryNodeOp(nodes, newShape(nodes[0], bShape, transA, transB), Type::float32)/*, scalar_(scalar) */ {
     transA_ = transA;
     transB_ = transB;
+    staticRangeA_ = staticRangeA;
     m_ = nodes[0]->shape().elements() / nodes[0]->shape()[-1];
     k_ = nodes[0]->shape().back();
     if(transA)
@@ -328,7 +331,7 @@ public:
     NodeOps nodeOps;
 #if USE_FBGEMM
     // Do addBias only if it has a bias term
-    if (children().size() > 2) {
+    if (children().size() > (staticRangeA_ ? 3 : 2)) {
       nodeOps = { NodeOp(fbgemmPacked8Gemm(val_,
                                            child(0)->val(),
                                            child(1)->val(),
@@ -336,7 +339,8 @@ public:
                                            n_,
                                            k_,
                                            transA_,
-                                           transB_);
+                                           transB_,
+                                           staticRangeA_ ? children().back()->val()->data() : nullptr);
                        marian::cpu::int16::AddBias(val_, child(2)->val())) };
     } else {
       nodeOps = { NodeOp(fbgemmPacked8Gemm(val_,
@@ -346,7 +350,8 @@ public:
                                            n_,
                                            k_,
                                            transA_,
-                                           transB_)) };
+                                           transB_,
+                                           staticRangeA_ ? children().back()->val()->data() : nullptr)) };
     }
 #else // USE_FBGEMM
     ABORT("FbgemmPacked8AffineNodeOp can only be used with FBGEMM enabled.");
@@ -363,15 +368,30 @@ public:
   const std::string type() override { return "gemmPacked8"; }
 };
 
+// Returns the statically calibrated quantization range of the activations multiplied with the
+// packed int8 matrix b (item "<name of b>_QuantRangeA" written by marian-conv --calibration-data)
+// or nullptr if the model does not contain one.
+static inline Expr quantRangeA(Expr b) {
+  // graph->get() prepends the current namespace (e.g. of an ensemble member) itself
+  std::string name = b->name();
+  auto pos = name.rfind("::");
+  if(pos != std::string::npos)
+    name = name.substr(pos + 2);
+  return b->graph()->get(name + "_QuantRangeA");
+}
+
 static inline Expr affine(Expr a, Expr b, Shape bShape, Expr c, bool transA, bool transB, float scalar) {
   std::vector<Expr> nodes = {a, b, c};
   Type elementType = b->value_type();
 
   if (elementType == Type::packed16)
     return Expression<FbgemmPacked16AffineNodeOp>(nodes, bShape, transA, transB, scalar);
-  else if (isPacked(elementType) && sizeOf(elementType) == 1)
-    return Expression<FbgemmPacked8AffineNodeOp>(nodes, bShape, transA, transB, scalar);
-  else {
+  else if (isPacked(elementType) && sizeOf(elementType) == 1) {
+    auto rangeA = quantRangeA(b);
+    if(rangeA)
+      nodes.push_back(rangeA);
+    return Expression<FbgemmPacked8AffineNodeOp>(nodes, bShape, transA, transB, scalar, rangeA != nullptr);
+  } else {
     ABORT("Only int8 and fp16 are available. {}", elementType);
     return nullptr;
   }
@@ -394,9 +414,12 @@ static inline Expr dot(Expr a, Expr b, Shape bShape, bool transA, bool transB, f
 
   if (elementType == Type::packed16)
     return Expression<FbgemmPacked16AffineNodeOp>(nodes, bShape, transA, transB, scalar);
-  else if (isPacked(elementType) && sizeOf(elementType) == 1)
-    return Expression<FbgemmPacked8AffineNodeOp>(nodes, bShape, transA, transB, scalar);
-  else {
+  else if (isPacked(elementType) && sizeOf(elementType) == 1) {
+    auto rangeA = quantRangeA(b);
+    if(rangeA)
+      nodes.push_back(rangeA);
+    return Expression<FbgemmPacked8AffineNodeOp>(nodes, bShape, transA, transB, scalar, rangeA != nullptr);
+  } else {
     ABORT("Only int8 and fp16 are available. {}", elementType);
     return nullptr;
   }
@@ -2,6 +2,8 @@
 
 #include "graph/expression_graph.h"
 #include "packed_gemm.h"
+#include "tensors/cpu/sharp/int_gemm.h"
+#include "quantization_calibrator.h"
 
 namespace marian {
 
@@ -18,28 +20,68 @@ public:
 
   virtual ~ExpressionGraphPackable() {}
 
+  // Collect the activations that are multiplied with packable weights from the last forward pass
+  // into the calibrator. The graph needs to be built in training mode (setInference(false)) to
+  // keep the executed nodes and their inputs alive after forward().
+  void collectActivationStats(cpu::variant::QuantizationCalibrator& calibrator) {
+    ABORT_IF(isInference(), "Activation statistics can only be collected from a graph in training mode");
+    for(auto node : nodesBackward_) {
+      if(node->type() != "affine" && node->type() != "dot")
+        continue;
+
+      Expr weight = node->child(1);
+      if(weight->type() != "param")
+        continue;
+
+      std::string pName = stripNamespace(weight->name());
+      if(!isPacked8Weight(pName))
+        continue;
+
+      Tensor val = node->child(0)->val();
+      std::vector<float> activations;
+      val->get(activations);
+      calibrator.observe(pName, activations.data(), activations.size());
+    }
+  }
+
   // Convert model weights into packed format and save to IO items.
+  // If a calibrator is given, a static quantization range of the activations is stored
+  // as a separate item "<weight name>_QuantRangeA" for every int8 packed weight.
+  // Embedding matrices are stored as embeddingElementType, Type::rowquant8 quantizes them per row.
+  // extraItems (e.g. a precomputed LSH index) are saved as they are.
   // @TODO: review this
-  void packAndSave(const std::string& name, const std::string& meta, Type gemmElementType = Type::float32, Type saveElementType = Type::float32) {
+  void packAndSave(const std::string& name,
+                   const std::string& meta,
+                   Type gemmElementType = Type::float32,
+                   Type saveElementType = Type::float32,
+                   Ptr<cpu::variant::QuantizationCalibrator> calibrator = nullptr,
+                   Type embeddingElementType = Type::float32,
+                   std::vector<io::Item> extraItems = {}) {
     std::vector<io::Item> ioItems;
 
     // sorted by name in std::map
     for (auto p : params()->getMap()) {
-      std::string pName = p.first;
-
-      if (!namespace_.empty()) {
-        if (pName.substr(0, namespace_.size() + 2) == namespace_ + "::")
-          pName = pName.substr(namespace_.size() + 2);
-      }
+      std::string pName = stripNamespace(p.first);
 
       Tensor val = p.second->val();
 
+      // embeddings with int8 rows and one scale per row, rows are dequantized during the lookup
+      if (embeddingElementType == Type::rowquant8 && isEmbedding(pName)) {
+        auto allocator = New<TensorAllocator>(getBackend());
+
+        Tensor quantizedTensor;
+        allocator->allocate(quantizedTensor, val->shape(), Type::rowquant8);
+        cpu::QuantizeRows8(quantizedTensor, val);
+
+        io::Item item;
+        quantizedTensor->get(item, pName);
+        ioItems.emplace_back(std::move(item));
       // save as packed format
       // @TODO Hardcoded to find packable weights
       // int8 - all the weights used for affine op and dot op
       // fp16 - all the weights used for affine op
-      if ((gemmElementType == Type::packed8avx2 || gemmElementType == Type::packed8avx512)
-        && (pName.find("_W") == pName.length() - 3 || pName.find("_W") == pName.length() - 2)) {
+      } else if ((gemmElementType == Type::packed8avx2 || gemmElementType == Type::packed8avx512)
+        && isPacked8Weight(pName)) {
 #if USE_FBGEMM
         using namespace marian::cpu::variant;
         // packing information - size
@@ -81,9 +123,36 @@ public:
         copy(backend_, mem->data<char>(), mem->data<char>() + mem->size(), item.bytes.data());
 
         ioItems.emplace_back(std::move(item));
+        addQuantRangeItem(ioItems, calibrator, pName);
 #else
         ABORT("Packed type {} only supported when compiled with -DUSE_FBGEMM=on", gemmElementType);
 #endif
+      // int8 prepared for the sharp GEMMs with runtime dispatch, does not require FBGEMM
+      } else if (gemmElementType == Type::intgemm8 && isPacked8Weight(pName)) {
+        auto allocator = New<TensorAllocator>(getBackend());
+
+        Tensor preparedTensor;
+        allocator->allocate(preparedTensor, val->shape(), Type::intgemm8);
+
+        std::vector<float> data;
+        val->get(data);
+        // embeddings and the transposed output layer (_Wt) are multiplied with transB
+        bool transpose = pName.find("Wemb") != std::string::npos || utils::endsWith(pName, "_Wt");
+        cpu::int16::PrepareInt8(preparedTensor,
+                                data.data(),
+                                val->shape(),
+                                transpose);
+        io::Item item;
+        item.name = pName;
+        item.shape = val->shape();
+        item.type = Type::intgemm8;
+
+        auto mem = preparedTensor->memory();
+        item.bytes.resize(mem->size());
+        copy(backend_, mem->data<char>(), mem->data<char>() + mem->size(), item.bytes.data());
+
+        ioItems.emplace_back(std::move(item));
+        addQuantRangeItem(ioItems, calibrator, pName);
       // fp16 quantization option
       } else if (gemmElementType == Type::packed16 && pName.find("_W") == pName.length() - 3) {
 #if USE_FBGEMM
@@ -147,10 +216,48 @@ public:
       }
     }
 
+    for(auto& item : extraItems)
+      ioItems.emplace_back(std::move(item));
+
     if (!meta.empty())
       io::addMetaToItems(meta, "special:model.yml", ioItems);
     io::saveItems(name, ioItems);
   }
+
+private:
+  static void addQuantRangeItem(std::vector<io::Item>& ioItems,
+                                Ptr<cpu::variant::QuantizationCalibrator> calibrator,
+                                const std::string& pName) {
+    float minA, maxA;
+    if(calibrator && calibrator->range(pName, minA, maxA) && minA < maxA) {
+      io::Item rangeItem;
+      rangeItem.name = pName + "_QuantRangeA";
+      rangeItem.shape = Shape({2});
+      rangeItem.type = Type::float32;
+      rangeItem.bytes.resize(2 * sizeof(float));
+      float range[2] = {minA, maxA};
+      std::copy((char*)range, (char*)range + sizeof(range), rangeItem.bytes.data());
+      ioItems.emplace_back(std::move(rangeItem));
+      LOG(info, "Static activation range for {}: [{}, {}]", pName, minA, maxA);
+    }
+  }
+
+  std::string stripNamespace(const std::string& pName) const {
+    if (!namespace_.empty() && pName.substr(0, namespace_.size() + 2) == namespace_ + "::")
+      return pName.substr(namespace_.size() + 2);
+    return pName;
+  }
+
+  // source, target and tied embedding matrices
+  static bool isEmbedding(const std::string& pName) {
+    return pName == "Wemb" || (pName.length() > 5 && pName.find("_Wemb") == pName.length() - 5);
+  }
+
+  // int8 - all the weights used for affine op and dot op
+  // @TODO Hardcoded to find packable weights
+  static bool isPacked8Weight(const std::string& pName) {
+    return pName.find("_W") == pName.length() - 3 || pName.find("_W") == pName.length() - 2;
+  }
 };
 
 }  // namespace marian
\ No newline at end of file
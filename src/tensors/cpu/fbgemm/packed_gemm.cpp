@@ -536,6 +536,7 @@ void fbgemmPacked16Gemm(marian::Tensor C,
 // k: the number of columns in A and the number of rows in B
 // transA: whether A matrix is transposed or not
 // transB: whether B matrix is transposed or not
+// quantRangeA: static quantization range [min, max] of A, nullptr for dynamic min/max quantization
 void fbgemmPacked8Gemm(marian::Tensor C,
                        const marian::Tensor A,
                        const marian::Tensor B,
@@ -543,7 +544,8 @@ void fbgemmPacked8Gemm(marian::Tensor C,
                        const size_t n,
                        const size_t k,
                        const int transA,
-                       const int transB) {
+                       const int transB,
+                       const float* quantRangeA) {
   // pack type
   marian::Type packType = B->type();
 
@@ -561,10 +563,16 @@ void fbgemmPacked8Gemm(marian::Tensor C,
   // compute range to quantize A (activations) - (min/max quantization)
   float minA = std::numeric_limits<float>::max(), maxA = std::numeric_limits<float>::lowest();
 
-  int elemA = A->shape().elements();
-  float* dataA = A->data();
-  // AVX based find min/max
-  FindMinMax(dataA, &minA, &maxA, elemA);
+  if(quantRangeA) {
+    // statically calibrated range, values outside of it are saturated during quantization
+    minA = quantRangeA[0];
+    maxA = quantRangeA[1];
+  } else {
+    int elemA = A->shape().elements();
+    float* dataA = A->data();
+    // AVX based find min/max
+    FindMinMax(dataA, &minA, &maxA, elemA);
+  }
 
   float quantScaleA = (maxA - minA) / 255;
   int32_t quantZeropointA = (int32_t)(255 - maxA / quantScaleA);
@@ -135,6 +135,8 @@ void fbgemmPacked16Gemm(marian::Tensor C,
 // k: the number of columns in A and rows in B
 // transA: transpose of A matrix
 // transB: transpose of B matrix
+// quantRangeA: static quantization range [min, max] of A computed offline by marian-conv --calibration-data
+//              if nullptr, the range is computed from A (min/max quantization) for every call
 void fbgemmPacked8Gemm(marian::Tensor C,
                        const marian::Tensor A,
                        const marian::Tensor B,
@@ -142,7 +144,8 @@ void fbgemmPacked8Gemm(marian::Tensor C,
                        const size_t n,
                        const size_t k,
                        const int transA = 0,
-                       const int transB = 0);
+                       const int transB = 0,
+                       const float* quantRangeA = nullptr);
 
 }  // namespace variant
 }  // namespace cpu
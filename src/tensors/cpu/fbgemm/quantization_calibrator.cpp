@@ -0,0 +1,172 @@
+#include "quantization_calibrator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace marian {
+namespace cpu {
+namespace variant {
+
+CalibrationMethod calibrationMethodFromString(const std::string& method) {
+  if(method == "max")
+    return CalibrationMethod::max;
+  else if(method == "percentile")
+    return CalibrationMethod::percentile;
+  else if(method == "kl")
+    return CalibrationMethod::kl;
+  else
+    ABORT("Unknown calibration method: {}. Use max, percentile or kl", method);
+}
+
+// Doubles the histogram range until absMax fits. Every doubling merges pairs of adjacent bins
+// into the lower half of the histogram, so previously collected counts stay valid.
+void ActivationHistogram::grow(float absMax) {
+  if(range_ == 0.f) {
+    range_ = absMax;
+    return;
+  }
+
+  size_t numBins = bins_.size();
+  while(range_ < absMax) {
+    for(size_t i = 0; i < numBins / 2; ++i)
+      bins_[i] = bins_[2 * i] + bins_[2 * i + 1];
+    std::fill(bins_.begin() + numBins / 2, bins_.end(), 0.0);
+    range_ *= 2.f;
+  }
+}
+
+void ActivationHistogram::add(const float* data, size_t size) {
+  float absMax = 0.f;
+  for(size_t i = 0; i < size; ++i) {
+    min_ = std::min(min_, data[i]);
+    max_ = std::max(max_, data[i]);
+    absMax = std::max(absMax, std::abs(data[i]));
+  }
+  count_ += size;
+
+  if(absMax == 0.f) { // all zeros, everything goes into the first bin
+    bins_[0] += (double)size;
+    return;
+  }
+
+  if(absMax > range_)
+    grow(absMax);
+
+  size_t numBins = bins_.size();
+  float binsPerUnit = numBins / range_;
+  for(size_t i = 0; i < size; ++i) {
+    size_t bin = (size_t)(std::abs(data[i]) * binsPerUnit);
+    bins_[std::min(bin, numBins - 1)] += 1.0;
+  }
+}
+
+// Entropy calibration as described in "8-bit Inference with TensorRT" (Migacz, 2017).
+// For each candidate threshold the reference distribution P (with outliers folded into the last bin)
+// is compared to its quantized version Q with 128 levels (one half of the int8 range) and the
+// threshold with the smallest KL(P||Q) is returned as a bin index.
+static size_t klThresholdBin(const std::vector<double>& bins) {
+  const size_t levels = 128;
+  const size_t numBins = bins.size();
+  if(numBins <= levels)
+    return numBins;
+
+  // suffix sums of the histogram to fold outliers into the last bin in O(1)
+  std::vector<double> outliers(numBins + 1, 0.0);
+  for(size_t i = numBins; i > 0; --i)
+    outliers[i - 1] = outliers[i] + bins[i - 1];
+
+  size_t bestBin = numBins;
+  double bestKL = std::numeric_limits<double>::max();
+
+  std::vector<double> p, q;
+  for(size_t i = levels; i <= numBins; ++i) {
+    p.assign(bins.begin(), bins.begin() + i);
+    p[i - 1] += outliers[i];
+
+    q.assign(i, 0.0);
+    for(size_t j = 0; j < levels; ++j) {
+      size_t start = j * i / levels;
+      size_t end = (j + 1) * i / levels;
+      double total = 0.0;
+      size_t nonZeros = 0;
+      for(size_t k = start; k < end; ++k) {
+        total += bins[k];
+        nonZeros += bins[k] != 0.0;
+      }
+      if(nonZeros == 0)
+        continue;
+      for(size_t k = start; k < end; ++k)
+        q[k] = bins[k] != 0.0 ? total / nonZeros : 0.0;
+    }
+
+    double sumP = 0.0, sumQ = 0.0;
+    for(size_t k = 0; k < i; ++k) {
+      sumP += p[k];
+      sumQ += q[k];
+    }
+    if(sumP == 0.0 || sumQ == 0.0)
+      continue;
+
+    // bins that are empty in Q but not in P get a small probability mass to keep the divergence finite
+    const double eps = 1e-10;
+    double kl = 0.0;
+    for(size_t k = 0; k < i; ++k) {
+      if(p[k] == 0.0)
+        continue;
+      double pk = p[k] / sumP;
+      double qk = q[k] != 0.0 ? q[k] / sumQ : eps;
+      kl += pk * std::log(pk / qk);
+    }
+
+    if(kl < bestKL) {
+      bestKL = kl;
+      bestBin = i;
+    }
+  }
+  return bestBin;
+}
+
+float ActivationHistogram::threshold(CalibrationMethod method, float percentile) const {
+  float absMax = std::max(std::abs(min_), std::abs(max_));
+  if(count_ == 0 || range_ == 0.f)
+    return absMax;
+
+  float binWidth = range_ / bins_.size();
+  if(method == CalibrationMethod::max) {
+    return absMax;
+  } else if(method == CalibrationMethod::percentile) {
+    ABORT_IF(percentile <= 0.f || percentile > 100.f, "Calibration percentile {} not in (0, 100]", percentile);
+    double target = count_ * (percentile / 100.0);
+    double cumulative = 0.0;
+    for(size_t i = 0; i < bins_.size(); ++i) {
+      cumulative += bins_[i];
+      if(cumulative >= target)
+        return std::min(absMax, (i + 1) * binWidth);
+    }
+    return absMax;
+  } else if(method == CalibrationMethod::kl) {
+    return std::min(absMax, klThresholdBin(bins_) * binWidth);
+  } else {
+    ABORT("Unknown calibration method");
+  }
+}
+
+std::pair<float, float> ActivationHistogram::range(CalibrationMethod method, float percentile) const {
+  float t = threshold(method, percentile);
+  float minA = std::max(min_, -t);
+  float maxA = std::min(max_, t);
+  // the quantization range has to include zero to represent it exactly
+  return std::make_pair(std::min(minA, 0.f), std::max(maxA, 0.f));
+}
+
+bool QuantizationCalibrator::range(const std::string& weightName, float& minA, float& maxA) const {
+  auto it = histograms_.find(weightName);
+  if(it == histograms_.end() || it->second.count() == 0)
+    return false;
+  std::tie(minA, maxA) = it->second.range(method_, percentile_);
+  return true;
+}
+
+}  // namespace variant
+}  // namespace cpu
+}  // namespace marian
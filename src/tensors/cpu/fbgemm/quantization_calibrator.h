@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common/definitions.h"
+
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace marian {
+namespace cpu {
+namespace variant {
+
+// Method used to derive a clipping threshold from the collected activation histogram
+// max: the largest absolute value seen during calibration
+// percentile: the absolute value below which the given percentage of all values falls
+// kl: the threshold minimizing the KL divergence between the original and the quantized
+//     distribution (entropy calibration)
+enum class CalibrationMethod : uint8_t {
+  max = 0,
+  percentile = 1,
+  kl = 2
+};
+
+CalibrationMethod calibrationMethodFromString(const std::string& method);
+
+// Histogram of absolute activation values observed for a single GEMM input.
+// The range of the histogram grows by powers of two when larger values are observed,
+// merging adjacent bins, so that a single pass over the calibration corpus is sufficient.
+class ActivationHistogram {
+private:
+  std::vector<double> bins_;
+  float range_{0.f};  // upper bound of the histogram, bins cover [0, range_]
+  float min_{std::numeric_limits<float>::max()};
+  float max_{std::numeric_limits<float>::lowest()};
+  size_t count_{0};
+
+  void grow(float absMax);
+
+public:
+  ActivationHistogram(size_t numBins = 2048) : bins_(numBins, 0.0) {}
+
+  void add(const float* data, size_t size);
+
+  size_t count() const { return count_; }
+  float min() const { return min_; }
+  float max() const { return max_; }
+
+  // Returns the clipping threshold for absolute values.
+  // percentile is only used with CalibrationMethod::percentile, e.g. 99.99
+  float threshold(CalibrationMethod method, float percentile = 99.99f) const;
+
+  // Returns the static quantization range [min, max] for the activations, that is the observed
+  // range clipped to [-threshold, threshold]
+  std::pair<float, float> range(CalibrationMethod method, float percentile = 99.99f) const;
+};
+
+// Collects activation histograms keyed by the name of the weight matrix the activations are multiplied with.
+class QuantizationCalibrator {
+private:
+  std::map<std::string, ActivationHistogram> histograms_;
+  CalibrationMethod method_;
+  float percentile_;
+
+public:
+  QuantizationCalibrator(CalibrationMethod method, float percentile = 99.99f)
+    : method_(method), percentile_(percentile) {}
+
+  void observe(const std::string& weightName, const float* data, size_t size) {
+    histograms_[weightName].add(data, size);
+  }
+
+  // Returns true and the computed range if activations were observed for this weight
+  bool range(const std::string& weightName, /*out*/ float& minA, /*out*/ float& maxA) const;
+
+  size_t size() const { return histograms_.size(); }
+};
+
+}  // namespace variant
+}  // namespace cpu
+}  // namespace marian
@@ -95,6 +95,68 @@ public:
   const std::string type() override { return "affineInt16"; }
 };
 
+// Product of a float matrix A with a weight matrix B that was prepared offline into the
+// int8 format of PrepareInt8 (Type::intgemm8). B keeps its original shape, the orientation itself
+// is fixed during preparation and has to agree with transB.
+// Optionally only the output columns given by an index node are computed (see affinePreparedSelect).
+class PreparedInt8AffineNodeOp : public NaryNodeOp {
+private:
+  float scalar_;
+  bool transB_;
+  bool hasBias_;
+  bool hasIndices_;
+  bool staticRangeA_;
+
+public:
+  PreparedInt8AffineNodeOp(const std::vector<Expr>& nodes, bool transB, float scalar, bool hasBias, bool hasIndices, bool staticRangeA)
+      : NaryNodeOp(nodes, newShape(nodes[0], nodes[1], hasIndices ? nodes[hasBias ? 3 : 2] : nullptr, transB), Type::float32),
+        scalar_(scalar), transB_(transB), hasBias_(hasBias), hasIndices_(hasIndices), staticRangeA_(staticRangeA) {}
+
+  Shape newShape(Expr a, Expr b, Expr indices, bool transB) {
+    auto shapeA = a->shape();
+    auto shapeB = b->shape();
+
+    int k = transB ? shapeB[-1] : shapeB[-2];
+    int n = indices ? (int)indices->shape().elements() : (transB ? shapeB[-2] : shapeB[-1]);
+
+    Shape outShape = shapeA;
+    outShape.set(-1, n);
+    ABORT_IF(shapeA[-1] != k,
+             "matrix product requires dimensions to match");
+    return outShape;
+  }
+
+  NodeOps forwardOps() override {
+    ABORT_IF(PreparedInt8Transposed(child(1)->val()) != transB_,
+             "Prepared int8 matrix {} was prepared {}transposed, but is used with transB={}",
+             child(1)->name(), transB_ ? "not " : "", transB_);
+    if(hasIndices_)
+      return {
+        NodeOp(ProdPreparedInt8Select(val_,
+                                      child(0)->val(),
+                                      child(1)->val(),
+                                      child(hasBias_ ? 3 : 2)->val(),
+                                      hasBias_ ? child(2)->val() : nullptr,
+                                      scalar_,
+                                      staticRangeA_ ? children().back()->val()->data() : nullptr))
+      };
+    return {
+      NodeOp(ProdPreparedInt8(val_,
+                              child(0)->val(),
+                              child(1)->val(),
+                              hasBias_ ? child(2)->val() : nullptr,
+                              scalar_,
+                              staticRangeA_ ? children().back()->val()->data() : nullptr))
+    };
+  }
+
+  NodeOps backwardOps() override {
+    ABORT("Only used for inference");
+  }
+
+  const std::string type() override { return "affinePreparedInt8"; }
+};
+
 static inline Expr dot(Expr a, Expr b, float scalar) {
   return Expression<cpu::int16::DotNodeOp>(a, b, scalar);
 }
@@ -104,6 +166,28 @@ static inline Expr affine(Expr a, Expr b, Expr c, float scalar) {
   return Expression<cpu::int16::AffineNodeOp>(nodes, scalar);
 }
 
+// Like affinePrepared, but only computes the output columns in indices (uint32), e.g. for a shortlist.
+// bias covers all columns, bias and rangeA are optional and can be nullptr
+static inline Expr affinePreparedSelect(Expr a, Expr b, Expr bias, Expr indices, bool transB, float scalar, Expr rangeA) {
+  std::vector<Expr> nodes = {a, b};
+  if(bias)
+    nodes.push_back(bias);
+  nodes.push_back(indices);
+  if(rangeA)
+    nodes.push_back(rangeA);
+  return Expression<cpu::int16::PreparedInt8AffineNodeOp>(nodes, transB, scalar, bias != nullptr, /*hasIndices=*/true, rangeA != nullptr);
+}
+
+// bias and rangeA are optional and can be nullptr
+static inline Expr affinePrepared(Expr a, Expr b, Expr bias, bool transB, float scalar, Expr rangeA) {
+  std::vector<Expr> nodes = {a, b};
+  if(bias)
+    nodes.push_back(bias);
+  if(rangeA)
+    nodes.push_back(rangeA);
+  return Expression<cpu::int16::PreparedInt8AffineNodeOp>(nodes, transB, scalar, bias != nullptr, /*hasIndices=*/false, rangeA != nullptr);
+}
+
 static inline Expr quantize(Expr a, float clipValue) {
   return Expression<cpu::int16::QuantizeNodeOp>(a, clipValue);
 }
@@ -31,6 +31,50 @@ void ProdInt8(marian::Tensor C,
               float scale,
               float clipValue);
 
+// Returns the byte size of a weight matrix of the given shape in the prepared int8 format (Type::intgemm8).
+// The size does not depend on whether the matrix is prepared transposed or not.
+size_t PreparedInt8Bytes(const Shape& shape);
+
+// Quantizes a float weight matrix into int8 with one quantization multiplier per output column and
+// interleaves it into the tiled layout consumed by the VNNI (vpdpbusd) kernel. This is done offline
+// by marian-conv --gemm-type intgemm8, so no weight preparation happens when loading a model.
+// out: output tensor with at least PreparedInt8Bytes(shape) bytes
+// in: float data of the matrix
+// shape: shape of the matrix (k x n, or n x k if transpose)
+// transpose: the matrix is used transposed (e.g. tied output embeddings)
+void PrepareInt8(marian::Tensor out, const float* in, const Shape& shape, bool transpose);
+
+// Whether the prepared int8 matrix B was prepared with transpose, i.e. has to be used with transB.
+bool PreparedInt8Transposed(const marian::Tensor B);
+
+// C = scale * A * B (+ bias) with a prepared int8 matrix B. A is quantized on the fly, either with its
+// current absolute maximum or with the static range computed by marian-conv --calibration-data.
+// The kernel is selected at runtime: AVX512-VNNI, AVX512BW or a portable reference implementation.
+// bias: nullptr if there is no bias
+// quantRangeA: static quantization range [min, max] of A, nullptr for dynamic quantization
+void ProdPreparedInt8(marian::Tensor C,
+                      const marian::Tensor A,
+                      const marian::Tensor B,
+                      const marian::Tensor bias,
+                      float scale,
+                      const float* quantRangeA = nullptr);
+
+// C = scale * A * B[:, cols] (+ bias[cols]) with a prepared int8 matrix B, e.g. the output layer restricted to a
+// vocabulary shortlist. The selected columns are gathered from the prepared tiles on the fly, without creating a
+// float sub-matrix of B.
+// cols: uint32 tensor with the indices of the columns of B to compute, C has one column per index
+// bias: bias of all columns of B or nullptr
+void ProdPreparedInt8Select(marian::Tensor C,
+                            const marian::Tensor A,
+                            const marian::Tensor B,
+                            const marian::Tensor cols,
+                            const marian::Tensor bias,
+                            float scale,
+                            const float* quantRangeA = nullptr);
+
+// Name of the prepared int8 kernel selected for the CPU we are running on
+std::string PreparedInt8Kernel();
+
 }  // namespace int16
 }  // namespace cpu
 }  // namespace marian
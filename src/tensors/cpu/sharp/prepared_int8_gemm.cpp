@@ -0,0 +1,440 @@
+#include "int_gemm.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+// The kernels below are compiled for AVX512 independently of the global compiler flags and selected
+// at runtime, so a single binary can use VNNI where available and still run everywhere.
+#if defined(_MSC_VER)
+#define TARGET_AVX512BW
+#else
+#define TARGET_AVX512BW __attribute__((target("avx512f,avx512bw")))
+#endif
+
+// vpdpbusd is emitted with inline assembly on GCC and Clang (see DotAvx512vnni), which requires binutils 2.31+.
+// Compilers of that generation are used as a proxy.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 8
+#define NO_AVX512VNNI 1
+#endif
+
+namespace marian {
+namespace cpu {
+namespace int16 {
+
+namespace {
+
+// Layout of a prepared B matrix (k x n, i.e. C = A * B):
+//   header      : PREPARED_HEADER bytes, starts with {k, n, kPad, nPad, transposed} as int32_t
+//   tiles       : kPad * nPad int8 values. For every tile of 16 columns and every group of 4 rows
+//                 there are 64 consecutive bytes, column by column, 4 rows per column. This is
+//                 exactly the register layout consumed by vpdpbusd (one 32-bit lane per column).
+//   unquant     : nPad floats, 1 / quantization multiplier of each column
+//   compensation: nPad int32_t, 128 * sum of the quantized column. A is shifted by +128 to be
+//                 unsigned, the shift is subtracted again with this value.
+const size_t PREPARED_HEADER = 64;
+const int TILE_COLS = 16;
+const int GROUP_ROWS = 4;
+
+struct PreparedHeader {
+  int32_t k;
+  int32_t n;
+  int32_t kPad;
+  int32_t nPad;
+  int32_t transposed; // 1 if prepared from the transpose of the stored matrix, i.e. for a product with transB
+};
+
+inline int roundUp(int x, int multiple) {
+  return (x + multiple - 1) / multiple * multiple;
+}
+
+struct PreparedView {
+  PreparedHeader header;
+  const int8_t* tiles;
+  const float* unquant;
+  const int32_t* compensation;
+
+  PreparedView(const uint8_t* base) {
+    std::memcpy(&header, base, sizeof(header));
+    tiles = (const int8_t*)(base + PREPARED_HEADER);
+    unquant = (const float*)(tiles + (size_t)header.kPad * header.nPad);
+    compensation = (const int32_t*)(unquant + header.nPad);
+  }
+};
+
+enum class Int8Kernel { reference, avx512bw, avx512vnni };
+
+void cpuid(int info[4], int leaf, int subleaf) {
+#if defined(_MSC_VER)
+  __cpuidex(info, leaf, subleaf);
+#elif defined(__GNUC__)
+  unsigned int a, b, c, d;
+  __cpuid_count(leaf, subleaf, a, b, c, d);
+  info[0] = (int)a; info[1] = (int)b; info[2] = (int)c; info[3] = (int)d;
+#else
+  info[0] = info[1] = info[2] = info[3] = 0;
+#endif
+}
+
+uint64_t xgetbv() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#elif defined(__GNUC__)
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t)edx << 32) | eax;
+#else
+  return 0;
+#endif
+}
+
+Int8Kernel detectKernel() {
+  int info[4];
+  cpuid(info, 0, 0);
+  if(info[0] < 7)
+    return Int8Kernel::reference;
+
+  cpuid(info, 1, 0);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  // the OS has to save the opmask and all zmm registers on context switches
+  if(!osxsave || (xgetbv() & 0xE6) != 0xE6)
+    return Int8Kernel::reference;
+
+  cpuid(info, 7, 0);
+  bool avx512f    = (info[1] & (1 << 16)) != 0;
+  bool avx512bw   = (info[1] & (1 << 30)) != 0;
+  bool avx512vnni = (info[2] & (1 << 11)) != 0;
+
+  if(!avx512f || !avx512bw)
+    return Int8Kernel::reference;
+#ifndef NO_AVX512VNNI
+  if(avx512vnni)
+    return Int8Kernel::avx512vnni;
+#else
+  (void)avx512vnni;
+#endif
+  return Int8Kernel::avx512bw;
+}
+
+Int8Kernel selectedKernel() {
+  static const Int8Kernel kernel = detectKernel();
+  return kernel;
+}
+
+struct KernelArgs {
+  const uint8_t* A;      // m x kPad, shifted by +128
+  int m;
+  const PreparedView* B;
+  const IndexType* cols; // columns of B to compute, nullptr for all
+  int n;                 // number of columns to compute, size of cols or all columns of B
+  float unquantA;        // 1 / quantization multiplier of A times the scalar of the product
+  const float* bias;     // bias of all columns of B or nullptr
+  float* C;              // m x n
+};
+
+inline int32_t load32(const uint8_t* p) {
+  int32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+void referenceKernel(const KernelArgs& args) {
+  const auto& h = args.B->header;
+  const int groups = h.kPad / GROUP_ROWS;
+  for(int i = 0; i < args.m; ++i) {
+    const uint8_t* aRow = args.A + (size_t)i * h.kPad;
+    for(int j = 0; j < args.n; ++j) {
+      int col = args.cols ? (int)args.cols[j] : j;
+      const int8_t* tile = args.B->tiles + (size_t)(col / TILE_COLS) * groups * 64 + (col % TILE_COLS) * GROUP_ROWS;
+      int32_t acc = 0;
+      for(int g = 0; g < groups; ++g)
+        for(int r = 0; r < GROUP_ROWS; ++r)
+          acc += (int32_t)aRow[g * GROUP_ROWS + r] * (int32_t)tile[g * 64 + r];
+      float val = (acc - args.B->compensation[col]) * args.B->unquant[col] * args.unquantA;
+      args.C[(size_t)i * args.n + j] = args.bias ? val + args.bias[col] : val;
+    }
+  }
+}
+
+// Stores one row of a tile: removes the +128 shift of A, unquantizes and adds the bias
+TARGET_AVX512BW inline void storeTile(float* out, __mmask16 mask, __m512i acc, __m512i compensation, __m512 unquant, __m512 bias) {
+  __m512 val = _mm512_maskz_cvtepi32_ps(mask, _mm512_sub_epi32(acc, compensation));
+  val = _mm512_add_ps(_mm512_mul_ps(val, unquant), bias);
+  _mm512_mask_storeu_ps(out, mask, val);
+}
+
+// Exact emulation of vpdpbusd with AVX512BW. vpmaddubsw would saturate when adding two products
+// of a full-range unsigned and signed byte, so even and odd bytes of B are multiplied separately.
+struct DotAvx512bw {
+  TARGET_AVX512BW static inline __m512i dot(__m512i acc, __m512i a, __m512i b) {
+    const __m512i evenMask = _mm512_set1_epi16(0x00FF);
+    const __m512i oddMask = _mm512_set1_epi16((short)0xFF00);
+    const __m512i ones = _mm512_set1_epi16(1);
+    __m512i even = _mm512_maddubs_epi16(a, _mm512_and_si512(b, evenMask));
+    __m512i odd  = _mm512_maddubs_epi16(a, _mm512_and_si512(b, oddMask));
+    __m512i sum  = _mm512_add_epi32(_mm512_madd_epi16(even, ones), _mm512_madd_epi16(odd, ones));
+    return _mm512_add_epi32(acc, sum);
+  }
+};
+
+#ifndef NO_AVX512VNNI
+struct DotAvx512vnni {
+  TARGET_AVX512BW static inline __m512i dot(__m512i acc, __m512i a, __m512i b) {
+#if defined(_MSC_VER)
+    return _mm512_dpbusd_epi32(acc, a, b);
+#else
+    // Inline assembly instead of the intrinsic: the intrinsic would require the avx512vnni target for this
+    // function and thereby prevent inlining into the shared AVX512BW driver below.
+    __asm__("vpdpbusd %2, %1, %0" : "+v"(acc) : "v"(a), "v"(b));
+    return acc;
+#endif
+  }
+};
+#endif
+
+// Shared driver of the AVX512 kernels, Dot::dot computes one vpdpbusd (or its emulation).
+// Each tile of B (kPad x 16 bytes) stays in cache while 4 rows of A are processed at once.
+// With selected columns, every tile is first gathered from the 16 selected columns of B into a
+// scratch tile of the same layout, so only int8 data is copied.
+template <class Dot>
+TARGET_AVX512BW inline void avx512Kernel(const KernelArgs& args) {
+  const auto& h = args.B->header;
+  const int groups = h.kPad / GROUP_ROWS;
+  const __m512 unquantA = _mm512_set1_ps(args.unquantA);
+
+  static thread_local std::vector<int8_t> selectedTile;
+  if(args.cols && selectedTile.size() < (size_t)groups * 64)
+    selectedTile.resize((size_t)groups * 64);
+
+  for(int t = 0; t < (args.n + TILE_COLS - 1) / TILE_COLS; ++t) {
+    const int col = t * TILE_COLS;
+    const __mmask16 mask = args.n - col >= TILE_COLS ? (__mmask16)0xFFFF : (__mmask16)((1u << (args.n - col)) - 1);
+
+    const int8_t* tile;
+    __m512 unquant;
+    __m512i compensation;
+    __m512 bias = _mm512_setzero_ps();
+    if(args.cols) {
+      // byte offset of the first 4 rows of each selected column, relative to the start of a group of rows
+      const __m512i cols = _mm512_maskz_loadu_epi32(mask, args.cols + col);
+      const __m512i offsets = _mm512_add_epi32(
+          _mm512_mullo_epi32(_mm512_srli_epi32(cols, 4), _mm512_set1_epi32(groups * 64)),
+          _mm512_slli_epi32(_mm512_and_si512(cols, _mm512_set1_epi32(TILE_COLS - 1)), 2));
+      for(int g = 0; g < groups; ++g)
+        _mm512_storeu_si512(selectedTile.data() + g * 64,
+                            _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), mask, offsets, args.B->tiles + g * 64, 1));
+      tile = selectedTile.data();
+
+      unquant = _mm512_mul_ps(_mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, cols, args.B->unquant, 4), unquantA);
+      compensation = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), mask, cols, args.B->compensation, 4);
+      if(args.bias)
+        bias = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, cols, args.bias, 4);
+    } else {
+      tile = args.B->tiles + (size_t)t * groups * 64;
+      unquant = _mm512_mul_ps(_mm512_loadu_ps(args.B->unquant + col), unquantA);
+      compensation = _mm512_loadu_si512(args.B->compensation + col);
+      if(args.bias)
+        bias = _mm512_maskz_loadu_ps(mask, args.bias + col);
+    }
+
+    float* out = args.C + col;
+    int i = 0;
+    for(; i + 4 <= args.m; i += 4) {
+      const uint8_t* a0 = args.A + (size_t)i * h.kPad;
+      const uint8_t* a1 = a0 + h.kPad;
+      const uint8_t* a2 = a1 + h.kPad;
+      const uint8_t* a3 = a2 + h.kPad;
+      __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+      __m512i acc2 = _mm512_setzero_si512(), acc3 = _mm512_setzero_si512();
+      for(int g = 0; g < groups; ++g) {
+        __m512i b = _mm512_loadu_si512(tile + g * 64);
+        int offset = g * GROUP_ROWS;
+        acc0 = Dot::dot(acc0, _mm512_set1_epi32(load32(a0 + offset)), b);
+        acc1 = Dot::dot(acc1, _mm512_set1_epi32(load32(a1 + offset)), b);
+        acc2 = Dot::dot(acc2, _mm512_set1_epi32(load32(a2 + offset)), b);
+        acc3 = Dot::dot(acc3, _mm512_set1_epi32(load32(a3 + offset)), b);
+      }
+      storeTile(out + (size_t)i * args.n, mask, acc0, compensation, unquant, bias);
+      storeTile(out + (size_t)(i + 1) * args.n, mask, acc1, compensation, unquant, bias);
+      storeTile(out + (size_t)(i + 2) * args.n, mask, acc2, compensation, unquant, bias);
+      storeTile(out + (size_t)(i + 3) * args.n, mask, acc3, compensation, unquant, bias);
+    }
+    for(; i < args.m; ++i) {
+      const uint8_t* a0 = args.A + (size_t)i * h.kPad;
+      __m512i acc0 = _mm512_setzero_si512();
+      for(int g = 0; g < groups; ++g)
+        acc0 = Dot::dot(acc0, _mm512_set1_epi32(load32(a0 + g * GROUP_ROWS)), _mm512_loadu_si512(tile + g * 64));
+      storeTile(out + (size_t)i * args.n, mask, acc0, compensation, unquant, bias);
+    }
+  }
+}
+
+TARGET_AVX512BW void avx512bwKernel(const KernelArgs& args) {
+  avx512Kernel<DotAvx512bw>(args);
+}
+
+#ifndef NO_AVX512VNNI
+TARGET_AVX512BW void avx512vnniKernel(const KernelArgs& args) {
+  avx512Kernel<DotAvx512vnni>(args);
+}
+#endif
+
+}  // namespace
+
+size_t PreparedInt8Bytes(const Shape& shape) {
+  // Padding both dimensions to full tiles makes the size independent of the orientation
+  // of the matrix (see transpose in PrepareInt8).
+  int rows = roundUp((int)(shape.elements() / shape[-1]), TILE_COLS);
+  int cols = roundUp(shape[-1], TILE_COLS);
+  return PREPARED_HEADER + (size_t)rows * cols + (size_t)std::max(rows, cols) * (sizeof(float) + sizeof(int32_t));
+}
+
+void PrepareInt8(marian::Tensor out, const float* in, const Shape& shape, bool transpose) {
+  int rows = (int)(shape.elements() / shape[-1]);
+  int cols = shape[-1];
+
+  PreparedHeader header;
+  header.k = transpose ? cols : rows;
+  header.n = transpose ? rows : cols;
+  header.kPad = roundUp(header.k, GROUP_ROWS);
+  header.nPad = roundUp(header.n, TILE_COLS);
+  header.transposed = transpose ? 1 : 0;
+
+  uint8_t* base = out->data<uint8_t>();
+  std::fill(base, base + PreparedInt8Bytes(shape), (uint8_t)0);
+  std::memcpy(base, &header, sizeof(header));
+
+  PreparedView view(base);
+  int8_t* tiles = (int8_t*)view.tiles;
+  float* unquant = (float*)view.unquant;
+  int32_t* compensation = (int32_t*)view.compensation;
+
+  auto get = [&](int kk, int j) { return transpose ? in[(size_t)j * header.k + kk] : in[(size_t)kk * header.n + j]; };
+
+  const int groups = header.kPad / GROUP_ROWS;
+  for(int j = 0; j < header.n; ++j) {
+    // symmetric quantization into [-127, 127] with one multiplier per output column
+    float absMax = 0.f;
+    for(int kk = 0; kk < header.k; ++kk)
+      absMax = std::max(absMax, std::abs(get(kk, j)));
+    float quantMult = absMax > 0.f ? 127.f / absMax : 1.f;
+    unquant[j] = 1.f / quantMult;
+
+    int32_t sum = 0;
+    int8_t* tile = tiles + (size_t)(j / TILE_COLS) * groups * 64 + (j % TILE_COLS) * GROUP_ROWS;
+    for(int kk = 0; kk < header.k; ++kk) {
+      float q = std::round(get(kk, j) * quantMult);
+      int8_t v = (int8_t)std::max(-127.f, std::min(127.f, q));
+      tile[(kk / GROUP_ROWS) * 64 + kk % GROUP_ROWS] = v;
+      sum += v;
+    }
+    compensation[j] = 128 * sum;
+  }
+}
+
+bool PreparedInt8Transposed(const marian::Tensor B) {
+  return PreparedView(B->data<uint8_t>()).header.transposed != 0;
+}
+
+namespace {
+
+// C = scale * A * B[:, cols] (+ bias[cols]), all columns if cols is nullptr
+void prodPreparedInt8(marian::Tensor C,
+                      const marian::Tensor A,
+                      const marian::Tensor B,
+                      const IndexType* cols,
+                      int numCols,
+                      const marian::Tensor bias,
+                      float scale,
+                      const float* quantRangeA) {
+  PreparedView view(B->data<uint8_t>());
+  const auto& h = view.header;
+
+  int m = (int)(A->shape().elements() / A->shape()[-1]);
+  int k = A->shape()[-1];
+  ABORT_IF(k != h.k, "Inner dimension of A ({}) does not match prepared int8 matrix ({} x {})", k, h.k, h.n);
+
+  const float* dataA = A->data();
+  size_t elemA = (size_t)m * k;
+
+  // symmetric quantization of A, either with the calibrated or the current range
+  float absMax = 0.f;
+  if(quantRangeA) {
+    absMax = std::max(std::abs(quantRangeA[0]), std::abs(quantRangeA[1]));
+  } else {
+    for(size_t i = 0; i < elemA; ++i)
+      absMax = std::max(absMax, std::abs(dataA[i]));
+  }
+  float quantMultA = absMax > 0.f ? 127.f / absMax : 1.f;
+
+  // To avoid any repeated memory allocation and deallocation, make the scratch buffer static thread_local
+  static thread_local std::vector<uint8_t> quantizedA;
+  if(quantizedA.size() < (size_t)m * h.kPad)
+    quantizedA.resize((size_t)m * h.kPad);
+
+  for(int i = 0; i < m; ++i) {
+    const float* row = dataA + (size_t)i * k;
+    uint8_t* qRow = quantizedA.data() + (size_t)i * h.kPad;
+    for(int kk = 0; kk < k; ++kk) {
+      float q = std::round(row[kk] * quantMultA);
+      qRow[kk] = (uint8_t)(std::max(-127.f, std::min(127.f, q)) + 128.f);
+    }
+    // padding is multiplied with zeros in B
+    std::fill(qRow + k, qRow + h.kPad, (uint8_t)128);
+  }
+
+  KernelArgs args{quantizedA.data(), m, &view, cols, cols ? numCols : h.n, scale / quantMultA, bias ? bias->data() : nullptr, C->data()};
+  switch(selectedKernel()) {
+#ifndef NO_AVX512VNNI
+    case Int8Kernel::avx512vnni: avx512vnniKernel(args); break;
+#endif
+    case Int8Kernel::avx512bw:   avx512bwKernel(args); break;
+    default:                     referenceKernel(args); break;
+  }
+}
+
+}  // namespace
+
+void ProdPreparedInt8(marian::Tensor C,
+                      const marian::Tensor A,
+                      const marian::Tensor B,
+                      const marian::Tensor bias,
+                      float scale,
+                      const float* quantRangeA) {
+  prodPreparedInt8(C, A, B, /*cols=*/nullptr, 0, bias, scale, quantRangeA);
+}
+
+void ProdPreparedInt8Select(marian::Tensor C,
+                            const marian::Tensor A,
+                            const marian::Tensor B,
+                            const marian::Tensor cols,
+                            const marian::Tensor bias,
+                            float scale,
+                            const float* quantRangeA) {
+  PreparedView view(B->data<uint8_t>());
+  ABORT_IF((size_t)view.header.kPad * view.header.nPad > (size_t)std::numeric_limits<int32_t>::max(),
+           "Prepared int8 matrix ({} x {}) too large for selecting columns", view.header.k, view.header.n);
+  prodPreparedInt8(C, A, B, cols->data<IndexType>(), (int)cols->size(), bias, scale, quantRangeA);
+}
+
+std::string PreparedInt8Kernel() {
+  switch(selectedKernel()) {
+    case Int8Kernel::avx512vnni: return "avx512vnni";
+    case Int8Kernel::avx512bw:   return "avx512bw";
+    default:                     return "reference";
+  }
+}
+
+}  // namespace int16
+}  // namespace cpu
+}  // namespace marian
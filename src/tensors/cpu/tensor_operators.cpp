@@ -551,12 +551,116 @@ void LogSoftmaxGrad(Tensor grad_, Tensor adj_, Tensor val_) {
   }
 }
 
+// Layout of a row-quantized matrix (Type::rowquant8) with R rows and C columns:
+//   values: R * C int8 values, row by row
+//   scales: R floats, the value of an element is scales[row] * values[row * C + col]
+void QuantizeRows8(Tensor out_, const Tensor in_) {
+  matchOrAbort<rowquant8>(out_->type());
+  matchOrAbort<float>(in_->type());
+  ABORT_IF(out_->shape() != in_->shape(), "Shapes of quantized ({}) and float ({}) matrices do not match", out_->shape(), in_->shape());
+
+  size_t cols = in_->shape()[-1];
+  size_t rows = in_->shape().elements() / cols;
+
+  const float* in = in_->data();
+  int8_t* values = out_->data<int8_t>();
+  float* scales = (float*)(values + rows * cols);
+
+#pragma omp parallel for
+  for(size_t j = 0; j < rows; ++j) {
+    const float* rowIn = in + j * cols;
+    float absMax = 0.f;
+    for(size_t i = 0; i < cols; ++i)
+      absMax = std::max(absMax, std::abs(rowIn[i]));
+
+    // symmetric quantization to [-127, 127], all-zero rows keep a zero scale
+    float scale = absMax / 127.f;
+    float quantMult = absMax > 0.f ? 127.f / absMax : 0.f;
+    int8_t* rowOut = values + j * cols;
+    for(size_t i = 0; i < cols; ++i)
+      rowOut[i] = (int8_t)std::max(-127.f, std::min(127.f, std::round(rowIn[i] * quantMult)));
+    scales[j] = scale;
+  }
+}
+
+void AdamUpdate(Tensor params_,
+                Tensor grads_,
+                Tensor mt_,
+                Tensor vt_,
+                Tensor paramsAvg_,
+                const AdamUpdateArgs& args) {
+  matchOrAbort<float>(params_->type());
+  matchOrAbort<float>(grads_->type());
+  size_t n = params_->size();
+  ABORT_IF(grads_->size() != n || mt_->size() != n || vt_->size() != n
+           || (paramsAvg_ && paramsAvg_->size() != n),
+           "Fused Adam update requires tensors of equal size");
+
+  float* params = params_->data();
+  float* grads = grads_->data();
+  float* mt = mt_->data();
+  float* vt = vt_->data();
+  float* paramsAvg = paramsAvg_ ? paramsAvg_->data() : nullptr;
+
+  // same operations in the same order as the separate passes in Adam::updateImpl(), the clippers
+  // and ExponentialSmoothing::updateAvgParams()
+  // Single-threaded unless built with OpenMP, which the build does not enable by default. The graph
+  // groups already update their shards from separate threads.
+#pragma omp parallel for
+  for(size_t i = 0; i < n; ++i) {
+    float g = args.gradScale * grads[i];
+    if(args.clipValue != 0.f && std::abs(g) >= args.clipValue)
+      g = g > 0.f ? args.clipValue : -args.clipValue;
+
+    float m = args.beta1 * mt[i] + args.mScale * g;
+    float v = args.beta2 * vt[i] + args.vScale * (g * g);
+    mt[i] = m;
+    vt[i] = v;
+
+    float p = params[i];
+    p -= args.eta * (((m / args.denom1) / (std::sqrt(v / args.denom2) + args.eps)) + args.decay * p);
+    params[i] = p;
+
+    if(paramsAvg)
+      paramsAvg[i] = ((1.f - args.avgDecay) * paramsAvg[i]) + (args.avgDecay * p);
+    if(args.resetGrads)
+      grads[i] = 0.f;
+  }
+}
+
+// Row lookup from a row-quantized matrix, dequantizes the gathered rows into float32
+static void CopyRowsQuantized8(Tensor out_, const Tensor in_, const Tensor indices) {
+  matchOrAbort<float>(out_->type());
+
+  size_t cols = in_->shape()[-1];
+  size_t inRows = in_->shape().elements() / cols;
+  size_t rows = indices->size();
+
+  float* out = out_->data();
+  const int8_t* values = in_->data<int8_t>();
+  const float* scales = (const float*)(values + inRows * cols);
+  const IndexType* idx = indices->data<IndexType>();
+
+#pragma omp parallel for
+  for(size_t j = 0; j < rows; ++j) {
+    size_t src = (size_t)idx[j];
+    const int8_t* rowIn = values + src * cols;
+    float* rowOut = out + j * cols;
+    float scale = scales[src];
+    for(size_t i = 0; i < cols; ++i) // vectorized by the compiler
+      rowOut[i] = scale * (float)rowIn[i];
+  }
+}
+
 void CopyRows(Tensor out_,
               const Tensor in_,
               const Tensor indices) {
 
   matchOrAbort<IndexType>(indices->type());
 
+  if(isRowQuant(in_->type()))
+    return CopyRowsQuantized8(out_, in_, indices);
+
   size_t cols = in_->shape()[-1];
   size_t rows = indices->size();
 
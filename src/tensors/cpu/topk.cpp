@@ -1,5 +1,6 @@
 #include "tensors/tensor_operators.h"
 #include "tensors/allocator.h"
+#include <algorithm>
 #include <numeric>
 
 // CPU implementation of proper Marian top-k operator for TopkNodeOp
@@ -28,6 +29,19 @@ void TopK(Tensor outVal, Tensor outInd, Ptr<Allocator> /*allocator*/, const Tens
   const float* inDataPtr = in->data<float>();
   IndexType* outIndPtr   = outInd->data<IndexType>();
   float* outValPtr       = outVal->data<float>();
+
+  // argmax (or argmin), e.g. for greedy search: a single pass over each row, ties go to the first index
+  if(k == 1) {
+    for(int i = 0; i < rows; ++i) {
+      const float* rowPtr = inDataPtr + (size_t)i * cols;
+      const float* bestPtr = descending ? std::max_element(rowPtr, rowPtr + cols)
+                                        : std::min_element(rowPtr, rowPtr + cols);
+      outIndPtr[i] = (IndexType)(bestPtr - rowPtr);
+      outValPtr[i] = *bestPtr;
+    }
+    return;
+  }
+
   for(int i = 0; i < rows; ++i) {
     std::partial_sort( 
       // sorts the top N (beam size) idxs by score to the front
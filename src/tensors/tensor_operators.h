@@ -229,6 +229,38 @@ DISPATCH2(LSTMCellForward, marian::Tensor, std::vector<marian::Tensor>)
 DISPATCH2(LSTMOutputForward, marian::Tensor, std::vector<marian::Tensor>);
 // clang-format on
 
+namespace cpu {
+// Quantizes the rows of a float32 matrix into a Type::rowquant8 tensor of the same shape, one scale
+// per row. CopyRows() on such a tensor dequantizes the selected rows into float32.
+void QuantizeRows8(marian::Tensor out, const marian::Tensor in);
+
+// Scalars of a fused Adam update, see AdamUpdate()
+struct AdamUpdateArgs {
+  float gradScale;   // gradients are multiplied by this, e.g. for gradient-norm clipping
+  float clipValue;   // then clipped to [-clipValue, clipValue] if not 0
+  float beta1;       // m = beta1 * m + mScale * g
+  float mScale;
+  float beta2;       // v = beta2 * v + vScale * g * g
+  float vScale;
+  float eta;         // p -= eta * ((m / denom1) / (sqrt(v / denom2) + eps) + decay * p)
+  float denom1;
+  float denom2;
+  float eps;
+  float decay;
+  float avgDecay;    // avg = (1 - avgDecay) * avg + avgDecay * p if an average is given
+  bool resetGrads;   // set gradients to 0 afterwards
+};
+
+// Adam update of params with gradient clipping, exponential smoothing of the parameters into
+// paramsAvg (may be null) and gradient reset in a single pass over all tensors.
+void AdamUpdate(marian::Tensor params,
+                marian::Tensor grads,
+                marian::Tensor mt,
+                marian::Tensor vt,
+                marian::Tensor paramsAvg,
+                const AdamUpdateArgs& args);
+}
+
 #ifdef CUDA_FOUND
 namespace gpu {
 void LSTMCellBackward(std::vector<marian::Tensor> outputs,
@@ -0,0 +1,125 @@
+#include "catch.hpp"
+#include "common/config.h"
+#include "data/batch_stats.h"
+#include "data/corpus.h"
+#include "data/corpus_binary.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace marian;
+using namespace data;
+
+namespace {
+
+void writeLines(const std::string& path, const std::vector<std::string>& lines) {
+  std::ofstream out(path);
+  for(const auto& line : lines)
+    out << line << "\n";
+}
+
+std::vector<SentenceTuple> readAll(Ptr<CorpusBase> corpus) {
+  std::vector<SentenceTuple> samples;
+  for(auto sample = corpus->next(); !sample.empty(); sample = corpus->next())
+    samples.push_back(sample);
+  return samples;
+}
+
+void checkSameData(Ptr<CorpusBase> text, Ptr<CorpusBase> binary) {
+  auto textSamples = readAll(text);
+  auto binarySamples = readAll(binary);
+  REQUIRE(textSamples.size() == binarySamples.size());
+  for(size_t i = 0; i < textSamples.size(); ++i) {
+    REQUIRE(textSamples[i].size() == binarySamples[i].size());
+    for(size_t j = 0; j < textSamples[i].size(); ++j)
+      CHECK(textSamples[i][j] == binarySamples[i][j]);
+  }
+
+  auto textBatch = text->toBatch(textSamples);
+  auto binaryBatch = binary->toBatch(binarySamples);
+  REQUIRE(textBatch->sets() == binaryBatch->sets());
+  for(size_t i = 0; i < textBatch->sets(); ++i) {
+    CHECK((*textBatch)[i]->data() == (*binaryBatch)[i]->data());
+    CHECK((*textBatch)[i]->mask() == (*binaryBatch)[i]->mask());
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Binary corpus yields the same batches as the text corpus", "[data]") {
+  std::string prefix = "data_tests.corpus";
+  std::vector<std::string> files = {prefix + ".src", prefix + ".trg", prefix + ".src.yml",
+                                    prefix + ".trg.yml", prefix + ".bin"};
+  for(const auto& file : files)
+    std::remove(file.c_str());
+
+  writeLines(files[0], {"a b c", "b c d e", "c", "d e f g h i j", "a a b"});
+  writeLines(files[1], {"x y", "y z", "z z z", "x", "w x y z"});
+
+  // the fourth and fifth sentence pairs are cropped by --max-length
+  std::vector<std::string> args = {"marian", "-t", files[0], files[1], "-v", files[2], files[3],
+                                   "--binary-corpus", files[4], "--max-length", "4",
+                                   "--max-length-crop", "--shuffle", "none"};
+  std::vector<char*> argv;
+  for(auto& arg : args)
+    argv.push_back(&arg[0]);
+  auto options = parseOptions((int)argv.size(), argv.data(), cli::mode::training, /*validate=*/false);
+
+  auto text = New<Corpus>(options); // creates the vocabularies
+  auto binary = New<CorpusBinary>(options);
+  checkSameData(text, binary);
+
+  SECTION("a changed text corpus recreates the binary corpus") {
+    writeLines(files[0], {"c b a", "e d c b", "b", "a b c d e f g", "b a a", "c c"});
+    writeLines(files[1], {"y x", "z y", "z z", "x x", "z y x w", "w"});
+    checkSameData(New<Corpus>(options), New<CorpusBinary>(options));
+  }
+
+  for(const auto& file : files)
+    std::remove(file.c_str());
+}
+
+TEST_CASE("Mini-batch-fit statistics are only reused for the same memory configuration", "[data]") {
+  auto options = New<Options>("type", std::string("transformer"),
+                              "dim-emb", 512,
+                              "workspace", (size_t)2048,
+                              "max-length", (size_t)100,
+                              "mini-batch-fit-step", (size_t)10,
+                              "train-sets", std::vector<std::string>({"corpus.src", "corpus.trg"}),
+                              "disp-freq", std::string("1000u"));
+  auto key = BatchStats::configKey(options, /*numMPIProcesses=*/1);
+
+  SECTION("the key only depends on options that affect memory use") {
+    CHECK(BatchStats::configKey(options->with("dim-emb", 512), 1) == key);
+    CHECK(BatchStats::configKey(options->with("train-sets", std::vector<std::string>({"other.src", "other.trg"}),
+                                              "disp-freq", std::string("10u"),
+                                              "learn-rate", 0.1f), 1) == key);
+
+    CHECK(BatchStats::configKey(options->with("dim-emb", 256), 1) != key);
+    CHECK(BatchStats::configKey(options->with("workspace", (size_t)4096), 1) != key);
+    CHECK(BatchStats::configKey(options->with("max-length", (size_t)200), 1) != key);
+    CHECK(BatchStats::configKey(options->with("gradient-checkpointing", true), 1) != key);
+    CHECK(BatchStats::configKey(options, /*numMPIProcesses=*/2) != key);
+  }
+
+  SECTION("saved statistics are loaded with the same key only") {
+    std::string file = "data_tests.batch-stats.yml";
+    std::remove(file.c_str());
+
+    // two streams, (source length, target length) -> batch size
+    BatchStats stats(std::vector<size_t>({2, 10, 10, 64, 20, 10, 40, 20, 20, 16}));
+    BatchStats loaded;
+    CHECK(!loaded.load(file, key));
+
+    stats.save(file, key);
+    CHECK(!loaded.load(file, BatchStats::configKey(options->with("dim-emb", 256), 1)));
+    CHECK(loaded.flatten().empty());
+
+    REQUIRE(loaded.load(file, key));
+    CHECK(loaded.flatten() == stats.flatten());
+    auto it = loaded.begin();
+    CHECK(loaded.findBatchSize({15, 12}, it) == 16);
+
+    std::remove(file.c_str());
+  }
+}
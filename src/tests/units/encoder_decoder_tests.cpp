@@ -0,0 +1,111 @@
+#include "catch.hpp"
+#include "graph/expression_graph.h"
+#include "models/encoder_decoder.h"
+
+using namespace marian;
+
+namespace {
+
+// encoder state with a member of its own
+class TaggedEncoderState : public EncoderState {
+public:
+  std::string tag;
+
+  TaggedEncoderState(Expr context, Expr mask, Ptr<data::CorpusBatch> batch, const std::string& tag)
+      : EncoderState(context, mask, batch), tag(tag) {}
+
+  virtual Ptr<EncoderState> clone() const override { return New<TaggedEncoderState>(*this); }
+};
+
+// context [1, batch size, 1] holds the first source word of each sentence, counts the encoded sentences
+class TaggingEncoder : public EncoderBase {
+public:
+  size_t encoded{0};
+
+  TaggingEncoder(Ptr<ExpressionGraph> graph, Ptr<Options> options) : EncoderBase(graph, options) {}
+
+  virtual Ptr<EncoderState> build(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch) override {
+    auto source = batch->front();
+    std::vector<float> firstWords;
+    for(size_t b = 0; b < source->batchSize(); ++b)
+      firstWords.push_back((float)source->data()[source->locate(b, 0)].toWordIndex());
+    encoded += firstWords.size();
+
+    int dimBatch = (int)firstWords.size();
+    auto context = graph->constant({1, dimBatch, 1}, inits::fromVector(firstWords));
+    auto mask = graph->constant({1, dimBatch, 1}, inits::ones());
+    return New<TaggedEncoderState>(context, mask, batch, "tagged");
+  }
+
+  virtual void clear() override {}
+};
+
+// keeps the encoder states it starts from
+class RecordingDecoder : public DecoderBase {
+public:
+  std::vector<Ptr<EncoderState>> encStates;
+
+  RecordingDecoder(Ptr<ExpressionGraph> graph, Ptr<Options> options) : DecoderBase(graph, options) {}
+
+  virtual Ptr<DecoderState> startState(Ptr<ExpressionGraph>,
+                                       Ptr<data::CorpusBatch> batch,
+                                       std::vector<Ptr<EncoderState>>& encStates) override {
+    this->encStates = encStates;
+    return New<DecoderState>(rnn::States(), Logits(), encStates, batch);
+  }
+
+  virtual Ptr<DecoderState> step(Ptr<ExpressionGraph>, Ptr<DecoderState> state) override { return state; }
+
+  virtual void clear() override {}
+};
+
+// sub-batch with one sentence of a single word per entry of words
+Ptr<data::SubBatch> singleWords(const std::vector<WordIndex>& words) {
+  auto subBatch = New<data::SubBatch>(words.size(), 1, nullptr);
+  for(size_t b = 0; b < words.size(); ++b) {
+    subBatch->data()[subBatch->locate(b, 0)] = Word::fromWordIndex(words[b]);
+    subBatch->mask()[subBatch->locate(b, 0)] = 1.f;
+  }
+  return subBatch;
+}
+
+}  // namespace
+
+TEST_CASE("Shared encoder states keep the type of the encoder state", "[models]") {
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  // n-best candidates of the sources 5, 7 and 5 again
+  auto options = New<Options>("inference", true, "n-best-share-encoder", true);
+  auto batch = New<data::CorpusBatch>(std::vector<Ptr<data::SubBatch>>(
+      {singleWords({5, 7, 5, 7, 5}), singleWords({1, 2, 3, 4, 6})}));
+
+  auto model = New<EncoderDecoder>(graph, options);
+  auto encoder = New<TaggingEncoder>(graph, options);
+  auto decoder = New<RecordingDecoder>(graph, options);
+  model->push_back(encoder);
+  model->push_back(decoder);
+  model->startState(graph, batch);
+
+  REQUIRE(decoder->encStates.size() == 1);
+  auto state = std::dynamic_pointer_cast<TaggedEncoderState>(decoder->encStates[0]);
+  REQUIRE(state);
+  // selecting active batch entries keeps the type as well
+  auto selected = std::dynamic_pointer_cast<TaggedEncoderState>(state->select({4, 1}));
+  REQUIRE(selected);
+  graph->forward();
+
+  // every distinct source is encoded once
+  CHECK(encoder->encoded == 2);
+
+  CHECK(state->tag == "tagged");
+  CHECK(state->getSourceWords() == batch->front()->data());
+  std::vector<float> context;
+  state->getContext()->val()->get(context);
+  CHECK(context == std::vector<float>({5, 7, 5, 7, 5}));
+
+  CHECK(selected->tag == "tagged");
+  selected->getContext()->val()->get(context);
+  CHECK(context == std::vector<float>({5, 7}));
+}
@@ -1,11 +1,16 @@
 #include "catch.hpp"
+#include "graph/auto_tuner.h"
 #include "graph/expression_graph.h"
 #include "graph/expression_operators.h"
+#include "graph/parameter_store.h"
 
 #ifdef CUDA_FOUND
 #include "tensors/gpu/backend.h"
 #endif
 
+#include <cstdio>
+#include <fstream>
+
 using namespace marian;
 
 #ifdef CUDA_FOUND
@@ -121,3 +126,211 @@ TEST_CASE("Expression graph can be initialized with constant values (cpu)",
     REQUIRE(values == v);
   }
 }
+
+TEST_CASE("Graphs share parameters from the parameter store (cpu)", "[graph]") {
+  std::string modelFile = "test_parameter_store.npz";
+  std::vector<float> v({1, 2, 3, 4, 5, 6});
+  {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice({0, DeviceType::cpu});
+    graph->reserveWorkspaceMB(4);
+    graph->param("vs", {2, 3}, inits::fromVector(v));
+    graph->forward();
+    graph->save(modelFile);
+  }
+
+  auto model = ParameterStore::get(modelFile, Type::float32);
+  REQUIRE(ParameterStore::get(modelFile, Type::float32) == model);
+
+  std::vector<Ptr<ExpressionGraph>> graphs;
+  for(int i = 0; i < 2; ++i) {
+    auto graph = New<ExpressionGraph>(/*inference=*/true);
+    graph->setDevice({0, DeviceType::cpu});
+    graph->reserveWorkspaceMB(4);
+    graph->mmap(model->data());
+    graph->forward();
+    graphs.push_back(graph);
+  }
+
+  std::vector<float> values;
+  auto vals0 = graphs[0]->get("vs");
+  auto vals1 = graphs[1]->get("vs");
+  REQUIRE(vals0->val()->data() == vals1->val()->data());
+
+  vals1->val()->get(values);
+  REQUIRE(values == v);
+
+  std::remove(modelFile.c_str());
+}
+
+TEST_CASE("Memory planner follows tensor lifetimes (cpu)", "[graph]") {
+  std::vector<float> v(256, 1.f); // 1024 bytes per tensor
+
+  SECTION("inference releases tensors once their parents have run") {
+    auto graph = New<ExpressionGraph>(/*inference=*/true);
+    graph->setDevice({0, DeviceType::cpu});
+    graph->reserveWorkspaceMB(4);
+
+    auto x = graph->constant({4, 64}, inits::fromVector(v));
+    auto y = x * 2.f;
+    auto z = y + 1.f;
+    auto w = z * 3.f;
+
+    // only a node and its child are alive at the same time
+    CHECK(graph->planWorkspace() == 2 * 1024);
+  }
+
+  SECTION("training keeps values for the backward pass") {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice({0, DeviceType::cpu});
+    graph->reserveWorkspaceMB(4);
+
+    auto p = graph->param("p", {4, 64}, inits::fromVector(v));
+    auto y = p * 2.f;
+    auto z = y * 3.f;
+    auto cost = sum(sum(z, -1), -2);
+
+    // values of y, z and the two sums, plus at least the gradient of the cost
+    CHECK(graph->planWorkspace() > 2 * 1024 + 2 * 256);
+  }
+
+  SECTION("inference with statically planned memory computes the same values") {
+    auto graph = New<ExpressionGraph>(/*inference=*/true);
+    graph->setDevice({0, DeviceType::cpu});
+    graph->setStaticMemoryPlanning(true);
+    graph->reserveWorkspaceMB(4);
+
+    auto x = graph->constant({4, 64}, inits::fromVector(v));
+    auto w = ((x * 2.f) + 1.f) * 3.f; // intermediate results live in the planned arena
+    graph->forward();
+
+    std::vector<float> values;
+    w->val()->get(values);
+    CHECK(values == std::vector<float>(256, 9.f));
+  }
+
+  SECTION("statically planned passes of the same shapes reuse the plan and the arena") {
+    auto graph = New<ExpressionGraph>(/*inference=*/true);
+    graph->setDevice({0, DeviceType::cpu});
+    graph->setStaticMemoryPlanning(true);
+    graph->reserveWorkspaceMB(4);
+
+    auto x = graph->constant({4, 64}, inits::fromVector(v));
+    std::vector<float> values;
+    for(int i = 1; i <= 3; ++i) { // other constants, but the same shapes as in the pass before
+      auto w = ((x * (float)i) + 1.f) * 3.f;
+      graph->forward();
+      w->val()->get(values);
+      CHECK(values == std::vector<float>(256, 3.f * (i + 1)));
+    }
+
+    auto y = graph->constant({8, 64}, inits::fromVector(std::vector<float>(512, 2.f)));
+    auto w = ((y * 2.f) + 1.f) * 3.f; // larger shapes, planned anew
+    graph->forward();
+    w->val()->get(values);
+    CHECK(values == std::vector<float>(512, 15.f));
+  }
+
+  SECTION("a planned tensor that outlives the pass keeps its memory") {
+    auto graph = New<ExpressionGraph>(/*inference=*/true);
+    graph->setDevice({0, DeviceType::cpu});
+    graph->setStaticMemoryPlanning(true);
+    graph->reserveWorkspaceMB(4);
+
+    // the lambda holds on to the value of its child, which the planner cannot see
+    Tensor kept;
+    auto x = graph->constant({4, 64}, inits::fromVector(v));
+    auto keep = [&](Expr out, const std::vector<Expr>& inputs) {
+      kept = inputs[0]->val();
+      out->val()->set(0.f);
+    };
+    auto w = lambda({(x * 2.f) + 1.f}, {4, 64}, Type::float32, keep) * 3.f;
+    graph->forward();
+
+    // the next pass must not overwrite the kept tensor
+    auto u = ((x * 5.f) + 4.f) * 7.f;
+    graph->forward();
+
+    std::vector<float> values;
+    kept->get(values);
+    CHECK(values == std::vector<float>(256, 3.f));
+    u->val()->get(values);
+    CHECK(values == std::vector<float>(256, 63.f));
+  }
+}
+
+// the cache is process-wide, hence every section uses hashes of its own
+TEST_CASE("Autotuner decisions are saved and loaded", "[graph]") {
+  std::string file = "graph_tests.autotune";
+  std::remove(file.c_str());
+
+  // returns the decisions in the file and sets its header line
+  auto readFile = [&](std::string& header) {
+    std::map<uint64_t, std::string> saved;
+    std::ifstream in(file);
+    std::getline(in, header);
+    uint64_t hash;
+    std::string name;
+    while(in >> hash >> name)
+      saved[hash] = name;
+    return saved;
+  };
+
+  std::string header, name;
+
+  SECTION("new decisions are written to the file") {
+    AutoTunerCache::load(file); // does not exist yet
+    CHECK(!AutoTunerCache::get(1001, name));
+    AutoTunerCache::put(1001, "packed16");
+    AutoTunerCache::put(1002, "float32");
+    REQUIRE(AutoTunerCache::get(1001, name));
+    CHECK(name == "packed16");
+    AutoTunerCache::flush();
+
+    auto saved = readFile(header);
+    CHECK(header.find("marian-autotune-cache ") == 0);
+    CHECK(saved[1001] == "packed16");
+    CHECK(saved[1002] == "float32");
+  }
+
+  SECTION("decisions in a file of the current version are used") {
+    AutoTunerCache::load(file);
+    AutoTunerCache::put(1003, "packed16");
+    AutoTunerCache::flush();
+    readFile(header);
+    {
+      std::ofstream out(file);
+      out << header << "\n1004 int16\n";
+    }
+    AutoTunerCache::load(file);
+    REQUIRE(AutoTunerCache::get(1004, name));
+    CHECK(name == "int16");
+  }
+
+  SECTION("decisions in a file of another version are ignored") {
+    {
+      std::ofstream out(file);
+      out << "marian-autotune-cache 0\n1005 int16\n";
+    }
+    AutoTunerCache::load(file);
+    CHECK(!AutoTunerCache::get(1005, name));
+  }
+
+  std::remove(file.c_str());
+}
+
+TEST_CASE("Autotuners only use decisions for algorithms they know", "[graph]") {
+  AutoTuner<int> tuner;
+  tuner.insert({2001, []() { return 0; }, "first"});
+  tuner.insert({2002, []() { return 1; }, "second"});
+
+  SECTION("a decision for a known algorithm is used right away") {
+    AutoTunerCache::put(2002, "second");
+    CHECK(tuner.run() == 1);
+  }
+
+  SECTION("a decision for an unknown algorithm is ignored and the algorithms are timed") {
+    AutoTunerCache::put(2002, "removed");
+    CHECK(tuner.run() == 0);
+  }
+}
@@ -0,0 +1,156 @@
+#include "catch.hpp"
+#include "common/io.h"
+#include "graph/expression_graph.h"
+#include "graph/expression_operators.h"
+#include "layers/lsh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <utility>
+
+using namespace marian;
+
+namespace {
+
+int bruteForceHamming(const uint8_t* a, const uint8_t* b, int nbits) {
+  int distance = 0;
+  for(int j = 0; j < nbits; ++j)
+    distance += ((a[j / 8] >> (j % 8)) & 1) != ((b[j / 8] >> (j % 8)) & 1);
+  return distance;
+}
+
+// ids of the k nearest codes ordered by distance and ties by id, the order promised by lsh::search
+std::vector<IndexType> bruteForceSearch(const uint8_t* query, const std::vector<uint8_t>& codes,
+                                        int numCodes, int nbits, int k) {
+  int bytes = lsh::bytesPerCode(nbits);
+  std::vector<std::pair<int, IndexType>> candidates;
+  for(int c = 0; c < numCodes; ++c)
+    candidates.emplace_back(bruteForceHamming(query, codes.data() + (size_t)c * bytes, nbits), (IndexType)c);
+  std::sort(candidates.begin(), candidates.end());
+
+  std::vector<IndexType> ids;
+  for(int i = 0; i < k; ++i)
+    ids.push_back(candidates[i].second);
+  return ids;
+}
+
+// random codes of nbits bits with zero padding as written by lsh::encode
+std::vector<uint8_t> randomCodes(std::mt19937& rng, int rows, int nbits) {
+  int bytes = lsh::bytesPerCode(nbits);
+  std::vector<uint8_t> codes((size_t)rows * bytes, 0);
+  for(int r = 0; r < rows; ++r)
+    for(int j = 0; j < nbits; ++j)
+      if(rng() % 2)
+        codes[(size_t)r * bytes + j / 8] |= (uint8_t)(1 << (j % 8));
+  return codes;
+}
+
+}  // namespace
+
+TEST_CASE("LSH search returns the codes with the smallest Hamming distance", "[lsh]") {
+  std::mt19937 rng(1234);
+  int numQueries = 37; // not a multiple of the query blocks
+
+  // bit counts below, at and above the word and SIMD register sizes
+  for(int nbits : {13, 64, 100, 256, 300, 520, 1024}) {
+    int bytes = lsh::bytesPerCode(nbits);
+    int k = 10;
+
+    SECTION("distinct codes, nbits = " + std::to_string(nbits)) {
+      int numCodes = 200;
+      auto codes = randomCodes(rng, numCodes, nbits);
+      auto queries = randomCodes(rng, numQueries, nbits);
+
+      std::vector<IndexType> ids((size_t)numQueries * k);
+      lsh::search(queries.data(), numQueries, codes.data(), numCodes, nbits, k, ids.data());
+      for(int q = 0; q < numQueries; ++q) {
+        std::vector<IndexType> qIds(ids.begin() + q * k, ids.begin() + (q + 1) * k);
+        CHECK(qIds == bruteForceSearch(queries.data() + (size_t)q * bytes, codes, numCodes, nbits, k));
+      }
+    }
+
+    SECTION("repeated codes with tied distances, nbits = " + std::to_string(nbits)) {
+      // only 7 different codes, so every distance is shared by many ids
+      int numCodes = 100;
+      auto distinct = randomCodes(rng, 7, nbits);
+      std::vector<uint8_t> codes((size_t)numCodes * bytes);
+      for(int c = 0; c < numCodes; ++c)
+        std::copy(distinct.begin() + (c % 7) * bytes, distinct.begin() + (c % 7 + 1) * bytes,
+                  codes.begin() + (size_t)c * bytes);
+      auto queries = randomCodes(rng, numQueries, nbits);
+      // a query equal to a stored code has distance 0 to all its copies
+      std::copy(distinct.begin(), distinct.begin() + bytes, queries.begin());
+
+      k = 30;
+      std::vector<IndexType> ids((size_t)numQueries * k);
+      lsh::search(queries.data(), numQueries, codes.data(), numCodes, nbits, k, ids.data());
+      for(int q = 0; q < numQueries; ++q) {
+        std::vector<IndexType> qIds(ids.begin() + q * k, ids.begin() + (q + 1) * k);
+        CHECK(qIds == bruteForceSearch(queries.data() + (size_t)q * bytes, codes, numCodes, nbits, k));
+      }
+      CHECK(ids[0] == 0);
+      CHECK(ids[1] == 7);
+    }
+  }
+}
+
+TEST_CASE("LSH index round-trips through a model file", "[lsh]") {
+  int rows = 50, dim = 16, k = 8;
+  std::vector<float> values((size_t)rows * dim);
+  for(size_t i = 0; i < values.size(); ++i)
+    values[i] = std::sin(0.37f * i);
+  std::vector<float> queries(4 * dim);
+  for(size_t i = 0; i < queries.size(); ++i)
+    queries[i] = std::cos(0.11f * i);
+
+  std::vector<int> nbitsList = {dim}; // without a rotation
+#if BLAS_FOUND
+  nbitsList.push_back(40);            // with a rotation
+#endif
+
+  for(int nbits : nbitsList) {
+    SECTION("nbits = " + std::to_string(nbits)) {
+      std::string fileName = "lsh_tests.bin";
+      auto items = lsh::indexItems("W", values, dim, nbits);
+      io::saveItems(fileName, items);
+      auto loaded = io::loadItems(fileName);
+      std::remove(fileName.c_str());
+
+      REQUIRE(loaded.size() == items.size());
+      for(size_t i = 0; i < items.size(); ++i) {
+        CHECK(loaded[i].name == items[i].name);
+        CHECK(loaded[i].shape == items[i].shape);
+        CHECK(loaded[i].type == items[i].type);
+        CHECK(loaded[i].bytes == items[i].bytes);
+      }
+      CHECK(loaded.back().name == "W_lsh_codes");
+      CHECK(loaded.back().type == Type::uint8);
+      CHECK(loaded.back().shape == Shape({rows, lsh::bytesPerCode(nbits)}));
+
+#if BLAS_FOUND
+      // the output layer gives the same scores with the loaded index as with an index built on the fly
+      // with float16 as the default type, the float32 rotation is loaded as float16
+      auto scores = [&](bool storedIndex, Type defaultType = Type::float32) {
+        auto graph = New<ExpressionGraph>(/*inference=*/true);
+        graph->setDefaultElementType(defaultType);
+        graph->setDevice({0, DeviceType::cpu});
+        graph->reserveWorkspaceMB(16);
+        if(storedIndex)
+          graph->load(loaded, /*markReloaded=*/false);
+        auto W = graph->param("W", {rows, dim}, inits::fromVector(values), Type::float32);
+        auto query = graph->constant({4, dim}, inits::fromVector(queries), Type::float32);
+        auto out = LSH(k, nbits).apply(query, W, nullptr);
+        graph->forward();
+
+        std::vector<float> result;
+        out->val()->get(result);
+        return result;
+      };
+      CHECK(scores(/*storedIndex=*/true) == scores(/*storedIndex=*/false));
+      CHECK(scores(/*storedIndex=*/true, Type::float16) == scores(/*storedIndex=*/false));
+#endif
+    }
+  }
+}
@@ -5,11 +5,15 @@
 #include "catch.hpp"
 #include "graph/expression_graph.h"
 #include "graph/expression_operators.h"
+#include "optimizers/optimizers.h"
+#include "tensors/cpu/fbgemm/quantization_calibrator.h"
+#include "tensors/cpu/sharp/int_gemm.h"
 
 #ifdef CUDA_FOUND
 #include "tensors/gpu/backend.h"
 #endif
 
+#include <algorithm>
 #include <cmath>
 
 using namespace marian;
@@ -994,6 +998,316 @@ TEST_CASE("Expression graph supports basic math operations (cpu)", "[operator]")
 }
 #endif
 
+// Does not require BLAS, the prepared int8 kernels are self-contained
+TEST_CASE("Prepared int8 matrix product (cpu)", "[operator]") {
+  int m = 5, k = 37, n = 21; // not multiples of the tile sizes to exercise padding
+
+  std::vector<float> vA(m * k), vB(k * n), vBias(n);
+  for(int i = 0; i < m * k; ++i)
+    vA[i] = std::sin(0.37f * i);
+  for(int i = 0; i < k * n; ++i)
+    vB[i] = std::cos(0.11f * i) * 0.5f;
+  for(int i = 0; i < n; ++i)
+    vBias[i] = 0.1f * i;
+
+  // reference C = A * B + bias and its largest absolute value for the tolerance
+  std::vector<float> vC(m * n);
+  float absMax = 0.f;
+  for(int i = 0; i < m; ++i) {
+    for(int j = 0; j < n; ++j) {
+      float sum = vBias[j];
+      for(int l = 0; l < k; ++l)
+        sum += vA[i * k + l] * vB[l * n + j];
+      vC[i * n + j] = sum;
+      absMax = std::max(absMax, std::abs(sum));
+    }
+  }
+  auto int8Approx = [absMax](float x, float y) -> bool { return x == Approx(y).margin(0.02f * absMax); };
+
+  Config::seed = 1234;
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  std::vector<float> values;
+
+  SECTION("affine with prepared B") {
+    graph->clear();
+    values.clear();
+
+    auto A = graph->param("A", {m, k}, inits::fromVector(vA));
+    auto B = graph->param("B", {k, n}, inits::fromLambda([&](Tensor t) {
+      cpu::int16::PrepareInt8(t, vB.data(), Shape({k, n}), /*transpose=*/false);
+    }), Type::intgemm8);
+    auto bias = graph->param("bias", {1, n}, inits::fromVector(vBias));
+
+    auto C = affine(A, B, bias);
+    graph->forward();
+
+    CHECK(C->shape() == Shape({m, n}));
+    C->val()->get(values);
+    CHECK(std::equal(values.begin(), values.end(), vC.begin(), int8Approx));
+  }
+
+  SECTION("dot with prepared transposed B") {
+    graph->clear();
+    values.clear();
+
+    // B^T as it is stored for tied output embeddings
+    std::vector<float> vBt(n * k);
+    for(int l = 0; l < k; ++l)
+      for(int j = 0; j < n; ++j)
+        vBt[j * k + l] = vB[l * n + j];
+
+    auto A = graph->param("A", {m, k}, inits::fromVector(vA));
+    auto Bt = graph->param("Bt", {n, k}, inits::fromLambda([&](Tensor t) {
+      cpu::int16::PrepareInt8(t, vBt.data(), Shape({n, k}), /*transpose=*/true);
+    }), Type::intgemm8);
+
+    auto C = dot(A, Bt, /*transA=*/false, /*transB=*/true);
+    graph->forward();
+
+    CHECK(C->shape() == Shape({m, n}));
+    C->val()->get(values);
+    for(int i = 0; i < m; ++i)
+      for(int j = 0; j < n; ++j)
+        CHECK(int8Approx(values[i * n + j], vC[i * n + j] - vBias[j]));
+  }
+
+  SECTION("affine with selected columns of prepared transposed B") {
+    graph->clear();
+    values.clear();
+
+    std::vector<float> vBt(n * k);
+    for(int l = 0; l < k; ++l)
+      for(int j = 0; j < n; ++j)
+        vBt[j * k + l] = vB[l * n + j];
+
+    // unordered, with a repetition and more than one tile of 16 columns
+    std::vector<IndexType> cols = {20, 0, 5, 19, 17, 2, 16, 15, 8, 1, 10, 11, 12, 13, 14, 18, 3, 5};
+
+    auto A = graph->param("A", {m, k}, inits::fromVector(vA));
+    auto Bt = graph->param("Bt", {n, k}, inits::fromLambda([&](Tensor t) {
+      cpu::int16::PrepareInt8(t, vBt.data(), Shape({n, k}), /*transpose=*/true);
+    }), Type::intgemm8);
+    auto bias = graph->param("bias", {1, n}, inits::fromVector(vBias));
+
+    auto C = affineSelect(A, Bt, bias, cols, /*transB=*/true);
+    graph->forward();
+
+    CHECK(C->shape() == Shape({m, (int)cols.size()}));
+    C->val()->get(values);
+    for(int i = 0; i < m; ++i)
+      for(size_t j = 0; j < cols.size(); ++j)
+        CHECK(int8Approx(values[i * cols.size() + j], vC[i * n + cols[j]]));
+  }
+
+  SECTION("prepared B used with the wrong orientation") {
+    graph->clear();
+
+    // prepared for A * B, but multiplied as A * B^T of a square matrix
+    auto A = graph->param("A", {m, k}, inits::fromVector(vA));
+    auto B = graph->param("B", {k, k}, inits::fromLambda([&](Tensor t) {
+      std::vector<float> vSquare(k * k, 0.5f);
+      cpu::int16::PrepareInt8(t, vSquare.data(), Shape({k, k}), /*transpose=*/false);
+    }), Type::intgemm8);
+
+    auto C = dot(A, B, /*transA=*/false, /*transB=*/true);
+
+    setThrowExceptionOnAbort(true);
+    CHECK_THROWS_AS(graph->forward(), MarianRuntimeException);
+    setThrowExceptionOnAbort(false);
+    CHECK(!cpu::int16::PreparedInt8Transposed(B->val()));
+  }
+}
+
+TEST_CASE("Calibration thresholds of activation histograms", "[operator]") {
+  using namespace cpu::variant;
+  const size_t n = 100000;
+
+  // quantiles of the uniform distribution on [-1, 1] and of the Laplace distribution with scale 1,
+  // alternating signs for the latter
+  std::vector<float> uniform(n), laplace(n);
+  for(size_t i = 0; i < n; ++i) {
+    double u = (i + 0.5) / n;
+    uniform[i] = (float)(2.0 * u - 1.0);
+    laplace[i] = (float)((i % 2 ? 1.0 : -1.0) * -std::log(1.0 - u));
+  }
+  const float laplaceMax = (float)std::log(2.0 * n);
+
+  SECTION("uniform distribution") {
+    ActivationHistogram histogram;
+    histogram.add(uniform.data(), n);
+    float binWidth = 1.f / 2048;
+
+    CHECK(histogram.threshold(CalibrationMethod::max) == Approx(1.f).margin(binWidth));
+    CHECK(histogram.threshold(CalibrationMethod::percentile, 99.f) == Approx(0.99f).margin(binWidth));
+    // quantizing a flat histogram loses nothing, hence nothing is clipped
+    CHECK(histogram.threshold(CalibrationMethod::kl) == Approx(1.f).margin(binWidth));
+    auto range = histogram.range(CalibrationMethod::percentile, 90.f);
+    CHECK(range.first == Approx(-0.9f).margin(binWidth));
+    CHECK(range.second == Approx(0.9f).margin(binWidth));
+  }
+
+  SECTION("Laplace distribution") {
+    ActivationHistogram histogram;
+    histogram.add(laplace.data(), n);
+    float binWidth = laplaceMax / 2048;
+
+    CHECK(histogram.threshold(CalibrationMethod::max) == Approx(laplaceMax).margin(binWidth));
+    CHECK(histogram.threshold(CalibrationMethod::percentile, 99.f) == Approx(std::log(100.f)).margin(binWidth));
+    CHECK(histogram.threshold(CalibrationMethod::percentile, 99.9f) == Approx(std::log(1000.f)).margin(binWidth));
+
+    // the long tail is clipped, but less than 0.1% of the values
+    float kl = histogram.threshold(CalibrationMethod::kl);
+    CHECK(kl > std::log(1000.f));
+    CHECK(kl < 0.9f * laplaceMax);
+    auto range = histogram.range(CalibrationMethod::kl);
+    CHECK(range.first == -kl);
+    CHECK(range.second == kl);
+  }
+
+  SECTION("histogram growing over several batches") {
+    // increasing magnitudes, so that the range doubles many times
+    ActivationHistogram histogram;
+    for(size_t i = 0; i < n; i += 1000)
+      histogram.add(laplace.data() + i, 1000);
+    CHECK(histogram.count() == n);
+    // the final bins are at most twice as wide as with a single batch
+    float binWidth = 2 * laplaceMax / 2048;
+    CHECK(histogram.threshold(CalibrationMethod::max) == Approx(laplaceMax).margin(binWidth));
+    CHECK(histogram.threshold(CalibrationMethod::percentile, 99.f) == Approx(std::log(100.f)).margin(binWidth));
+  }
+
+  SECTION("calibrator") {
+    QuantizationCalibrator calibrator(CalibrationMethod::percentile, 99.f);
+    calibrator.observe("W", laplace.data(), n / 2);
+    calibrator.observe("W", laplace.data() + n / 2, n / 2);
+    float minA = 0.f, maxA = 0.f;
+    CHECK(!calibrator.range("other_W", minA, maxA));
+    REQUIRE(calibrator.range("W", minA, maxA));
+    CHECK(calibrator.size() == 1);
+    CHECK(minA == Approx(-std::log(100.f)).margin(2 * laplaceMax / 2048));
+    CHECK(maxA == Approx(std::log(100.f)).margin(2 * laplaceMax / 2048));
+  }
+}
+
+TEST_CASE("Row-quantized int8 embedding lookup (cpu)", "[operator]") {
+  const int numRows = 7, cols = 37;
+
+  std::vector<float> vE(numRows * cols);
+  for(int i = 0; i < numRows; ++i)
+    for(int j = 0; j < cols; ++j)
+      vE[i * cols + j] = i == 3 ? 0.f : std::sin(0.7f * (i * cols + j)) * (i + 1); // row 3 is all zeros
+
+  Config::seed = 1234;
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  auto Ef = graph->param("Ef", {numRows, cols}, inits::fromVector(vE));
+  auto E = graph->param("E", {numRows, cols}, inits::fromLambda([&](Tensor t) {
+    cpu::QuantizeRows8(t, Ef->val());
+  }), Type::rowquant8);
+
+  std::vector<IndexType> idx({6, 0, 3, 3, 5});
+  auto embs = rows(E, idx);
+  graph->forward();
+
+  CHECK(embs->value_type() == Type::float32);
+  CHECK(embs->shape() == Shape({(int)idx.size(), cols}));
+
+  std::vector<float> values;
+  embs->val()->get(values);
+  for(size_t i = 0; i < idx.size(); ++i) {
+    float maxAbs = (idx[i] + 1.f); // bound of sin() * (i + 1)
+    for(int j = 0; j < cols; ++j)
+      CHECK(values[i * cols + j] == Approx(vE[idx[i] * cols + j]).margin(0.5f * maxAbs / 127.f + 1e-6f));
+  }
+}
+
+TEST_CASE("Fused Adam update matches the separate passes (cpu)", "[operator]") {
+  const int n = 1000;
+  auto backend = BackendByDeviceId({0, DeviceType::cpu}, /*seed=*/1234);
+  auto alloc = New<TensorAllocator>(backend);
+  alloc->reserveExact(16 * n * sizeof(float));
+
+  auto tensor = [&](const std::vector<float>& values) {
+    Tensor t;
+    alloc->allocate(t, {1, n}, Type::float32);
+    t->set(values);
+    return t;
+  };
+
+  std::vector<float> vParams(n), vAvg(n);
+  for(int i = 0; i < n; ++i) {
+    vParams[i] = std::sin(0.3f * i);
+    vAvg[i] = std::cos(0.7f * i);
+  }
+  // gradients of three updates, some beyond the clipping thresholds below
+  auto gradsAt = [](int step) {
+    std::vector<float> grads(n);
+    for(int i = 0; i < n; ++i)
+      grads[i] = 2.f * std::sin(0.11f * i + step) * (i % 7 == 0 ? 10.f : 1.f);
+    return grads;
+  };
+
+  // updates params and paramsAvg three times once through the fused update and once through the
+  // separate passes: clipping, Adam::updateImpl() and ExponentialSmoothing::updateAvgParams()
+  auto compare = [&](Ptr<ClipperBase> clipper, float decay, bool smoothing) {
+    Ptr<OptimizerBase> fusedOpt = New<Adam>(0.01f, /*refMBWords=*/0, clipper);
+    Ptr<OptimizerBase> separateOpt = New<Adam>(0.01f, /*refMBWords=*/0, clipper);
+    fusedOpt->setParams({0.9f, 0.98f, 1e-9f, decay});
+    separateOpt->setParams({0.9f, 0.98f, 1e-9f, decay});
+
+    auto fusedParams = tensor(vParams), separateParams = tensor(vParams);
+    auto fusedAvg = tensor(vAvg), separateAvg = tensor(vAvg);
+    const float avgDecay = 0.1f;
+
+    for(int step = 0; step < 3; ++step) {
+      auto fusedGrads = tensor(gradsAt(step)), separateGrads = tensor(gradsAt(step));
+
+      fusedOpt->update(fusedParams, fusedGrads, /*mbSize=*/1, smoothing ? fusedAvg : nullptr, avgDecay, /*resetGrads=*/true);
+
+      separateOpt->update(separateParams, separateGrads, /*mbSize=*/1);
+      if(smoothing) {
+        using namespace functional;
+        Element(_1 = ((1.f - avgDecay) * _1) + (avgDecay * _2), separateAvg, separateParams);
+      }
+
+      std::vector<float> values;
+      fusedGrads->get(values);
+      CHECK(values == std::vector<float>(n, 0.f));
+      alloc->free(fusedGrads);
+      alloc->free(separateGrads);
+    }
+
+    auto approx = [](float x, float y) { return x == Approx(y).epsilon(1e-5f).margin(1e-6f); };
+    std::vector<float> fused, separate;
+    fusedParams->get(fused);
+    separateParams->get(separate);
+    CHECK(fused != vParams);
+    CHECK(std::equal(fused.begin(), fused.end(), separate.begin(), approx));
+
+    fusedAvg->get(fused);
+    separateAvg->get(separate);
+    CHECK(std::equal(fused.begin(), fused.end(), separate.begin(), approx));
+    CHECK((fused == vAvg) == !smoothing);
+  };
+
+  SECTION("without clipping and weight decay") {
+    compare(nullptr, 0.f, /*smoothing=*/false);
+  }
+
+  SECTION("with gradient-norm clipping, weight decay and smoothing") {
+    compare(New<Norm>(1.f), 0.01f, /*smoothing=*/true);
+  }
+
+  SECTION("with element-wise clipping and smoothing") {
+    compare(New<Elementwise>(1.5f), 0.f, /*smoothing=*/true);
+  }
+}
+
 #ifdef BLAS_FOUND
 #ifdef CUDA_FOUND
 
@@ -0,0 +1,449 @@
+#include "catch.hpp"
+#include "common/config.h"
+#include "data/vocab.h"
+#include "models/model_factory.h"
+#include "translator/beam_search.h"
+#include "translator/greedy_search.h"
+#include "translator/sampling.h"
+#include "translator/service_metrics.h"
+#include "translator/translator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+
+using namespace marian;
+
+namespace {
+
+// draws n words with a fixed seed and counts them
+std::map<IndexType, size_t> countSamples(Ptr<Options> options, const std::vector<float>& logProbs, size_t n) {
+  OutputSampler sampler(options);
+  std::mt19937 engine(1234);
+  std::map<IndexType, size_t> counts;
+  size_t wrongLogProbs = 0;
+  for(size_t i = 0; i < n; ++i) {
+    float logProb;
+    IndexType word = sampler.sample(logProbs.data(), logProbs.size(), engine, logProb);
+    if(word >= logProbs.size())
+      FAIL("Sampled word " << word << " is not in the vocabulary");
+    wrongLogProbs += logProb != logProbs[word]; // returned without temperature
+    counts[word]++;
+  }
+  CHECK(wrongLogProbs == 0);
+  return counts;
+}
+
+std::vector<float> logOf(const std::vector<float>& probs) {
+  std::vector<float> logProbs;
+  for(auto p : probs)
+    logProbs.push_back(std::log(p));
+  return logProbs;
+}
+
+// batch of one source stream with the sentences encoded by vocab and sentence ids 0, 1, ...
+Ptr<data::CorpusBatch> sourceBatch(const std::vector<std::string>& sentences, Ptr<const Vocab> vocab) {
+  std::vector<Words> encoded;
+  size_t width = 0;
+  for(const auto& sentence : sentences) {
+    encoded.push_back(vocab->encode(sentence, /*addEOS=*/true, /*inference=*/true));
+    width = std::max(width, encoded.back().size());
+  }
+
+  auto subBatch = New<data::SubBatch>(sentences.size(), width, vocab);
+  std::vector<size_t> ids;
+  for(size_t b = 0; b < encoded.size(); ++b) {
+    for(size_t s = 0; s < encoded[b].size(); ++s) {
+      subBatch->data()[subBatch->locate(b, s)] = encoded[b][s];
+      subBatch->mask()[subBatch->locate(b, s)] = 1.f;
+    }
+    ids.push_back(b);
+  }
+  auto batch = New<data::CorpusBatch>(std::vector<Ptr<data::SubBatch>>({subBatch}));
+  batch->setSentenceIds(ids);
+  return batch;
+}
+
+// vocabulary of </s>, <unk> and the letters a to h
+void writeVocab(const std::string& path) {
+  std::ofstream vocabFile(path);
+  vocabFile << "</s>: 0\n<unk>: 1\n";
+  std::vector<std::string> words = {"a", "b", "c", "d", "e", "f", "g", "h"};
+  for(size_t i = 0; i < words.size(); ++i)
+    vocabFile << words[i] << ": " << i + 2 << "\n";
+}
+
+// Options of marian-decoder for a tiny transformer with the vocabulary at vocabPath and the model
+// file modelPath, which is only read by tests that load it. The command line is parsed only once as
+// parsing creates the loggers.
+Ptr<Options> tinyTransformerOptions(const std::string& vocabPath, const std::string& modelPath) {
+  static Ptr<Options> parsed;
+  if(!parsed) {
+    std::vector<std::string> args = {"marian-decoder", "-m", modelPath, "--ignore-model-config",
+                                     "-v", vocabPath, vocabPath, "--type", "transformer", "--dim-vocabs", "10", "10",
+                                     "--dim-emb", "16", "--transformer-dim-ffn", "32", "--transformer-heads", "2",
+                                     "--enc-depth", "1", "--dec-depth", "1", "--max-length-factor", "3",
+                                     "--cpu-threads", "1"};
+    std::vector<char*> argv;
+    for(auto& arg : args)
+      argv.push_back(&arg[0]);
+    parsed = parseOptions((int)argv.size(), argv.data(), cli::mode::translation, /*validate=*/false);
+    parsed->set("inference", true);
+  }
+  auto options = New<Options>(parsed->clone());
+  options->set("vocabs", std::vector<std::string>({vocabPath, vocabPath}),
+               "models", std::vector<std::string>({modelPath}));
+  return options;
+}
+
+// tiny transformer with random parameters on the CPU
+struct TinyTransformer {
+  Ptr<Options> options;
+  Ptr<Vocab> vocab;
+  Ptr<ExpressionGraph> graph;
+  Ptr<models::IModel> model;
+  std::vector<Ptr<Scorer>> scorers;
+
+  TinyTransformer(Ptr<Options> options) : options(options) {
+    Config::seed = 1234;
+    vocab = New<Vocab>(options, 0);
+    vocab->load(options->get<std::vector<std::string>>("vocabs")[0]);
+
+    graph = New<ExpressionGraph>(/*inference=*/true);
+    graph->setDevice({0, DeviceType::cpu});
+    graph->reserveWorkspaceMB(64);
+    model = models::createModelFromOptions(options, models::usage::translation);
+    scorers = {New<ScorerWrapper>(model, "F0", 1.f, options->get<std::vector<std::string>>("models")[0])};
+  }
+
+  // Creates the parameters with a first search over batch and adds eosBias to the score of </s>.
+  // A little of it lets some hypotheses finish early while others continue.
+  void initialize(Ptr<data::CorpusBatch> batch, float eosBias) {
+    search<BeamSearch>(options, batch);
+    addEosBias(eosBias);
+  }
+
+  void addEosBias(float eosBias) {
+    std::vector<float> bias;
+    graph->get("decoder_ff_logit_out_b")->val()->get(bias);
+    bias[vocab->getEosId().toWordIndex()] += eosBias;
+    graph->get("decoder_ff_logit_out_b")->val()->set(bias);
+  }
+
+  template <class Search>
+  Histories search(Ptr<Options> searchOptions, Ptr<data::CorpusBatch> batch) {
+    return Search(searchOptions, scorers, vocab).search(graph, batch);
+  }
+};
+
+}  // namespace
+
+TEST_CASE("Restricted output sampling", "[sampling]") {
+  auto options = New<Options>();
+  options->set("output-sampling", true);
+  size_t n = 20000;
+
+  SECTION("top-k draws only from the k most probable words") {
+    options->set("output-sampling-top-k", (size_t)3);
+    auto logProbs = logOf({0.05f, 0.3f, 0.05f, 0.2f, 0.05f, 0.1f, 0.25f});
+    auto counts = countSamples(options, logProbs, n);
+
+    REQUIRE(counts.size() == 3);
+    // renormalized over 0.3 + 0.25 + 0.2
+    CHECK(counts[1] / (float)n == Approx(0.3f / 0.75f).margin(0.02));
+    CHECK(counts[6] / (float)n == Approx(0.25f / 0.75f).margin(0.02));
+    CHECK(counts[3] / (float)n == Approx(0.2f / 0.75f).margin(0.02));
+  }
+
+  SECTION("top-p draws from the smallest set of words that covers p") {
+    options->set("output-sampling-top-p", 0.75f);
+    auto logProbs = logOf({0.05f, 0.3f, 0.05f, 0.5f, 0.1f});
+    auto counts = countSamples(options, logProbs, n);
+
+    // 0.5 alone is below 0.75, 0.5 + 0.3 covers it
+    REQUIRE(counts.size() == 2);
+    CHECK(counts[3] / (float)n == Approx(0.5f / 0.8f).margin(0.02));
+    CHECK(counts[1] / (float)n == Approx(0.3f / 0.8f).margin(0.02));
+  }
+
+  SECTION("top-p over a vocabulary that needs more than the initial selection") {
+    options->set("output-sampling-top-p", 0.5f);
+    std::vector<float> logProbs(1000);
+    for(size_t i = 0; i < logProbs.size(); ++i)
+      logProbs[i] = -0.001f * i;
+
+    // the expected cut is the shortest prefix with half of the mass
+    float total = 0.f, mass = 0.f;
+    for(auto l : logProbs)
+      total += std::exp(l);
+    size_t cut = 0;
+    while(mass < 0.5f * total)
+      mass += std::exp(logProbs[cut++]);
+
+    auto counts = countSamples(options, logProbs, n);
+    CHECK(counts.rbegin()->first < cut + 1); // allow for rounding at the border
+    CHECK(counts.rbegin()->first >= cut - 10);
+    CHECK(cut > 64);
+  }
+
+  SECTION("temperature flattens the distribution") {
+    options->set("output-sampling-temperature", 2.f);
+    auto logProbs = logOf({0.8f, 0.2f});
+    auto counts = countSamples(options, logProbs, n);
+
+    // p^(1/2) renormalized
+    float p0 = std::sqrt(0.8f) / (std::sqrt(0.8f) + std::sqrt(0.2f));
+    CHECK(counts[0] / (float)n == Approx(p0).margin(0.02));
+  }
+
+  SECTION("top-k, top-p and temperature combined") {
+    options->set("output-sampling-top-k", (size_t)3);
+    options->set("output-sampling-top-p", 0.6f);
+    options->set("output-sampling-temperature", 0.5f);
+    auto logProbs = logOf({0.1f, 0.4f, 0.2f, 0.3f});
+    auto counts = countSamples(options, logProbs, n);
+
+    // tempered top-3: 0.16, 0.09, 0.04 of 0.29, the first two cover 0.6
+    REQUIRE(counts.size() == 2);
+    CHECK(counts[1] / (float)n == Approx(0.16f / 0.25f).margin(0.02));
+  }
+
+  SECTION("the same seed draws the same words") {
+    options->set("output-sampling-top-p", 0.9f);
+    auto logProbs = logOf({0.1f, 0.4f, 0.2f, 0.3f});
+    auto draw = [&]() {
+      OutputSampler sampler(options);
+      std::mt19937 engine(1234);
+      std::vector<IndexType> words;
+      float logProb;
+      for(size_t i = 0; i < 100; ++i)
+        words.push_back(sampler.sample(logProbs.data(), logProbs.size(), engine, logProb));
+      return words;
+    };
+    CHECK(draw() == draw());
+  }
+}
+
+TEST_CASE("Histories share the hypothesis pool of their search", "[search]") {
+  const size_t length = 3000; // two histories span more than one block of the pool
+  Word eos = Word::fromWordIndex(0);
+  auto pool = New<HypothesisPool>();
+
+  // a single path ending in </s>, every hypothesis has a score breakdown and an alignment derived from offset
+  auto makeHistory = [&](size_t lineNo, float offset) {
+    auto history = New<History>(lineNo, /*alpha=*/0.f, /*wp=*/0.f, pool);
+    Beam beam = {pool->New()};
+    history->add(beam, eos);
+    for(size_t t = 1; t <= length; ++t) {
+      auto hyp = pool->New(beam[0], t == length ? eos : Word::fromWordIndex(1 + t % 7), 0, -(float)t);
+      hyp->setScoreBreakdown({offset + t, -offset});
+      hyp->setAlignment({offset, offset + t, 1.f});
+      beam = {hyp};
+      history->add(beam, eos);
+    }
+    return history;
+  };
+
+  auto checkHistory = [&](Ptr<History> history, float offset) {
+    auto hyp = std::get<1>(history->top());
+    CHECK(hyp->getScoreBreakdown() == std::vector<float>({offset + length, -offset}));
+    CHECK(hyp->getPrevHyp()->getScoreBreakdown() == std::vector<float>({offset + length - 1, -offset}));
+    auto alignment = hyp->tracebackAlignment();
+    REQUIRE(alignment.size() == length);
+    for(size_t t = 1; t <= length; ++t)
+      CHECK(alignment[t - 1] == std::vector<float>({offset, offset + t, 1.f}));
+  };
+
+  auto first = makeHistory(0, 0.f);
+  auto second = makeHistory(1, 10000.f);
+  CHECK(pool->size() == 2 * (length + 1));
+  // the histories keep the pool alive from now on
+  pool.reset();
+
+  SECTION("first history destroyed first") {
+    checkHistory(second, 10000.f);
+    first.reset();
+    checkHistory(second, 10000.f);
+    second.reset();
+  }
+
+  SECTION("second history destroyed first") {
+    checkHistory(first, 0.f);
+    second.reset();
+    checkHistory(first, 0.f);
+    first.reset();
+  }
+}
+
+TEST_CASE("Greedy search finds the same translations as beam search with beam size 1", "[search]") {
+  std::string vocabPath = "translator_tests.yml";
+  writeVocab(vocabPath);
+  auto options = tinyTransformerOptions(vocabPath, "translator_tests.npz");
+  options->set("beam-size", (size_t)1);
+  TinyTransformer tiny(options);
+  std::remove(vocabPath.c_str());
+
+  // the empty sentence is forced to </s>
+  auto batch = sourceBatch({"a b c d", "e", "f g h a b c", "", "d d e e"}, tiny.vocab);
+  size_t maxLength = 3 * batch->front()->batchWidth();
+
+  // some sentences finish in the first step while the others continue, so that the decoder states
+  // are sub-selected
+  tiny.initialize(batch, /*eosBias=*/0.1f);
+
+  auto beamHistories = tiny.search<BeamSearch>(tiny.options, batch);
+  auto greedyHistories = tiny.search<GreedySearch>(tiny.options, batch);
+
+  REQUIRE(beamHistories.size() == batch->size());
+  REQUIRE(greedyHistories.size() == batch->size());
+  size_t finishedEarly = 0;
+  for(size_t b = 0; b < batch->size(); ++b) {
+    auto beamResult = beamHistories[b]->top();
+    auto greedyResult = greedyHistories[b]->top();
+    CHECK(greedyHistories[b]->getLineNum() == beamHistories[b]->getLineNum());
+    CHECK(std::get<0>(greedyResult) == std::get<0>(beamResult));
+    CHECK(std::get<2>(greedyResult) == Approx(std::get<2>(beamResult)).epsilon(1e-4));
+    finishedEarly += std::get<0>(greedyResult).size() < maxLength;
+  }
+  // besides the empty sentence
+  CHECK(finishedEarly > 1);
+  CHECK(finishedEarly < batch->size());
+}
+
+TEST_CASE("Beam pruning and early stopping keep the translations of the full search", "[search]") {
+  std::string vocabPath = "translator_tests.yml";
+  writeVocab(vocabPath);
+  auto options = tinyTransformerOptions(vocabPath, "translator_tests.npz");
+  size_t beamSize = 4;
+  options->set("beam-size", beamSize);
+  TinyTransformer tiny(options);
+  std::remove(vocabPath.c_str());
+
+  auto batch = sourceBatch({"a b c d", "e", "f g h a b c", "d d e e", "h g"}, tiny.vocab);
+  tiny.initialize(batch, /*eosBias=*/0.1f);
+
+  auto checkSameNBest = [&](const Histories& expected, const Histories& actual) {
+    REQUIRE(actual.size() == expected.size());
+    for(size_t b = 0; b < expected.size(); ++b) {
+      auto expectedNBest = expected[b]->nBest(beamSize);
+      auto actualNBest = actual[b]->nBest(beamSize);
+      REQUIRE(actualNBest.size() == expectedNBest.size());
+      for(size_t i = 0; i < expectedNBest.size(); ++i) {
+        CHECK(std::get<0>(actualNBest[i]) == std::get<0>(expectedNBest[i]));
+        CHECK(std::get<2>(actualNBest[i]) == Approx(std::get<2>(expectedNBest[i])).epsilon(1e-4));
+      }
+    }
+  };
+
+  auto full = tiny.search<BeamSearch>(options, batch);
+
+  SECTION("thresholds of 0 disable pruning") {
+    auto pruned = tiny.search<BeamSearch>(options->with("beam-prune-relative", 0.f,
+                                                        "beam-prune-absolute", 0.f,
+                                                        "beam-max-candidates-per-node", (size_t)0), batch);
+    checkSameNBest(full, pruned);
+  }
+
+  SECTION("thresholds that no hypothesis reaches do not change the search") {
+    auto pruned = tiny.search<BeamSearch>(options->with("beam-prune-relative", 1e-30f,
+                                                        "beam-prune-absolute", 1000.f,
+                                                        "beam-max-candidates-per-node", beamSize), batch);
+    checkSameNBest(full, pruned);
+  }
+
+  SECTION("early stopping finds the same best translation") {
+    for(float normalize : {0.f, 0.6f, 1.f}) {
+      auto normalized = options->with("normalize", normalize);
+      auto expected = tiny.search<BeamSearch>(normalized, batch);
+      auto stopped = tiny.search<BeamSearch>(normalized->with("early-stop", true), batch);
+      REQUIRE(stopped.size() == expected.size());
+      size_t stoppedEarly = 0;
+      for(size_t b = 0; b < expected.size(); ++b) {
+        CHECK(std::get<0>(stopped[b]->top()) == std::get<0>(expected[b]->top()));
+        CHECK(std::get<2>(stopped[b]->top()) == Approx(std::get<2>(expected[b]->top())).epsilon(1e-4));
+        CHECK(stopped[b]->size() <= expected[b]->size());
+        stoppedEarly += stopped[b]->size() < expected[b]->size();
+      }
+      // otherwise the comparison is trivial
+      CHECK(stoppedEarly > 0);
+    }
+  }
+}
+
+TEST_CASE("Reloading the translation service switches the model files", "[service]") {
+  std::string vocabPath = "translator_tests.yml";
+  std::vector<std::string> models = {"translator_tests.1.npz", "translator_tests.2.npz"};
+  writeVocab(vocabPath);
+  auto options = tinyTransformerOptions(vocabPath, models[0]);
+  options->set("beam-size", (size_t)1);
+
+  // the first model always ends the translation right away, the second one never does
+  TinyTransformer tiny(options);
+  tiny.initialize(sourceBatch({"a b c"}, tiny.vocab), /*eosBias=*/10.f);
+  tiny.model->save(tiny.graph, models[0]);
+  tiny.addEosBias(-20.f);
+  tiny.model->save(tiny.graph, models[1]);
+
+  TranslateService<BeamSearch> service(options);
+  CHECK(service.modelFiles() == std::vector<std::string>({models[0]}));
+  CHECK(service.run("a b c") == "");
+
+  REQUIRE(service.reload({models[1]}));
+  CHECK(service.modelFiles() == std::vector<std::string>({models[1]}));
+  auto secondOutput = service.run("a b c");
+  CHECK(secondOutput != "");
+
+  // an empty reload reloads the files in use, not the ones given at startup
+  REQUIRE(service.reload({}));
+  CHECK(service.modelFiles() == std::vector<std::string>({models[1]}));
+  CHECK(service.run("a b c") == secondOutput);
+
+  std::remove(vocabPath.c_str());
+  for(const auto& model : models)
+    std::remove(model.c_str());
+}
+
+TEST_CASE("Service metrics report latency percentiles and batch padding", "[service]") {
+  ServiceMetrics metrics(/*numWorkers=*/2, /*window=*/10);
+
+  // latencies of 1 to 15 seconds, the window keeps the last 10
+  for(size_t i = 1; i <= 15; ++i) {
+    metrics.startRequest();
+    CHECK(metrics.finishRequest((double)i, /*sentences=*/2) == i);
+  }
+  metrics.startRequest(); // still running
+
+  // batches of 2 sentences with 6 words in 2 x 4 slots and of 1 sentence with 3 words in 1 x 3 slots
+  auto batchOf = [](size_t size, size_t width, size_t words) {
+    auto subBatch = New<data::SubBatch>(size, width, nullptr);
+    subBatch->setWords(words);
+    return New<data::CorpusBatch>(std::vector<Ptr<data::SubBatch>>({subBatch}));
+  };
+  metrics.addBatch(/*worker=*/0, batchOf(2, 4, 6), /*trgWords=*/10, /*seconds=*/0.);
+  metrics.addBatch(/*worker=*/1, batchOf(1, 3, 3), /*trgWords=*/5, /*seconds=*/0.);
+
+  std::stringstream out;
+  metrics.report(out);
+  std::map<std::string, double> reported;
+  std::string name;
+  double value;
+  while(out >> name >> value)
+    reported[name] = value;
+
+  CHECK(reported["marian_requests_total"] == 15);
+  CHECK(reported["marian_requests_in_flight"] == 1);
+  CHECK(reported["marian_sentences_total"] == 30);
+  // nearest rank over the latencies 6 to 15
+  CHECK(reported["marian_request_latency_seconds{quantile=\"0.5\"}"] == 10);
+  CHECK(reported["marian_request_latency_seconds{quantile=\"0.95\"}"] == 15);
+  CHECK(reported["marian_request_latency_seconds{quantile=\"0.99\"}"] == 15);
+  CHECK(reported["marian_translated_target_tokens_total"] == 15);
+  CHECK(reported["marian_batches_total"] == 2);
+  CHECK(reported["marian_batch_size_average"] == Approx(1.5));
+  CHECK(reported["marian_batch_padding_ratio"] == Approx(2. / 11.));
+  CHECK(reported.count("marian_worker_busy_ratio{worker=\"1\"}") == 1);
+}
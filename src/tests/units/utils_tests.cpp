@@ -1,5 +1,12 @@
 #include "catch.hpp"
 #include "common/utils.h"
+#include "common/cpu_affinity.h"
+#include "common/output_sink.h"
+#include "translator/translation_cache.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
 
 using namespace marian;
 
@@ -34,3 +41,96 @@ TEST_CASE("utils::splitTsv", "[utils]") {
 
   //SECTION("excessive tab-separated fields abort the execution") {}
 }
+
+TEST_CASE("OutputSink writes entries in id order", "[utils]") {
+  auto buffer = new std::stringstream();
+  std::string notes; // the callback runs on the writer thread, checked after flush()
+  OutputSink sink(UPtr<std::ostream>(buffer), [&](long id, const std::string& note) {
+    notes += std::to_string(id) + ":" + note + " ";
+  });
+
+  const long numIds = 100;
+  std::vector<std::thread> workers;
+  for(long w = 0; w < 4; ++w)
+    workers.emplace_back([&sink, w]() {
+      for(long id = numIds - 1 - w; id >= 0; id -= 4)
+        sink.push(id, std::to_string(id) + "\n", std::to_string(id));
+    });
+  for(auto& worker : workers)
+    worker.join();
+  sink.flush();
+
+  std::string expected, expectedNotes;
+  for(long id = 0; id < numIds; ++id) {
+    expected += std::to_string(id) + "\n";
+    expectedNotes += std::to_string(id) + ":" + std::to_string(id) + " ";
+  }
+  CHECK( buffer->str() == expected );
+  CHECK( notes == expectedNotes );
+}
+
+TEST_CASE("TranslationCache evicts the least recently used translation", "[utils]") {
+  TranslationCache cache(/*maxSize=*/2, /*reportFreq=*/0);
+  std::string translation;
+
+  CHECK( !cache.get("a", translation) );
+  cache.put("a", "A");
+  cache.put("b", "B");
+  CHECK( cache.size() == 2 );
+
+  // using "a" makes "b" the least recently used entry
+  CHECK( cache.get("a", translation) );
+  CHECK( translation == "A" );
+  cache.put("c", "C");
+  CHECK( cache.size() == 2 );
+  CHECK( !cache.get("b", translation) );
+  CHECK( cache.get("c", translation) );
+  CHECK( translation == "C" );
+
+  // updating "a" keeps the size and makes it the most recently used entry, "c" is evicted next
+  cache.put("a", "A2");
+  cache.put("d", "D");
+  CHECK( !cache.get("c", translation) );
+  CHECK( cache.get("a", translation) );
+  CHECK( translation == "A2" );
+  CHECK( cache.get("d", translation) );
+
+  CHECK( cache.hits() == 4 );
+  CHECK( cache.misses() == 3 );
+  CHECK( cache.hitRate() == Approx(4.f / 7.f) );
+}
+
+TEST_CASE("CPU workers are placed on NUMA nodes in contiguous blocks", "[utils]") {
+  using namespace affinity;
+
+  // 5 workers on 2 nodes, 3 workers on 4 nodes
+  CHECK( nodeOfWorker(0, 5, 2) == 0 );
+  CHECK( nodeOfWorker(2, 5, 2) == 0 );
+  CHECK( nodeOfWorker(3, 5, 2) == 1 );
+  CHECK( nodeOfWorker(4, 5, 2) == 1 );
+  CHECK( firstWorkerOnNode(1, 5, 2) == 3 );
+  CHECK( nodeOfWorker(2, 3, 4) == 2 );
+  CHECK( firstWorkerOnNode(3, 3, 4) == 3 ); // no worker on the last node
+
+  for(size_t numNodes = 1; numNodes <= 5; ++numNodes) {
+    for(size_t numWorkers = 1; numWorkers <= 13; ++numWorkers) {
+      std::vector<size_t> blockSizes(numNodes, 0);
+      for(size_t w = 0; w < numWorkers; ++w) {
+        size_t node = nodeOfWorker(w, numWorkers, numNodes);
+        REQUIRE( node < numNodes );
+        CHECK( (w == 0 || node >= nodeOfWorker(w - 1, numWorkers, numNodes)) ); // contiguous blocks
+        // the position of the worker within its block, which selects its core
+        size_t first = firstWorkerOnNode(node, numWorkers, numNodes);
+        CHECK( first <= w );
+        CHECK( w - first == blockSizes[node] );
+        blockSizes[node]++;
+      }
+      for(size_t node = 0; node < numNodes; ++node) {
+        CHECK( firstWorkerOnNode(node, numWorkers, numNodes) + blockSizes[node]
+               == (node + 1 < numNodes ? firstWorkerOnNode(node + 1, numWorkers, numNodes) : numWorkers) );
+      }
+      auto sizes = std::minmax_element(blockSizes.begin(), blockSizes.end());
+      CHECK( *sizes.second - *sizes.first <= 1 );
+    }
+  }
+}
@@ -20,7 +20,8 @@ public:
     }
 
 protected:
-  void updateAvgParams(Tensor paramsAvg, Tensor params, size_t batches, size_t actualBatchTrgWords = OptimizerBase::mbSizeNotProvided) {
+  // Factor by which the average moves towards the current parameters in this update
+  float avgDecayBy(size_t batches, size_t actualBatchTrgWords = OptimizerBase::mbSizeNotProvided) {
     double beta = 1. - mvDecayBy_;
     // correction term if batch size is different from what mvDecayBy_ was specified for
     if (refBatchTrgWords_) {
@@ -34,12 +35,26 @@ protected:
       batches = std::max(batches, batches * actualBatchTrgWords / refBatchTrgWords_); // @BUGBUG: Does not consider that batch size is changing
     }
     // reduce effect of decay parameter in early training stages
-    float decayBy = std::max(1.f - (float)beta,
-                             1.f - (float)(batches + 1) / (float)(batches + 10));
+    return std::max(1.f - (float)beta,
+                    1.f - (float)(batches + 1) / (float)(batches + 10));
+  }
+
+  void updateAvgParams(Tensor paramsAvg, Tensor params, size_t batches, size_t actualBatchTrgWords = OptimizerBase::mbSizeNotProvided) {
+    float decayBy = avgDecayBy(batches, actualBatchTrgWords);
     using namespace functional;
     Element(_1 = ((1.f - decayBy) * _1) + (decayBy * _2), paramsAvg, params);
   }
 
+  // Optimizer update of a parameter shard followed by the update of its average, fused into one
+  // pass over the shard by optimizers that support it. Resets the gradients if resetGrads.
+  void updateWithAvgParams(Ptr<OptimizerBase> opt, Tensor params, Tensor grads, Tensor paramsAvg,
+                           size_t batches, size_t actualBatchTrgWords, bool resetGrads) {
+    if(mvAvg_ && paramsAvg)
+      opt->update(params, grads, actualBatchTrgWords, paramsAvg, avgDecayBy(batches, actualBatchTrgWords), resetGrads);
+    else
+      opt->update(params, grads, actualBatchTrgWords, /*paramsAvg=*/nullptr, /*avgDecay=*/0.f, resetGrads);
+  }
+
   bool mvAvg_{false};
   float mvDecayBy_{1e-4f};     // decay prior model by this factor
   size_t refBatchTrgWords_{0}; // mvDecayBy_ is specified for this batch size (in target words) (0 means not specified)
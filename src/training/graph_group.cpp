@@ -35,6 +35,42 @@ Ptr<data::BatchStats> GraphGroup::collectStats(Ptr<ExpressionGraph> graph,
     if(inputTypes[i] == "class")
       localMaxes[i] = 1;
 
+  // derive the batch sizes from a shape-only memory plan instead of trial runs, see MemoryPlanner
+  if(options_->get<bool>("mini-batch-fit-plan", false)) {
+    float margin = options_->get<float>("mini-batch-fit-plan-margin");
+    size_t budget = (size_t)(graph->workspaceBytes() * (1.f - margin));
+
+    // builds the graph for a fake batch without executing it and returns its planned peak workspace
+    auto plan = [&](const std::vector<size_t>& lengths, size_t batchSize) {
+      auto batch = data::CorpusBatch::fakeBatch(lengths, vocabs, batchSize, options_);
+      model->build(graph, batch);
+      return (double)graph->planWorkspace();
+    };
+
+    for(size_t i = step; i <= maxLength; i += step) {
+      std::vector<size_t> lengths(numFiles, i);
+      for(int j = 0; j < lengths.size(); ++j)  // apply length restrictions
+        lengths[j] = std::min(lengths[j], localMaxes[j]);
+
+      // For a fixed sentence length the workspace grows linearly with the batch size, hence
+      // extrapolate from two plans, then correct downwards until the plan fits.
+      double small = plan(lengths, first);
+      double slope = std::max((plan(lengths, 2 * first) - small) / first, 1.0);
+      double estimate = first + (budget - small) / slope;
+      size_t current = estimate > 0 ? (size_t)estimate : 0;
+      while(current > 0 && plan(lengths, current) > budget)
+        current = std::min(current - 1, (size_t)(current * 0.95));
+
+      LOG(debug, "[batching] length: {} - planned size: {}", lengths[0], current);
+      if(current == 0) {
+        LOG(warn, "[batching] Not even a single sentence of length {} fits into the workspace", lengths[0]);
+        break;
+      }
+      stats->add(data::CorpusBatch::fakeBatch(lengths, vocabs, current, options_), multiplier);
+    }
+    return stats;
+  }
+
   size_t maxBatch = 512;
   bool fits = true;
   while(fits) {
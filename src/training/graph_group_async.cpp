@@ -73,11 +73,9 @@ void AsyncGraphGroup::pushGradients(Tensor newGrads,
           std::lock_guard<std::mutex> guard(shardSync_[idx]);
           grads_[idx]->copyFrom(newGrads->subtensor(pos, (int)grads_[idx]->size()));
 
-          shardOpt_[idx]->update(params_[idx], grads_[idx]);
-
-          if(mvAvg_)
-            updateAvgParams(
-                paramsAvg_[idx], params_[idx], scheduler_->numberOfBatches());
+          updateWithAvgParams(shardOpt_[idx], params_[idx], grads_[idx], mvAvg_ ? paramsAvg_[idx] : Tensor(),
+                              scheduler_->numberOfBatches(), OptimizerBase::mbSizeNotProvided,
+                              /*resetGrads=*/false);
         },
         idx,
         pos));
@@ -14,21 +14,18 @@ void SingletonGraph::execute(Ptr<data::Batch> batch) {
   graph_->forward();
   graph_->backward();
 
-  // Get batch stats
-  opt_->update(graph_);
-
-  if(mvAvg_) {
-    ABORT_IF(!scheduler_, "Scheduler is required for exponential smoothing");
-
-    if(!graphAvg_) {
-      graphAvg_ = New<ExpressionGraph>();
-      graphAvg_->setDevice(graph_->getDeviceId());
-      graphAvg_->copyParams(graph_);
-    } else {
-      updateAvgParams(graphAvg_->params()->vals(),
-                      graph_->params()->vals(),
-                      scheduler_->numberOfBatches());
-    }
+  ABORT_IF(mvAvg_ && !scheduler_, "Scheduler is required for exponential smoothing");
+
+  // the average starts as a copy of the parameters after the first update
+  updateWithAvgParams(opt_, graph_->params()->vals(), graph_->params()->grads(),
+                      graphAvg_ ? graphAvg_->params()->vals() : Tensor(),
+                      mvAvg_ ? scheduler_->numberOfBatches() : 0, OptimizerBase::mbSizeNotProvided,
+                      /*resetGrads=*/false);
+
+  if(mvAvg_ && !graphAvg_) {
+    graphAvg_ = New<ExpressionGraph>();
+    graphAvg_->setDevice(graph_->getDeviceId());
+    graphAvg_->copyParams(graph_);
   }
 
   if(scheduler_) {
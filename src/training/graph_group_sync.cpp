@@ -354,12 +354,8 @@ void SyncGraphGroup::update(std::vector<Ptr<data::Batch>> subBatches, size_t num
           batchTrgWords // total number of labels across all GPUs and nodes
         /*else*/:
           OptimizerBase::mbSizeNotProvided;
-    shardOpt_[idx]->update(curParam, curGrad, updateTrgWords);
-    curGrad->set(0.f);
-
-    if(mvAvg_)
-      updateAvgParams(
-          paramsAvg_[idx], curParam, scheduler_->numberOfBatches(), updateTrgWords);
+    updateWithAvgParams(shardOpt_[idx], curParam, curGrad, mvAvg_ ? paramsAvg_[idx] : Tensor(),
+                        scheduler_->numberOfBatches(), updateTrgWords, /*resetGrads=*/true);
   };
 
   // cost across all local devices (scheduler will aggregate cross-process)
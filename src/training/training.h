@@ -3,6 +3,7 @@
 #include "common/config.h"
 #include "common/utils.h"
 #include "data/batch_generator.h"
+#include "data/corpus_binary.h"
 #ifndef _MSC_VER // @TODO: include SqLite in Visual Studio project
 #include "data/corpus_sqlite.h"
 #endif
@@ -31,6 +32,8 @@ public:
 #else
       ABORT("SqLite presently not supported on Windows");
 #endif
+    else if(options_->hasAndNotEmpty("binary-corpus"))
+      dataset = New<CorpusBinary>(options_);
     else
       dataset = New<Corpus>(options_);
 
@@ -39,7 +42,18 @@ public:
     auto mpi = initMPI(/*multiThreaded=*/!options_->get<bool>("sync-sgd")); // @TODO: do we need the multiThreaded distinction at all?
 
     Ptr<BatchStats> stats;
-    if(options_->get<bool>("mini-batch-fit")) {
+    bool cacheStats = options_->get<bool>("mini-batch-fit-cache", false);
+    std::string statsFile = options_->get<std::string>("model") + ".batch-stats.yml";
+    std::string statsKey = BatchStats::configKey(options_, mpi->numMPIProcesses());
+    if(options_->get<bool>("mini-batch-fit") && cacheStats) {
+      stats = New<BatchStats>();
+      if(stats->load(statsFile, statsKey))
+        LOG(info, "[batching] Loaded statistics for batch fitting from {}", statsFile);
+      else
+        stats = nullptr;
+    }
+
+    if(options_->get<bool>("mini-batch-fit") && !stats) {
       LOG(info,
           "[batching] Collecting statistics for batch fitting with step size {}",
           options_->get<size_t>("mini-batch-fit-step"));
@@ -55,6 +69,11 @@ public:
       model->setScheduler(tempScheduler); // collectStats() needs to know about dynamic MB scaling
       stats = model->collectStats(dataset->getVocabs());
       LOG(info, "[batching] Done. Typical MB size is {} target words", utils::withCommas(stats->estimateTypicalTrgWords()));
+
+      if(cacheStats && mpi->myMPIRank() == 0) {
+        stats->save(statsFile, statsKey);
+        LOG(info, "[batching] Saved statistics for batch fitting to {}", statsFile);
+      }
     }
 
     auto trainState = New<TrainingState>(options_->get<float>("learn-rate"));
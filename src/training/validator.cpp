@@ -409,10 +409,13 @@ float TranslationValidator::validate(const std::vector<Ptr<ExpressionGraph>>& gr
     };
 
     threadPool_.reserve(graphs.size());
-    TaskBarrier taskBarrier;
-    for(auto batch : *batchGenerator_)
-      taskBarrier.push_back(threadPool_.enqueue(task, batch));
-    // ~TaskBarrier waits until all are done
+    {
+      TaskBarrier taskBarrier;
+      for(auto batch : *batchGenerator_)
+        taskBarrier.push_back(threadPool_.enqueue(task, batch));
+      // ~TaskBarrier waits until all are done
+    }
+    collector->flush(); // the output is written asynchronously
   }
 
   if(!quiet_)
@@ -548,10 +551,13 @@ float SacreBleuValidator::validate(const std::vector<Ptr<ExpressionGraph>>& grap
     };
 
     threadPool_.reserve(graphs.size());
-    TaskBarrier taskBarrier;
-    for(auto batch : *batchGenerator_)
-      taskBarrier.push_back(threadPool_.enqueue(task, batch));
-    // ~TaskBarrier waits until all are done
+    {
+      TaskBarrier taskBarrier;
+      for(auto batch : *batchGenerator_)
+        taskBarrier.push_back(threadPool_.enqueue(task, batch));
+      // ~TaskBarrier waits until all are done
+    }
+    collector->flush(); // the output is written asynchronously
   }
 
   if(!quiet_)
@@ -1,10 +1,14 @@
 #include "translator/beam_search.h"
 
+#include "common/timer.h"
 #include "data/factored_vocab.h"
 #include "translator/helpers.h"
 #include "translator/nth_element.h"
 #include "data/shortlist.h"
 
+#include <algorithm>
+#include <unordered_map>
+
 namespace marian {
 
 // combine new expandedPathScores and previous beams into new set of beams
@@ -17,7 +21,8 @@ Beams BeamSearch::toHyps(const std::vector<unsigned int>& nBestKeys, // [current
                          Ptr<data::CorpusBatch /*const*/> batch, // for alignments only
                          Ptr<FactoredVocab/*const*/> factoredVocab, size_t factorGroup,
                          const std::vector<bool>& dropBatchEntries, // [origDimBatch] - empty source batch entries are marked with true, should be cleared after first use.
-                         const std::vector<IndexType>& batchIdxMap) const { // [origBatchIdx -> currentBatchIdx]
+                         const std::vector<IndexType>& batchIdxMap, // [origBatchIdx -> currentBatchIdx]
+                         HypothesisPool& pool) const {
   std::vector<float> align; // collects alignment information from the last executed time step
   if(options_->hasAndNotEmpty("alignment") && factorGroup == 0)
     align = scorers_[0]->getAlignment(); // [beam depth * max src length * current batch size] -> P(s|t); use alignments from the first scorer, even if ensemble,
@@ -119,7 +124,7 @@ Beams BeamSearch::toHyps(const std::vector<unsigned int>& nBestKeys, // [current
     else
       word = Word::fromWordIndex(wordIdx);
 
-    auto hyp = Hypothesis::New(prevHyp, word, prevBeamHypIdx, pathScore);
+    auto hyp = pool.New(prevHyp, word, prevBeamHypIdx, pathScore);
 
     // Set score breakdown for n-best lists
     if(options_->get<bool>("n-best")) {
@@ -145,8 +150,8 @@ Beams BeamSearch::toHyps(const std::vector<unsigned int>& nBestKeys, // [current
     // Set alignments
     if(!align.empty())
       hyp->setAlignment(getAlignmentsForHypothesis(align, batch, (int)beamHypIdx, (int)currentBatchIdx, (int)origBatchIdx, (int)currentDimBatch));
-    else // not first factor: just copy
-      hyp->setAlignment(beam[beamHypIdx]->getAlignment());
+    else // not first factor: just share
+      hyp->shareAlignment(*beam[beamHypIdx]);
 
     newBeam.push_back(hyp);
   }
@@ -223,6 +228,42 @@ std::vector<float> BeamSearch::getAlignmentsForHypothesis( // -> P(s|t) for curr
   return align;
 }
 
+// remove hyps that fall too far behind the best hyp of their beam, see Freitag and Al-Onaizan (2017),
+// "Beam Search Strategies for Neural Machine Translation"
+Beams BeamSearch::pruneBeams(const Beams& beams) const {
+  Beams newBeams;
+  for(const auto& beam : beams) {
+    if(beam.empty()) {
+      newBeams.push_back(beam);
+      continue;
+    }
+
+    Beam sortedBeam = beam; // best hyp first, candidates of a node are counted in that order
+    std::stable_sort(sortedBeam.begin(), sortedBeam.end(), [](const Hypothesis::PtrType& a, const Hypothesis::PtrType& b) {
+      return a->getPathScore() > b->getPathScore();
+    });
+
+    float threshold = std::numeric_limits<float>::lowest();
+    float bestScore = sortedBeam.front()->getPathScore();
+    if(pruneRelative_ > 0.f) // relative to the probability, hence log(pruneRelative_) in log space
+      threshold = std::max(threshold, bestScore + std::log(pruneRelative_));
+    if(pruneAbsolute_ > 0.f)
+      threshold = std::max(threshold, bestScore - pruneAbsolute_);
+
+    Beam newBeam;
+    std::unordered_map<Hypothesis*, size_t> candidatesPerNode; // number of kept hyps per previous hyp
+    for(const auto& hyp : sortedBeam) {
+      if(hyp->getPathScore() < threshold) // sorted, so all remaining hyps are below the threshold as well
+        break;
+      if(maxCandidatesPerNode_ > 0 && ++candidatesPerNode[hyp->getPrevHyp().get()] > maxCandidatesPerNode_)
+        continue;
+      newBeam.push_back(hyp);
+    }
+    newBeams.push_back(newBeam);
+  }
+  return newBeams;
+}
+
 // remove all beam entries that have reached EOS
 Beams BeamSearch::purgeBeams(const Beams& beams, /*in/out=*/std::vector<IndexType>& batchIdxMap) {
   const auto trgEosId = trgVocab_->getEosId();
@@ -262,16 +303,23 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
 
   auto getNBestList = createGetNBestListFn(beamSize_, origDimBatch, graph->getDeviceId());
 
+  timer::Timer searchTimer;
+  times_ = SearchTimes();
+
   for(auto scorer : scorers_) {
     scorer->clear(graph);
   }
 
+  // all hypotheses of this search, freed when the last of the histories is gone
+  auto pool = New<HypothesisPool>();
+
   Histories histories(origDimBatch);
   for(int i = 0; i < origDimBatch; ++i) {
     size_t sentId = batch->getSentenceIds()[i];
     histories[i] = New<History>(sentId,
                                 options_->get<float>("normalize"),
-                                options_->get<float>("word-penalty"));
+                                options_->get<float>("word-penalty"),
+                                pool);
   }
 
   // start states
@@ -279,9 +327,15 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
   for(auto scorer : scorers_) {
     states.push_back(scorer->startState(graph, batch));
   }
+  if(profile_) {
+    timer::Timer encoderTimer;
+    graph->forward();
+    graph->getBackend()->synchronize();
+    times_.encoder = encoderTimer.elapsed();
+  }
 
   // create one beam per batch entry with sentence-start hypothesis
-  Beams beams(origDimBatch, Beam(beamSize_, Hypothesis::New())); // array [origDimBatch] of array [maxBeamSize] of Hypothesis, keeps full size through search.
+  Beams beams(origDimBatch, Beam(beamSize_, pool->New())); // array [origDimBatch] of array [maxBeamSize] of Hypothesis, keeps full size through search.
                                                                  // batch purging is determined from an empty sub-beam.
   std::vector<IndexType> batchIdxMap(origDimBatch); // Record at which batch entry a beam is looking.
                                                     // By default that corresponds to position in array,
@@ -403,6 +457,7 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
 
       //**********************************************************************
       // compute expanded path scores with word prediction probs from all scorers
+      timer::Timer decoderTimer;
       auto expandedPathScores = prevPathScores; // will become [maxBeamSize, 1, currDimBatch, dimVocab]
       Expr logProbs;
       for(size_t i = 0; i < scorers_.size(); ++i) {
@@ -451,6 +506,10 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
         graph->forward();
       else
         graph->forwardNext();
+      if(profile_) {
+        graph->getBackend()->synchronize();
+        times_.decoder += decoderTimer.elapsed();
+      }
 
       //**********************************************************************
       // suppress specific symbols if not at right positions
@@ -482,22 +541,28 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
                      batch,             // only used for propagating alignment info
                      factoredVocab, factorGroup,
                      emptyBatchEntries, // [origDimBatch] - empty source batch entries are marked with true
-                     batchIdxMap);      // used to create a reverse batch index map to recover original batch indices for this step
+                     batchIdxMap,       // used to create a reverse batch index map to recover original batch indices for this step
+                     *pool);
     } // END FOR factorGroup = 0 .. numFactorGroups-1
 
+    // narrow each beam down to the hyps that are still competitive
+    if(pruneRelative_ > 0.f || pruneAbsolute_ > 0.f || maxCandidatesPerNode_ > 0)
+      beams = pruneBeams(beams);
+
     prevBatchIdxMap = batchIdxMap; // save current batchIdx map to be used in next step; we are then going to look one step back
 
     // remove all hyps that end in EOS
     // The position of a hyp in the beam may change.
     // in/out = shifts the batch index map if a beam gets fully purged
-    const auto purgedNewBeams = purgeBeams(beams, /*in/out=*/batchIdxMap);
+    auto purgedNewBeams = purgeBeams(beams, /*in/out=*/batchIdxMap);
 
     // add updated search space (beams) to our return value
+    const float maxLength = options_->get<float>("max-length-factor") * batch->front()->batchWidth();
     bool maxLengthReached = false;
     for(int batchIdx = 0; batchIdx < origDimBatch; ++batchIdx) {
       // if this batch entry has surviving hyps then add them to the traceback grid
       if(!beams[batchIdx].empty()) { // if the beam is not empty expand the history object associated with the beam
-        if (histories[batchIdx]->size() >= options_->get<float>("max-length-factor") * batch->front()->batchWidth())
+        if (histories[batchIdx]->size() >= maxLength)
           maxLengthReached = true;
         histories[batchIdx]->add(beams[batchIdx], trgEosId, purgedNewBeams[batchIdx].empty() || maxLengthReached);
       }
@@ -505,10 +570,34 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
     if (maxLengthReached) // early exit if max length limit was reached
       break;
 
+    // finish batch entries for which no surviving hyp can beat the best finished one anymore
+    if(earlyStop_) {
+      for(int batchIdx = 0; batchIdx < origDimBatch; ++batchIdx) {
+        auto& beam = purgedNewBeams[batchIdx];
+        const auto& history = histories[batchIdx];
+        if(beam.empty() || !history->hasFinished())
+          continue;
+
+        float bestScore = history->bestNormalizedScore();
+        bool canImprove = std::any_of(beam.begin(), beam.end(), [&](const Hypothesis::PtrType& hyp) {
+          return history->normalizedScoreBound(hyp->getPathScore(), (size_t)maxLength) > bestScore;
+        });
+        if(!canImprove) {
+          beam.clear(); // like purgeBeams(), shift the entries above as this one is removed from the batch
+          if(PURGE_BATCH)
+            for(size_t i = batchIdx + 1; i < batchIdxMap.size(); ++i)
+              batchIdxMap[i] = batchIdxMap[i] - 1;
+        }
+      }
+    }
+
     // this is the search space for the next output time step
     beams = purgedNewBeams;
   } // end of main loop over output time steps
 
+  if(profile_)
+    times_.search = searchTimer.elapsed() - times_.encoder - times_.decoder;
+
   return histories; // [origDimBatch][t][N best hyps]
 }
 
@@ -2,10 +2,18 @@
 
 #include "marian.h"
 #include "translator/history.h"
+#include "translator/sampling.h"
 #include "translator/scorers.h"
 
 namespace marian {
 
+// Wall-clock time in seconds spent in the phases of BeamSearch::search()
+struct SearchTimes {
+  double encoder{0}; // building and running the encoders, i.e. the start states
+  double decoder{0}; // building and running the decoder steps
+  double search{0};  // everything else: n-best selection, beam bookkeeping and histories
+};
+
 class BeamSearch {
 private:
   Ptr<Options> options_;
@@ -13,13 +21,31 @@ private:
   size_t beamSize_;
   Ptr<const Vocab> trgVocab_;
 
+  // adaptive beam pruning and early stopping, see pruneBeams() and search()
+  float pruneRelative_;
+  float pruneAbsolute_;
+  size_t maxCandidatesPerNode_;
+  bool earlyStop_;
+
+  // the encoders are run separately from the first decoder step to time them, see times()
+  bool profile_{false};
+  SearchTimes times_;
+
   const float INVALID_PATH_SCORE = std::numeric_limits<float>::lowest(); // @TODO: observe this closely
   const bool PURGE_BATCH = true; // @TODO: diagnostic, to-be-removed once confirmed there are no issues.
 
 public:
   BeamSearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab)
-      : options_(options), scorers_(scorers), beamSize_(options_->get<size_t>("beam-size")), trgVocab_(trgVocab)
-  {}
+      : options_(options), scorers_(scorers), beamSize_(options_->get<size_t>("beam-size")), trgVocab_(trgVocab),
+        pruneRelative_(options_->get<float>("beam-prune-relative", 0.f)),
+        pruneAbsolute_(options_->get<float>("beam-prune-absolute", 0.f)),
+        maxCandidatesPerNode_(options_->get<size_t>("beam-max-candidates-per-node", 0)),
+        earlyStop_(options_->get<bool>("early-stop", false)) {
+    ABORT_IF(pruneRelative_ < 0.f || pruneRelative_ > 1.f, "--beam-prune-relative must be in [0, 1]");
+    ABORT_IF(pruneAbsolute_ < 0.f, "--beam-prune-absolute must not be negative");
+    ABORT_IF(OutputSampler::isEnabled(options_),
+             "Restricted output sampling requires --beam-size 1 without --n-best, --alignment or factored vocabularies");
+  }
 
   // combine new expandedPathScores and previous beams into new set of beams
   Beams toHyps(const std::vector<unsigned int>& nBestKeys, // [currentDimBatch, beamSize] flattened -> ((batchIdx, beamHypIdx) flattened, word idx) flattened
@@ -31,7 +57,8 @@ public:
                Ptr<data::CorpusBatch /*const*/> batch, // for alignments only
                Ptr<class FactoredVocab/*const*/> factoredVocab, size_t factorGroup,
                const std::vector<bool>& dropBatchEntries, // [origDimBatch] - empty source batch entries are marked with true, should be cleared after first use.
-               const std::vector<IndexType>& batchIdxMap) const;
+               const std::vector<IndexType>& batchIdxMap,
+               HypothesisPool& pool) const; // new hypotheses are allocated here
 
   std::vector<float> getAlignmentsForHypothesis( // -> P(s|t) for current t and given beam and batch dim
       const std::vector<float> alignAll, // [beam depth, max src length, batch size, 1], flattened vector of all attention probablities
@@ -41,11 +68,23 @@ public:
       int origBatchIdx,
       int currentDimBatch) const;
 
+  // remove hypotheses that fall too far behind the best one in their beam or that expand a
+  // previous hypothesis that already has maxCandidatesPerNode_ better expansions in the beam.
+  // The best hypothesis is always kept, hence a beam never becomes empty.
+  Beams pruneBeams(const Beams& beams) const;
+
   // remove all beam entries that have reached EOS
   Beams purgeBeams(const Beams& beams, /*in/out=*/std::vector<IndexType>& batchIdxMap);
 
   // main decoding function
   Histories search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch);
+
+  // Measure where the time of search() goes. Adds one synchronization point between the encoders and the
+  // first decoder step, the translations are not affected.
+  void setProfiling(bool profile) { profile_ = profile; }
+
+  // times of the last call to search() if profiling is enabled
+  const SearchTimes& times() const { return times_; }
 };
 
 }  // namespace marian
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "common/logging.h"
+#include "common/options.h"
+#include "data/corpus_base.h"
+#include "translator/beam_search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace marian {
+
+// Collects latency and throughput statistics when the translator runs with --benchmark.
+//
+// Without --benchmark-arrival-rate the whole input is available from the start and the latency of
+// a sentence is the time it took to translate its batch. With an arrival rate, sentences arrive as
+// a Poisson process, a batch is only started once all its sentences have arrived and the latency
+// of a sentence is measured from its arrival, i.e. includes waiting for the batch and the workers.
+// Thread-safe.
+class DecodingBenchmark {
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  Clock::time_point start_;
+
+  double arrivalRate_; // sentences per second, 0 if all input is available from the start
+  std::mt19937 engine_;
+  std::vector<double> arrivals_; // arrival times in seconds after start_, by sentence id
+
+  std::vector<double> latencies_; // seconds, one per sentence
+  size_t batches_{0};
+  size_t srcWords_{0};
+  size_t trgWords_{0};
+  SearchTimes times_; // summed over all batches and workers
+  double busy_{0};    // summed translation time of all batches
+
+  std::mutex mutex_;
+
+  static double percentile(const std::vector<double>& sorted, double p) {
+    size_t i = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(std::max(i, (size_t)1), sorted.size()) - 1];
+  }
+
+public:
+  DecodingBenchmark(Ptr<Options> options)
+      : start_(Clock::now()),
+        arrivalRate_(options->get<float>("benchmark-arrival-rate", 0.f)),
+        engine_((unsigned int)options->get<size_t>("seed", 1234)) {
+    ABORT_IF(arrivalRate_ < 0.f, "--benchmark-arrival-rate must not be negative");
+  }
+
+  // seconds since the benchmark started
+  double now() const { return std::chrono::duration<double>(Clock::now() - start_).count(); }
+
+  // Simulated arrival time of a sentence in seconds, 0 without arrival rate. Not thread-safe,
+  // only called from the thread that reads the input.
+  double arrival(size_t sentenceId) {
+    if(arrivalRate_ == 0.f)
+      return 0.;
+    std::exponential_distribution<double> interArrival(arrivalRate_);
+    while(arrivals_.size() <= sentenceId)
+      arrivals_.push_back((arrivals_.empty() ? 0. : arrivals_.back()) + interArrival(engine_));
+    return arrivals_[sentenceId];
+  }
+
+  // Blocks until all sentences of the batch have arrived, returns the arrival times
+  std::vector<double> waitForArrival(Ptr<data::CorpusBatch> batch) {
+    std::vector<double> arrivals;
+    for(auto id : batch->getSentenceIds())
+      arrivals.push_back(arrival(id));
+    double last = *std::max_element(arrivals.begin(), arrivals.end());
+    double wait = last - now();
+    if(wait > 0)
+      std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+    return arrivals;
+  }
+
+  // Records a translated batch that started at batchStart and produced trgWords target tokens
+  void add(Ptr<data::CorpusBatch> batch,
+           const std::vector<double>& arrivals,
+           double batchStart,
+           size_t trgWords,
+           const SearchTimes& times) {
+    double end = now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(auto arrival : arrivals)
+      latencies_.push_back(end - (arrivalRate_ > 0.f ? arrival : batchStart));
+    batches_++;
+    srcWords_ += batch->front()->batchWords();
+    trgWords_ += trgWords;
+    times_.encoder += times.encoder;
+    times_.decoder += times.decoder;
+    times_.search  += times.search;
+    busy_ += end - batchStart;
+  }
+
+  // Logs the statistics, to be called once all batches have been added
+  void report(size_t peakWorkspace) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double elapsed = now();
+    if(latencies_.empty()) {
+      LOG(info, "[benchmark] No sentences translated");
+      return;
+    }
+
+    auto sorted = latencies_;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for(auto l : sorted)
+      mean += l;
+    mean /= sorted.size();
+
+    LOG(info, "[benchmark] {} sentences in {} batches, {:.3f}s", sorted.size(), batches_, elapsed);
+    LOG(info,
+        "[benchmark] Throughput: {:.2f} sentences/s, {:.2f} source words/s, {:.2f} target words/s",
+        sorted.size() / elapsed, srcWords_ / elapsed, trgWords_ / elapsed);
+    LOG(info,
+        "[benchmark] Latency: mean {:.2f}ms, p50 {:.2f}ms, p90 {:.2f}ms, p99 {:.2f}ms, max {:.2f}ms",
+        1000 * mean, 1000 * percentile(sorted, 0.5), 1000 * percentile(sorted, 0.9),
+        1000 * percentile(sorted, 0.99), 1000 * sorted.back());
+    double total = times_.encoder + times_.decoder + times_.search;
+    if(total > 0)
+      LOG(info,
+          "[benchmark] Search time: encoder {:.3f}s ({:.1f}%), decoder steps {:.3f}s ({:.1f}%), "
+          "search bookkeeping {:.3f}s ({:.1f}%), other {:.3f}s",
+          times_.encoder, 100 * times_.encoder / total,
+          times_.decoder, 100 * times_.decoder / total,
+          times_.search, 100 * times_.search / total,
+          std::max(busy_ - total, 0.));
+    LOG(info, "[benchmark] Peak workspace: {:.2f} MB", peakWorkspace / 1024. / 1024.);
+  }
+};
+
+}  // namespace marian
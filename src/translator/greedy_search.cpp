@@ -0,0 +1,204 @@
+#include "translator/greedy_search.h"
+
+#include "common/config.h"
+#include "common/timer.h"
+#include "data/factored_vocab.h"
+#include "data/shortlist.h"
+#include "translator/helpers.h"
+
+#include <numeric>
+#include <random>
+
+namespace marian {
+
+Histories GreedySearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch) {
+  // factors are predicted one at a time, which needs the hypotheses of the beam search
+  auto factoredVocab = trgVocab_->tryAs<FactoredVocab>();
+  if(factoredVocab && factoredVocab->getNumGroups() > 1) {
+    BeamSearch beamSearch(options_, scorers_, trgVocab_);
+    beamSearch.setProfiling(profile_);
+    auto histories = beamSearch.search(graph, batch);
+    times_ = beamSearch.times();
+    return histories;
+  }
+
+  const int origDimBatch = (int)batch->size();
+  const auto trgEosId = trgVocab_->getEosId();
+  const auto trgUnkId = trgVocab_->getUnkId();
+
+  timer::Timer searchTimer;
+  times_ = SearchTimes();
+
+  for(auto scorer : scorers_)
+    scorer->clear(graph);
+
+  std::vector<Ptr<ScorerState>> states;
+  for(auto scorer : scorers_)
+    states.push_back(scorer->startState(graph, batch));
+  if(profile_) {
+    timer::Timer encoderTimer;
+    graph->forward();
+    graph->getBackend()->synchronize();
+    times_.encoder = encoderTimer.elapsed();
+  }
+
+  // same as in BeamSearch::search(): suppress unk unless allowed, with shifted position in case of a shortlist
+  auto shortlist = scorers_[0]->getShortlist();
+  int unkColId = -1;
+  if(trgUnkId != Word::NONE && !options_->get<bool>("allow-unk", false)) {
+    unkColId = trgUnkId.toWordIndex();
+    if(shortlist)
+      unkColId = shortlist->tryForwardMap(unkColId);
+  }
+
+  // empty source lines are forced to EOS in the first step
+  const auto srcEosId = batch->front()->vocab()->getEosId();
+  const float maxLength = options_->get<float>("max-length-factor") * batch->front()->batchWidth();
+
+  // output of the search, one flat array of words and path scores per sentence
+  std::vector<Words> words(origDimBatch);
+  std::vector<std::vector<float>> pathScores(origDimBatch);
+
+  // one random stream per sentence for sampling
+  std::vector<std::mt19937> engines;
+  if(sampler_) {
+    for(int origBatchIdx = 0; origBatchIdx < origDimBatch; ++origBatchIdx) {
+      size_t sentId = batch->getSentenceIds()[origBatchIdx];
+      std::seed_seq seed{(uint32_t)Config::seed, (uint32_t)(Config::seed >> 32),
+                         (uint32_t)sentId, (uint32_t)(sentId >> 32)};
+      engines.emplace_back(seed);
+    }
+  }
+
+  std::vector<IndexType> active(origDimBatch); // [currentBatchIdx -> origBatchIdx] unfinished sentences in the order of the state tensors
+  std::iota(active.begin(), active.end(), 0);
+
+  // inputs of the next decoder step. hypIndices stays empty as long as no sentence has finished,
+  // i.e. the decoder states do not need to be touched; batchIndices refers to the previous step.
+  std::vector<IndexType> hypIndices;
+  std::vector<IndexType> batchIndices = active;
+  std::vector<Word> prevWords;
+
+  for(size_t t = 0; !active.empty(); t++) {
+    timer::Timer decoderTimer;
+    const int currentDimBatch = (int)active.size();
+
+    Expr stepScores; // [currentDimBatch, 1, 1, dimVocab]
+    for(size_t i = 0; i < scorers_.size(); ++i) {
+      states[i] = scorers_[i]->step(graph, states[i], hypIndices, prevWords, batchIndices, /*beamSize=*/1);
+      auto logProbs = scorers_[i]->getWeight() * states[i]->getLogProbs().getLogits(); // [1, 1, currentDimBatch, dimVocab]
+      stepScores = i == 0 ? logProbs : stepScores + logProbs;
+    }
+    stepScores = reshape(stepScores, {currentDimBatch, 1, 1, stepScores->shape()[-1]});
+
+    if(t == 0)
+      graph->forward();
+    else
+      graph->forwardNext();
+
+    if(unkColId != -1)
+      suppressWord(stepScores, unkColId);
+    for(auto state : states)
+      state->blacklist(stepScores, batch);
+
+    std::vector<float> bestScores;
+    std::vector<IndexType> bestIndices;
+    if(sampler_) {
+      // draw from the log probabilities in place on the CPU, other devices copy them over first
+      const size_t dimVocab = stepScores->shape()[-1];
+      std::vector<float> hostScores;
+      const float* scores;
+      if(stepScores->val()->getBackend()->getDeviceId().type == DeviceType::cpu) {
+        scores = stepScores->val()->data<float>();
+      } else {
+        stepScores->val()->get(hostScores);
+        scores = hostScores.data();
+      }
+      bestScores.resize(currentDimBatch);
+      bestIndices.resize(currentDimBatch);
+      for(int currentBatchIdx = 0; currentBatchIdx < currentDimBatch; ++currentBatchIdx)
+        bestIndices[currentBatchIdx] = sampler_->sample(scores + currentBatchIdx * dimVocab, dimVocab,
+                                                        engines[active[currentBatchIdx]],
+                                                        /*out*/ bestScores[currentBatchIdx]);
+    } else {
+      // only the best score and word of each sentence leave the device
+      auto best = argmax(stepScores, /*axis=*/-1); // [currentDimBatch, 1, 1, 1] each
+      graph->forwardNext();
+      std::get<0>(best)->val()->get(bestScores);
+      std::get<1>(best)->val()->get(bestIndices);
+    }
+
+    if(profile_) {
+      graph->getBackend()->synchronize();
+      times_.decoder += decoderTimer.elapsed();
+    }
+
+    bool maxLengthReached = t + 1 >= maxLength; // BeamSearch counts the start hypothesis as a time step
+    std::vector<IndexType> survivors;            // [currentBatchIdx] of sentences that continue
+    for(int currentBatchIdx = 0; currentBatchIdx < currentDimBatch; ++currentBatchIdx) {
+      auto origBatchIdx = active[currentBatchIdx];
+      float prevScore = pathScores[origBatchIdx].empty() ? 0.f : pathScores[origBatchIdx].back();
+
+      Word word;
+      float pathScore;
+      if(t == 0 && batch->front()->data()[origBatchIdx] == srcEosId) {
+        word = trgEosId;
+        pathScore = 0.f;
+      } else {
+        auto wordIdx = bestIndices[currentBatchIdx];
+        word = Word::fromWordIndex(shortlist ? shortlist->reverseMap(wordIdx) : wordIdx);
+        pathScore = prevScore + bestScores[currentBatchIdx];
+      }
+      words[origBatchIdx].push_back(word);
+      pathScores[origBatchIdx].push_back(pathScore);
+
+      if(word != trgEosId && !maxLengthReached)
+        survivors.push_back(currentBatchIdx);
+    }
+    if(maxLengthReached)
+      break;
+
+    // select the decoder states of the surviving sentences only if some have finished
+    if(survivors.size() == active.size()) {
+      hypIndices.clear();
+      batchIndices.resize(active.size());
+      std::iota(batchIndices.begin(), batchIndices.end(), 0);
+    } else {
+      hypIndices = survivors;
+      batchIndices = survivors;
+    }
+    std::vector<IndexType> nextActive;
+    prevWords.clear();
+    for(auto currentBatchIdx : survivors) {
+      nextActive.push_back(active[currentBatchIdx]);
+      prevWords.push_back(words[active[currentBatchIdx]].back());
+    }
+    active = nextActive;
+  }
+
+  // turn the outputs into the traceback grids of the beam search, one hypothesis per time step
+  auto pool = New<HypothesisPool>();
+  Histories histories(origDimBatch);
+  for(int origBatchIdx = 0; origBatchIdx < origDimBatch; ++origBatchIdx) {
+    size_t sentId = batch->getSentenceIds()[origBatchIdx];
+    auto history = New<History>(sentId,
+                                options_->get<float>("normalize"),
+                                options_->get<float>("word-penalty"),
+                                pool);
+    auto hyp = pool->New();
+    history->add(Beam(1, hyp), trgEosId);
+    const auto& sentWords = words[origBatchIdx];
+    for(size_t i = 0; i < sentWords.size(); ++i) {
+      hyp = pool->New(hyp, sentWords[i], /*prevBeamHypIdx=*/0, pathScores[origBatchIdx][i]);
+      history->add(Beam(1, hyp), trgEosId, /*last=*/i + 1 == sentWords.size());
+    }
+    histories[origBatchIdx] = history;
+  }
+
+  if(profile_)
+    times_.search = searchTimer.elapsed() - times_.encoder - times_.decoder;
+
+  return histories;
+}
+
+}  // namespace marian
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "marian.h"
+#include "translator/beam_search.h"
+#include "translator/history.h"
+#include "translator/sampling.h"
+#include "translator/scorers.h"
+
+namespace marian {
+
+// Search for --beam-size 1 that skips the beam machinery of BeamSearch. Takes the argmax of the
+// combined scorer outputs per sentence, keeps the decoder states in place as long as no sentence
+// finishes and only selects the surviving batch entries when one does. Output words and path
+// scores are collected per sentence and turned into the usual Histories once at the end.
+//
+// Produces the same translations as BeamSearch with beam size 1. N-best lists and alignments are
+// not supported, see isApplicable(); factored vocabularies are passed on to BeamSearch.
+//
+// With restricted output sampling (see OutputSampler) the next words are drawn on the host instead
+// of taking the argmax. Every sentence has its own random stream seeded from --seed and its
+// sentence id, so samples do not depend on batching or on the number of workers.
+class GreedySearch {
+private:
+  Ptr<Options> options_;
+  std::vector<Ptr<Scorer>> scorers_;
+  Ptr<const Vocab> trgVocab_;
+  Ptr<OutputSampler> sampler_; // null unless restricted output sampling is enabled
+
+  bool profile_{false};
+  SearchTimes times_;
+
+public:
+  GreedySearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab)
+      : options_(options), scorers_(scorers), trgVocab_(trgVocab) {
+    ABORT_IF(!isApplicable(options_), "Greedy search requires --beam-size 1 without --n-best and --alignment");
+    if(OutputSampler::isEnabled(options_))
+      sampler_ = New<OutputSampler>(options_);
+  }
+
+  // true if the options ask for nothing that needs the full beam search
+  static bool isApplicable(Ptr<Options> options) {
+    return options->get<size_t>("beam-size") == 1
+           && !options->get<bool>("n-best", false)
+           && !options->hasAndNotEmpty("alignment");
+  }
+
+  // main decoding function
+  Histories search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch);
+
+  // see BeamSearch::setProfiling()
+  void setProfiling(bool profile) { profile_ = profile; }
+
+  const SearchTimes& times() const { return times_; }
+};
+
+}  // namespace marian
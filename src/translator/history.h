@@ -3,6 +3,8 @@
 #include "data/types.h"
 #include "hypothesis.h"
 
+#include <algorithm>
+#include <limits>
 #include <queue>
 
 namespace marian {
@@ -22,7 +24,8 @@ private:
   float lengthPenalty(size_t length) { return std::pow((float)length, alpha_); }
   float wordPenalty(size_t length) { return wp_ * (float)length; }
 public:
-  History(size_t lineNo, float alpha = 1.f, float wp_ = 0.f);
+  // pool is the arena of the hypotheses that are added, it is kept alive with the history
+  History(size_t lineNo, float alpha = 1.f, float wp_ = 0.f, Ptr<HypothesisPool> pool = nullptr);
 
   void add(const Beam& beam, Word trgEosId, bool last = false) {
     if(beam.back()->getPrevHyp() != nullptr) { // if not start hyp do
@@ -37,6 +40,29 @@ public:
 
   size_t size() const { return history_.size(); } // number of time steps
 
+  bool hasFinished() const { return !topHyps_.empty(); }
+
+  // normalized score of the best sentence hypothesis found so far, lowest float if there is none
+  float bestNormalizedScore() const {
+    return topHyps_.empty() ? std::numeric_limits<float>::lowest() : topHyps_.top().normalizedPathScore;
+  }
+
+  // Upper bound of the normalized score that any completion of an unfinished hypothesis with the
+  // given path score can reach, if it ends at a time step in [size(), maxLength]. Relies on path
+  // scores never increasing, i.e. on all expansion scores being log probabilities.
+  float normalizedScoreBound(float pathScore, size_t maxLength) const {
+    size_t minLength = std::max(history_.size(), (size_t)1);
+    maxLength = std::max(maxLength, minLength);
+    // a word penalty lowers the score at every step, a word reward raises it up to the maximum length
+    float score = pathScore - wp_ * (float)(wp_ >= 0.f ? minLength : maxLength);
+    // dividing a negative score by a larger length penalty raises it, a positive one by a smaller one
+    if(alpha_ != 0.f) {
+      bool useMaxLength = (score < 0.f) == (alpha_ > 0.f);
+      score /= std::pow((float)(useMaxLength ? maxLength : minLength), alpha_);
+    }
+    return score;
+  }
+
   /* return n best hypotheses
    * @param n size of n-best list
    * @param skipEmpty skip empty hypotheses (see also: https://arxiv.org/abs/1908.10090)
@@ -73,6 +99,7 @@ public:
   size_t getLineNum() const { return lineNo_; }
 
 private:
+  Ptr<HypothesisPool> pool_; // declared first, so that the hypotheses in history_ are released before it
   std::vector<Beam> history_; // [time step][index into beam] search grid @TODO: simplify as this is currently an expensive length count
   std::priority_queue<SentenceHypothesisCoord> topHyps_; // all sentence hypotheses (those that reached eos), sorted by score
   size_t lineNo_;
@@ -1,11 +1,15 @@
 #pragma once
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "common/definitions.h"
 #include "data/alignment.h"
 
 namespace marian {
 
+class HypothesisPool;
+
 // one single (partial or full) hypothesis in beam search
 // key elements:
 //  - the word that this hyp ends with
@@ -16,23 +20,20 @@ public:
   typedef IPtr<Hypothesis> PtrType;
 
 private:
-  // Constructors are private, use Hypothesis::New(...)
+  // Constructors are private, use HypothesisPool::New(...)
+  friend class HypothesisPool;
 
-  Hypothesis() : prevHyp_(nullptr), prevBeamHypIdx_(0), word_(Word::ZERO), pathScore_(0.0) {}
+  Hypothesis(HypothesisPool* pool)
+      : pool_(pool), prevHyp_(nullptr), prevBeamHypIdx_(0), word_(Word::ZERO), pathScore_(0.0) {}
 
-  Hypothesis(const PtrType prevHyp,
+  Hypothesis(HypothesisPool* pool,
+             const PtrType prevHyp,
              Word word,
              size_t prevBeamHypIdx, // beam-hyp index that this hypothesis originated from
              float pathScore)
-      : prevHyp_(prevHyp), prevBeamHypIdx_(prevBeamHypIdx), word_(word), pathScore_(pathScore) {}
+      : pool_(pool), prevHyp_(prevHyp), prevBeamHypIdx_(prevBeamHypIdx), word_(word), pathScore_(pathScore) {}
 
 public:
- // Use this whenever creating a pointer to MemoryPiece
- template <class ...Args>
- static PtrType New(Args&& ...args) {
-   return PtrType(new Hypothesis(std::forward<Args>(args)...));
- }
-
   const PtrType getPrevHyp() const { return prevHyp_; }
 
   Word getWord() const { return word_; }
@@ -41,11 +42,14 @@ public:
 
   float getPathScore() const { return pathScore_; }
 
-  const std::vector<float>& getScoreBreakdown() { return scoreBreakdown_; }
-  void setScoreBreakdown(const std::vector<float>& scoreBreakdown) { scoreBreakdown_ = scoreBreakdown; }
+  // score of each scorer, only set for n-best lists
+  inline std::vector<float> getScoreBreakdown() const;
+  inline void setScoreBreakdown(const std::vector<float>& scoreBreakdown);
 
-  const std::vector<float>& getAlignment() { return alignment_; }
-  void setAlignment(const std::vector<float>& align) { alignment_ = align; };
+  inline std::vector<float> getAlignment() const;
+  inline void setAlignment(const std::vector<float>& align);
+  // use the alignment of another hypothesis from the same pool without copying it
+  void shareAlignment(const Hypothesis& other) { alignment_ = other.alignment_; }
 
   // trace back paths referenced from this hypothesis
   Words tracebackWords() {
@@ -83,17 +87,119 @@ public:
   }
 
 private:
+  // section of one of the flat buffers of the pool
+  struct Range {
+    size_t offset;
+    size_t size;
+  };
+
+  HypothesisPool* pool_;
   const PtrType prevHyp_;
   const size_t prevBeamHypIdx_;
   const Word word_;
   const float pathScore_;
 
-  std::vector<float> scoreBreakdown_; // [num scorers]
-  std::vector<float> alignment_;
+  Range scoreBreakdown_{0, 0}; // [num scorers]
+  Range alignment_{0, 0};
+
+  // Reference counting of ENABLE_INTRUSIVE_PTR, except that the memory is owned by the pool and
+  // only released together with it
+  size_t references_{0};
+
+  inline friend void intrusivePtrAddRef(Hypothesis* x) {
+    if(x != 0)
+      ++x->references_;
+  }
+
+  inline friend void intrusivePtrRelease(Hypothesis* x) {
+    if(x != 0)
+      --x->references_;
+  }
+
+  inline friend size_t references(Hypothesis* x) {
+    return x->references_;
+  }
+};
+
+// Arena for the hypotheses of one search. Hypotheses are placed in blocks, their score breakdowns
+// and alignments are appended to flat buffers, and everything is freed at once when the pool is
+// destroyed. Hypotheses must not be used after that, the histories of a search keep its pool alive.
+// Not thread-safe, every search owns its pool.
+class HypothesisPool {
+private:
+  friend class Hypothesis;
+
+  static const size_t BLOCK_SIZE = 4096; // hypotheses per block
+  typedef std::aligned_storage<sizeof(Hypothesis), alignof(Hypothesis)>::type Storage;
+
+  std::vector<std::unique_ptr<Storage[]>> blocks_;
+  size_t used_{BLOCK_SIZE}; // hypotheses in the last block
+
+  std::vector<float> scores_;     // score breakdowns of all hypotheses
+  std::vector<float> alignments_; // alignments of all hypotheses
+
+  template <class... Args>
+  Hypothesis::PtrType create(Args&&... args) {
+    if(used_ == BLOCK_SIZE) {
+      blocks_.emplace_back(new Storage[BLOCK_SIZE]);
+      used_ = 0;
+    }
+    auto hyp = new(&blocks_.back()[used_]) Hypothesis(this, std::forward<Args>(args)...);
+    used_++;
+    return Hypothesis::PtrType(hyp);
+  }
 
-  ENABLE_INTRUSIVE_PTR(Hypothesis)
+  Hypothesis::Range append(std::vector<float>& buffer, const std::vector<float>& values) {
+    Hypothesis::Range range{buffer.size(), values.size()};
+    buffer.insert(buffer.end(), values.begin(), values.end());
+    return range;
+  }
+
+  static std::vector<float> get(const std::vector<float>& buffer, Hypothesis::Range range) {
+    return std::vector<float>(buffer.begin() + range.offset, buffer.begin() + range.offset + range.size);
+  }
+
+public:
+  HypothesisPool() {}
+  HypothesisPool(const HypothesisPool&) = delete;
+  HypothesisPool& operator=(const HypothesisPool&) = delete;
+
+  ~HypothesisPool() {
+    // newest first, a hypothesis only references older ones
+    for(size_t b = blocks_.size(); b-- > 0;) {
+      size_t count = b + 1 == blocks_.size() ? used_ : BLOCK_SIZE;
+      for(size_t i = count; i-- > 0;)
+        reinterpret_cast<Hypothesis*>(&blocks_[b][i])->~Hypothesis();
+    }
+  }
+
+  // sentence-start hypothesis
+  Hypothesis::PtrType New() { return create(); }
+
+  Hypothesis::PtrType New(const Hypothesis::PtrType& prevHyp, Word word, size_t prevBeamHypIdx, float pathScore) {
+    return create(prevHyp, word, prevBeamHypIdx, pathScore);
+  }
+
+  // number of hypotheses allocated from this pool
+  size_t size() const { return blocks_.empty() ? 0 : (blocks_.size() - 1) * BLOCK_SIZE + used_; }
 };
 
+std::vector<float> Hypothesis::getScoreBreakdown() const {
+  return HypothesisPool::get(pool_->scores_, scoreBreakdown_);
+}
+
+void Hypothesis::setScoreBreakdown(const std::vector<float>& scoreBreakdown) {
+  scoreBreakdown_ = pool_->append(pool_->scores_, scoreBreakdown);
+}
+
+std::vector<float> Hypothesis::getAlignment() const {
+  return HypothesisPool::get(pool_->alignments_, alignment_);
+}
+
+void Hypothesis::setAlignment(const std::vector<float>& align) {
+  alignment_ = pool_->append(pool_->alignments_, align);
+}
+
 typedef std::vector<IPtr<Hypothesis>> Beam;                // Beam = vector [beamSize] of hypotheses
 typedef std::vector<Beam> Beams;                          // Beams = vector [batchDim] of vector [beamSize] of hypotheses
 typedef std::tuple<Words, IPtr<Hypothesis>, float> Result; // (word ids for hyp, hyp, normalized sentence score for hyp)
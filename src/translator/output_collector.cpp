@@ -2,81 +2,35 @@
 #include "common/file_stream.h"
 #include "common/logging.h"
 
-#include <cassert>
-
 namespace marian {
 
 OutputCollector::OutputCollector()
-  : nextId_(0),
-    printing_(new DefaultPrinting()) {}
+  : printing_(new DefaultPrinting()) {
+  init(nullptr);
+}
 
 OutputCollector::OutputCollector(std::string outFile)
-  : nextId_(0),
-    outStrm_(new std::ostream(std::cout.rdbuf())),
-    printing_(new DefaultPrinting()) {
+  : printing_(new DefaultPrinting()) {
   if (outFile != "stdout")
-    outStrm_.reset(new io::OutputFileStream(outFile));
+    init(UPtr<std::ostream>(new io::OutputFileStream(outFile)));
+  else
+    init(UPtr<std::ostream>(new std::ostream(std::cout.rdbuf())));
+}
+
+void OutputCollector::init(UPtr<std::ostream> outStrm) {
+  // the printing strategy may keep state, so it is asked in order on the writer thread
+  sink_.reset(new OutputSink(std::move(outStrm), [this](long id, const std::string& best1) {
+    if(printing_->shouldBePrinted(id))
+      LOG(info, "Best translation {} : {}", id, best1);
+  }));
 }
 
 void OutputCollector::Write(long sourceId,
                             const std::string& best1,
                             const std::string& bestn,
                             bool nbest) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if(sourceId == nextId_) {
-    if(printing_->shouldBePrinted(sourceId))
-      LOG(info, "Best translation {} : {}", sourceId, best1);
-
-    if(outStrm_) {
-      if(nbest)
-        *outStrm_ << bestn << std::endl;
-      else
-        *outStrm_ << best1 << std::endl;
-    }
-
-    ++nextId_;
-
-    Outputs::const_iterator iter, iterNext;
-    iter = outputs_.begin();
-    while(iter != outputs_.end()) {
-      long currId = iter->first;
-
-      if(currId == nextId_) {
-        // 1st element in the map is the next
-        const auto& currOutput = iter->second;
-        if(printing_->shouldBePrinted(currId))
-          LOG(info, "Best translation {} : {}", currId, currOutput.first);
-
-        if(outStrm_) {
-          if(nbest)
-            *outStrm_ << currOutput.second << std::endl;
-          else
-            *outStrm_ << currOutput.first << std::endl;
-        }
-
-        ++nextId_;
-
-        // delete current record, move iter on 1
-        iterNext = iter;
-        ++iterNext;
-        outputs_.erase(iter);
-        iter = iterNext;
-      } else {
-        // not the next. stop iterating
-        assert(nextId_ < currId);
-        break;
-      }
-    }
-
-    // for 1-best, flush stdout so that we can consume this immediately from an
-    // external process
-    if(outStrm_ && !nbest)
-      *outStrm_ << std::flush;
-
-  } else {
-    // save for later
-    outputs_[sourceId] = std::make_pair(best1, bestn);
-  }
+  std::string line = (nbest ? bestn : best1) + "\n";
+  sink_->push(sourceId, std::move(line), std::string(best1));
 }
 
 StringCollector::StringCollector(bool quiet /*=false*/) : maxId_(-1), quiet_(quiet) {}
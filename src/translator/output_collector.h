@@ -2,6 +2,7 @@
 
 #include "common/definitions.h"
 #include "common/file_stream.h"
+#include "common/output_sink.h"
 
 #include <mutex>
 #include <iostream>
@@ -44,13 +45,17 @@ private:
   long next_{10};
 };
 
+// Writes translations in the order of the source sentences. Writing and logging happen on the
+// writer thread of an OutputSink, Write() only hands over the formatted line.
 class OutputCollector {
 public:
   OutputCollector();
   OutputCollector(std::string outFile);
 
   template <class T>
-  OutputCollector(T&& arg) : nextId_(0), outStrm_(new io::OutputFileStream(arg)) {}
+  OutputCollector(T&& arg) : printing_(new DefaultPrinting()) {
+    init(UPtr<std::ostream>(new io::OutputFileStream(arg)));
+  }
 
   OutputCollector(const OutputCollector&) = delete;
 
@@ -59,17 +64,19 @@ public:
              const std::string& bestn,
              bool nbest);
 
+  // blocks until everything written so far is in the output
+  void flush() { sink_->flush(); }
+
+  // has to be set before the first call to Write()
   void setPrintingStrategy(Ptr<PrintingStrategy> strategy) {
     printing_ = strategy;
   }
 
 protected:
-  typedef std::map<long, std::pair<std::string, std::string>> Outputs;
-  Outputs outputs_;
-  long nextId_;
-  UPtr<std::ostream> outStrm_;
   Ptr<PrintingStrategy> printing_;
-  std::mutex mutex_;
+  UPtr<OutputSink> sink_;
+
+  void init(UPtr<std::ostream> outStrm);
 };
 
 class StringCollector {
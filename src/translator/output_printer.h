@@ -46,11 +46,12 @@ public:
         bestn << " ||| WordScores=" << getWordScores(hypo);
 
       bestn << " |||";
-      if(hypo->getScoreBreakdown().empty()) {
+      auto scoreBreakdown = hypo->getScoreBreakdown();
+      if(scoreBreakdown.empty()) {
         bestn << " F0=" << hypo->getPathScore();
       } else {
-        for(size_t j = 0; j < hypo->getScoreBreakdown().size(); ++j) {
-          bestn << " F" << j << "= " << hypo->getScoreBreakdown()[j];
+        for(size_t j = 0; j < scoreBreakdown.size(); ++j) {
+          bestn << " F" << j << "= " << scoreBreakdown[j];
         }
       }
 
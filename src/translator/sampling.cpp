@@ -0,0 +1,93 @@
+#include "translator/sampling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace marian {
+
+OutputSampler::OutputSampler(Ptr<Options> options)
+    : topK_(options->get<size_t>("output-sampling-top-k", 0)),
+      topP_(options->get<float>("output-sampling-top-p", 1.f)),
+      temperature_(options->get<float>("output-sampling-temperature", 1.f)) {
+  ABORT_IF(topP_ <= 0.f || topP_ > 1.f, "--output-sampling-top-p must be in (0, 1]");
+  ABORT_IF(temperature_ <= 0.f, "--output-sampling-temperature must be positive");
+}
+
+IndexType OutputSampler::sample(const float* logProbs, size_t dimVocab, std::mt19937& engine, float& logProb) {
+  typedef std::pair<float, IndexType> Candidate;
+  auto better = [](const Candidate& a, const Candidate& b) { return a.first > b.first; };
+  const float invTemperature = 1.f / temperature_;
+
+  candidates_.clear();
+  float maxLogProb;
+  float total = 0.f; // unnormalized mass the top-p threshold refers to
+
+  if(topK_ > 0 && topK_ < dimVocab) {
+    // k best in one pass, candidates_ is a heap with the worst of them in front
+    for(size_t i = 0; i < dimVocab; ++i) {
+      if(candidates_.size() < topK_) {
+        candidates_.emplace_back(logProbs[i], (IndexType)i);
+        std::push_heap(candidates_.begin(), candidates_.end(), better);
+      } else if(logProbs[i] > candidates_.front().first) {
+        std::pop_heap(candidates_.begin(), candidates_.end(), better);
+        candidates_.back() = Candidate(logProbs[i], (IndexType)i);
+        std::push_heap(candidates_.begin(), candidates_.end(), better);
+      }
+    }
+    std::sort(candidates_.begin(), candidates_.end(), better);
+    maxLogProb = candidates_.front().first;
+    for(const auto& c : candidates_)
+      total += std::exp((c.first - maxLogProb) * invTemperature);
+  } else {
+    maxLogProb = *std::max_element(logProbs, logProbs + dimVocab);
+    for(size_t i = 0; i < dimVocab; ++i)
+      total += std::exp((logProbs[i] - maxLogProb) * invTemperature);
+
+    if(topP_ >= 1.f) {
+      // sample from the full (tempered) distribution by scanning the cumulative mass
+      float u = std::uniform_real_distribution<float>(0.f, total)(engine);
+      size_t i = 0;
+      for(float mass = 0.f; i + 1 < dimVocab; ++i) {
+        mass += std::exp((logProbs[i] - maxLogProb) * invTemperature);
+        if(u < mass)
+          break;
+      }
+      logProb = logProbs[i];
+      return (IndexType)i;
+    }
+
+    // top-p: select the best n candidates, doubling n until they cover the requested mass
+    for(size_t i = 0; i < dimVocab; ++i)
+      candidates_.emplace_back(logProbs[i], (IndexType)i);
+    size_t n = std::min(dimVocab, (size_t)64);
+    for(;;) {
+      std::nth_element(candidates_.begin(), candidates_.begin() + (n - 1), candidates_.end(), better);
+      float mass = 0.f;
+      for(size_t j = 0; j < n; ++j)
+        mass += std::exp((candidates_[j].first - maxLogProb) * invTemperature);
+      if(mass >= topP_ * total || n == dimVocab)
+        break;
+      n = std::min(dimVocab, 2 * n);
+    }
+    candidates_.resize(n);
+    std::sort(candidates_.begin(), candidates_.end(), better);
+  }
+
+  // cut the sorted candidates at the requested mass and draw from what is left
+  mass_.clear();
+  float mass = 0.f;
+  for(const auto& c : candidates_) {
+    mass += std::exp((c.first - maxLogProb) * invTemperature);
+    mass_.push_back(mass);
+    if(mass >= topP_ * total)
+      break;
+  }
+  float u = std::uniform_real_distribution<float>(0.f, mass_.back())(engine);
+  size_t j = std::upper_bound(mass_.begin(), mass_.end(), u) - mass_.begin();
+  j = std::min(j, mass_.size() - 1);
+
+  logProb = candidates_[j].first;
+  return candidates_[j].second;
+}
+
+}  // namespace marian
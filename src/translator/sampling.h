@@ -0,0 +1,44 @@
+#pragma once
+
+#include "common/definitions.h"
+#include "common/options.h"
+
+#include <random>
+#include <vector>
+
+namespace marian {
+
+// Samples the next word from the output distribution restricted by --output-sampling-top-k,
+// --output-sampling-top-p and --output-sampling-temperature. Works directly on a row of log
+// probabilities: top-k candidates are collected with a bounded heap in a single pass, top-p
+// candidates by growing partial selections until they cover the requested mass, and plain
+// temperature sampling draws by scanning the cumulative mass. No noise is generated for the
+// vocabulary, each draw takes a single uniform random number from the given engine.
+//
+// Not thread-safe, keeps scratch buffers between calls.
+class OutputSampler {
+private:
+  size_t topK_;
+  float topP_;
+  float temperature_;
+
+  std::vector<std::pair<float, IndexType>> candidates_; // (log prob, word index)
+  std::vector<float> mass_;                             // cumulative unnormalized probabilities of candidates_
+
+public:
+  OutputSampler(Ptr<Options> options);
+
+  // true if --output-sampling is combined with at least one of the restricted sampling options
+  static bool isEnabled(Ptr<Options> options) {
+    return options->get<bool>("output-sampling", false)
+           && (options->get<size_t>("output-sampling-top-k", 0) > 0
+               || options->get<float>("output-sampling-top-p", 1.f) < 1.f
+               || options->get<float>("output-sampling-temperature", 1.f) != 1.f);
+  }
+
+  // Draws a word index from logProbs[0..dimVocab), returns it and its log probability (without
+  // temperature) in logProb
+  IndexType sample(const float* logProbs, size_t dimVocab, std::mt19937& engine, /*out*/ float& logProb);
+};
+
+}  // namespace marian
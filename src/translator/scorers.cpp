@@ -131,4 +131,11 @@ std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<m
   return createScorers(options, ptrs);
 }
 
+std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<Ptr<ParameterStore::Model>>& models) {
+  std::vector<const void*> ptrs;
+  for(const auto& model : models)
+    ptrs.push_back(model->data());
+  return createScorers(options, ptrs);
+}
+
 }  // namespace marian
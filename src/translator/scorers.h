@@ -4,6 +4,7 @@
 
 #include "data/shortlist.h"
 #include "models/model_factory.h"
+#include "graph/parameter_store.h"
 #include "3rd_party/mio/mio.hpp"
 
 namespace marian {
@@ -156,5 +157,6 @@ Ptr<Scorer> scorerByType(const std::string& fname,
 
 std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<const void*>& ptrs);
 std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<mio::mmap_source>& mmaps);
+std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<Ptr<ParameterStore::Model>>& models);
 
 }  // namespace marian
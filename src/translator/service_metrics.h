@@ -0,0 +1,107 @@
+#pragma once
+
+#include "common/definitions.h"
+#include "data/corpus_base.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace marian {
+
+// Operational statistics of TranslateService, reported by marian-server at /metrics and in the log
+// with --metrics-log-freq. The report uses the Prometheus text format, one "name value" pair per
+// line. Latency percentiles refer to the last requests, all other numbers to the time since start.
+// Thread-safe.
+class ServiceMetrics {
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  Clock::time_point start_;
+  size_t window_; // number of latest requests the latency percentiles are computed over
+
+  std::deque<double> latencies_; // seconds, of the last window_ requests
+  size_t requests_{0};
+  size_t inFlight_{0};
+  size_t sentences_{0};  // served sentences, including cached ones
+
+  size_t batches_{0};
+  size_t batchSentences_{0};
+  size_t srcWords_{0};   // non-padding source tokens of all translated batches
+  size_t srcSlots_{0};   // source tokens including padding
+  size_t trgWords_{0};
+  std::vector<double> busy_; // seconds spent translating, per worker
+
+  std::mutex mutex_;
+
+  static double percentile(const std::vector<double>& sorted, double p) {
+    if(sorted.empty())
+      return 0.;
+    size_t i = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(std::max(i, (size_t)1), sorted.size()) - 1];
+  }
+
+public:
+  ServiceMetrics(size_t numWorkers, size_t window = 1000)
+      : start_(Clock::now()), window_(window), busy_(numWorkers, 0.) {}
+
+  // seconds since start
+  double uptime() const { return std::chrono::duration<double>(Clock::now() - start_).count(); }
+
+  void startRequest() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inFlight_++;
+  }
+
+  // returns the number of finished requests including this one
+  size_t finishRequest(double seconds, size_t sentences) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inFlight_--;
+    requests_++;
+    sentences_ += sentences;
+    latencies_.push_back(seconds);
+    if(latencies_.size() > window_)
+      latencies_.pop_front();
+    return requests_;
+  }
+
+  void addBatch(size_t worker, Ptr<data::CorpusBatch> batch, size_t trgWords, double seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batches_++;
+    batchSentences_ += batch->size();
+    srcWords_ += batch->front()->batchWords();
+    srcSlots_ += batch->front()->batchSize() * batch->front()->batchWidth();
+    trgWords_ += trgWords;
+    busy_[worker] += seconds;
+  }
+
+  // Appends the service-wide metrics to out
+  void report(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double seconds = uptime();
+    std::vector<double> sorted(latencies_.begin(), latencies_.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    out << "marian_uptime_seconds " << seconds << "\n";
+    out << "marian_requests_total " << requests_ << "\n";
+    out << "marian_requests_in_flight " << inFlight_ << "\n";
+    for(double q : {0.5, 0.95, 0.99})
+      out << "marian_request_latency_seconds{quantile=\"" << q << "\"} " << percentile(sorted, q) << "\n";
+    out << "marian_sentences_total " << sentences_ << "\n";
+    out << "marian_sentences_per_second " << sentences_ / seconds << "\n";
+    out << "marian_translated_target_tokens_total " << trgWords_ << "\n";
+    out << "marian_translated_target_tokens_per_second " << trgWords_ / seconds << "\n";
+    out << "marian_batches_total " << batches_ << "\n";
+    out << "marian_batch_size_average " << (batches_ > 0 ? (double)batchSentences_ / batches_ : 0.) << "\n";
+    out << "marian_batch_padding_ratio " << (srcSlots_ > 0 ? 1. - (double)srcWords_ / srcSlots_ : 0.) << "\n";
+    for(size_t i = 0; i < busy_.size(); ++i)
+      out << "marian_worker_busy_ratio{worker=\"" << i << "\"} " << busy_[i] / seconds << "\n";
+  }
+};
+
+}  // namespace marian
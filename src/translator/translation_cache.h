@@ -0,0 +1,100 @@
+#pragma once
+
+#include "common/logging.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace marian {
+
+// Bounded least-recently-used cache of translations, keyed by the normalized source sentence,
+// i.e. the token ids of all source streams. Used by TranslateService to skip translating exact
+// (after normalization) duplicate input sentences. Thread-safe.
+class TranslationCache {
+private:
+  typedef std::pair<std::string, std::string> Entry; // key, translation
+  typedef std::list<Entry> Entries;
+
+  size_t maxSize_;
+  Entries entries_; // most recently used first
+  std::unordered_map<std::string, Entries::iterator> index_;
+
+  size_t hits_{0};
+  size_t misses_{0};
+  size_t reportFreq_;
+
+  std::mutex mutex_;
+
+  void report() {
+    size_t lookups = hits_ + misses_;
+    if(reportFreq_ > 0 && lookups % reportFreq_ == 0)
+      LOG(info,
+          "Translation cache: {} entries, {} lookups, hit rate {:.2f}%",
+          entries_.size(), lookups, 100.f * hits_ / lookups);
+  }
+
+public:
+  // maxSize: maximum number of cached translations
+  // reportFreq: log the hit rate every that many lookups, 0 to never log
+  TranslationCache(size_t maxSize, size_t reportFreq = 1000)
+    : maxSize_(maxSize), reportFreq_(reportFreq) {}
+
+  // Looks up the translation for key and marks it as most recently used
+  bool get(const std::string& key, std::string& translation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    bool found = it != index_.end();
+    if(found) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      translation = it->second->second;
+      hits_++;
+    } else {
+      misses_++;
+    }
+    report();
+    return found;
+  }
+
+  // Inserts or updates a translation, evicts the least recently used one if the cache is full
+  void put(const std::string& key, const std::string& translation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if(it != index_.end()) {
+      it->second->second = translation;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return;
+    }
+
+    entries_.emplace_front(key, translation);
+    index_[key] = entries_.begin();
+    if(entries_.size() > maxSize_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+  }
+
+  size_t hits() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+  }
+
+  size_t misses() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+  }
+
+  float hitRate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_ + misses_ > 0 ? (float)hits_ / (hits_ + misses_) : 0.f;
+  }
+};
+
+}  // namespace marian
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <limits>
 #include <string>
+#include <unordered_map>
 
 #include "data/batch_generator.h"
 #include "data/corpus.h"
@@ -9,9 +11,15 @@
 
 #include "3rd_party/threadpool.h"
 
+#include "common/cpu_affinity.h"
+#include "graph/auto_tuner.h"
+
+#include "translator/decoding_benchmark.h"
 #include "translator/history.h"
 #include "translator/output_collector.h"
 #include "translator/output_printer.h"
+#include "translator/service_metrics.h"
+#include "translator/translation_cache.h"
 
 #include "models/model_task.h"
 #include "translator/scorers.h"
@@ -43,6 +51,12 @@ private:
   std::vector<mio::mmap_source> mmaps_;
 #endif
 
+  // with --shared-params, CPU graphs memory-map one process-wide (or per NUMA node) copy of each model
+  std::vector<std::vector<Ptr<ParameterStore::Model>>> sharedModels_; // [device][model]
+
+  // placement of the CPU workers, see affinity::pinWorker()
+  std::string cpuAffinity_;
+
 public:
   Translate(Ptr<Options> options)
     : options_(New<Options>(options->clone())) { // @TODO: clone should return Ptr<Options> same as "with"?
@@ -66,9 +80,18 @@ public:
     auto devices = Config::getDevices(options_);
     numDevices_ = devices.size();
 
+    bool sharedParams = options_->get<bool>("shared-params", false) && devices.front().type == DeviceType::cpu;
+    // the graphs are set up on the pinned worker threads, so their memory is first touched locally
+    if(devices.front().type == DeviceType::cpu)
+      cpuAffinity_ = options_->get<std::string>("cpu-affinity", "none");
+
+    if(options_->get<bool>("autotune-gemm", false) && options_->hasAndNotEmpty("autotune-gemm-cache"))
+      AutoTunerCache::load(options_->get<std::string>("autotune-gemm-cache"));
+
     ThreadPool threadPool(numDevices_, numDevices_);
     scorers_.resize(numDevices_);
     graphs_.resize(numDevices_);
+    sharedModels_.resize(numDevices_);
 
 #if MMAP
     auto models = options->get<std::vector<std::string>>("models");
@@ -83,21 +106,28 @@ public:
     size_t id = 0;
     for(auto device : devices) {
       auto task = [&](DeviceId device, size_t id) {
+        int numaNode = affinity::pinWorker(cpuAffinity_, id, numDevices_);
+
         auto graph = New<ExpressionGraph>(true);
         auto prec = options_->get<std::vector<std::string>>("precision", {"float32"});
+        if(sharedParams)
+          for(auto model : options_->get<std::vector<std::string>>("models"))
+            sharedModels_[id].push_back(ParameterStore::get(model, typeFromString(prec[0]), numaNode));
         graph->setDefaultElementType(typeFromString(prec[0]));
         graph->setDevice(device);
         graph->getBackend()->setClip(options_->get<float>("clip-gemm"));
         if (device.type == DeviceType::cpu) {
           graph->getBackend()->setOptimized(options_->get<bool>("optimize"));
+          graph->getBackend()->setAutotune(options_->get<bool>("autotune-gemm", false));
         }
+        graph->setStaticMemoryPlanning(options_->get<bool>("static-memory-planning", false));
         graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
         graphs_[id] = graph;
 
 #if MMAP
         auto scorers = createScorers(options_, mmaps_);
 #else
-        auto scorers = createScorers(options_);
+        auto scorers = sharedModels_[id].empty() ? createScorers(options_) : createScorers(options_, sharedModels_[id]);
 #endif
         for(auto scorer : scorers) {
           scorer->init(graph);
@@ -127,8 +157,26 @@ public:
   void run() override {
     data::BatchGenerator<data::Corpus> bg(corpus_, options_);
 
-    ThreadPool threadPool(numDevices_, numDevices_);
+    Ptr<DecodingBenchmark> benchmark;
+    if(options_->get<bool>("benchmark", false))
+      benchmark = New<DecodingBenchmark>(options_);
+
+    {
+      ThreadPool threadPool(numDevices_, numDevices_);
+      translate(bg, threadPool, benchmark);
+    } // wait for all batches
+    AutoTunerCache::flush(); // decisions since the last batch that was saved
+
+    if(benchmark) {
+      size_t peakWorkspace = 0;
+      for(auto graph : graphs_)
+        peakWorkspace = std::max(peakWorkspace, graph->workspacePeakBytes());
+      benchmark->report(peakWorkspace);
+    }
+  }
 
+private:
+  void translate(data::BatchGenerator<data::Corpus>& bg, ThreadPool& threadPool, Ptr<DecodingBenchmark> benchmark) {
     size_t batchId = 0;
     auto collector = New<OutputCollector>(options_->get<std::string>("output"));
     auto printer = New<OutputPrinter>(options_, trgVocab_);
@@ -139,6 +187,10 @@ public:
 
     bool doNbest = options_->get<bool>("n-best");
     for(auto batch : bg) {
+      std::vector<double> arrivals;
+      if(benchmark)
+        arrivals = benchmark->waitForArrival(batch);
+
       auto task = [=](size_t id) {
         thread_local Ptr<ExpressionGraph> graph;
         thread_local std::vector<Ptr<Scorer>> scorers;
@@ -146,11 +198,16 @@ public:
         if(!graph) {
           graph = graphs_[id % numDevices_];
           scorers = scorers_[id % numDevices_];
+          affinity::pinWorker(cpuAffinity_, id % numDevices_, numDevices_);
         }
 
+        double batchStart = benchmark ? benchmark->now() : 0.;
+
         auto search = New<Search>(options_, scorers, trgVocab_);
+        search->setProfiling(benchmark != nullptr);
         auto histories = search->search(graph, batch);
 
+        size_t trgWords = 0;
         for(auto history : histories) {
           std::stringstream best1;
           std::stringstream bestn;
@@ -159,8 +216,12 @@ public:
                            best1.str(),
                            bestn.str(),
                            doNbest);
+          if(benchmark)
+            trgWords += std::get<0>(history->top()).size();
         }
 
+        if(benchmark)
+          benchmark->add(batch, arrivals, batchStart, trgWords, search->times());
 
         // progress heartbeat for MS-internal Philly compute cluster
         // otherwise this job may be killed prematurely if no log for 4 hrs
@@ -182,18 +243,40 @@ public:
 template <class Search>
 class TranslateService : public ModelServiceTask {
 private:
+  // A loaded version of the models: one graph and its scorers per device. Every request holds on to
+  // the version it started with, so reload() can switch to a new version while requests still
+  // finish on the old one, which is released together with the last of them.
+  struct ModelVersion {
+    size_t id;
+    std::vector<std::string> models; // model files, reloaded by an empty reload request
+    std::vector<Ptr<ExpressionGraph>> graphs;
+    std::vector<std::vector<Ptr<Scorer>>> scorers;
+    // with --shared-params, CPU graphs memory-map one process-wide (or per NUMA node) copy of each model
+    std::vector<std::vector<Ptr<ParameterStore::Model>>> sharedModels; // [device][model]
+  };
+
   Ptr<Options> options_;
-  std::vector<Ptr<ExpressionGraph>> graphs_;
-  std::vector<std::vector<Ptr<Scorer>>> scorers_;
+  Ptr<ModelVersion> version_;
+  std::mutex versionMutex_; // guards version_
+  std::mutex reloadMutex_;  // one reload at a time
 
   std::vector<Ptr<Vocab>> srcVocabs_;
   Ptr<Vocab> trgVocab_;
   Ptr<const data::ShortlistGenerator> shortlistGenerator_;
 
+  std::vector<DeviceId> devices_;
   size_t numDevices_;
 
+  // placement of the CPU workers, see affinity::pinWorker()
+  std::string cpuAffinity_;
+
+  // translations of previously seen source sentences, nullptr if disabled
+  Ptr<TranslationCache> cache_;
+
+  Ptr<ServiceMetrics> metrics_;
+
 public:
-  virtual ~TranslateService() {}
+  virtual ~TranslateService() { AutoTunerCache::flush(); }
 
   TranslateService(Ptr<Options> options)
     : options_(New<Options>(options->clone())) {
@@ -219,38 +302,281 @@ public:
           options_, srcVocabs_.front(), trgVocab_, 0, 1, vocabPaths.front() == vocabPaths.back());
 
     // get device IDs
-    auto devices = Config::getDevices(options_);
-    numDevices_ = devices.size();
+    devices_ = Config::getDevices(options_);
+    numDevices_ = devices_.size();
 
-    // initialize scorers
-    for(auto device : devices) {
-      auto graph = New<ExpressionGraph>(true);
-
-      auto precison = options_->get<std::vector<std::string>>("precision", {"float32"});
-      graph->setDefaultElementType(typeFromString(precison[0])); // only use first type, used for parameter type in graph
-      graph->setDevice(device);
-      graph->getBackend()->setClip(options_->get<float>("clip-gemm"));
-      if (device.type == DeviceType::cpu) {
-        graph->getBackend()->setOptimized(options_->get<bool>("optimize"));
-      }
-      graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
-      graphs_.push_back(graph);
-
-      auto scorers = createScorers(options_);
-      for(auto scorer : scorers) {
-        scorer->init(graph);
-        if(shortlistGenerator_)
-          scorer->setShortlistGenerator(shortlistGenerator_);
-      }
-      scorers_.push_back(scorers);
+    if(devices_.front().type == DeviceType::cpu)
+      cpuAffinity_ = options_->get<std::string>("cpu-affinity", "none");
+
+    if(options_->get<bool>("autotune-gemm", false) && options_->hasAndNotEmpty("autotune-gemm-cache"))
+      AutoTunerCache::load(options_->get<std::string>("autotune-gemm-cache"));
+
+    version_ = load(options_->get<std::vector<std::string>>("models"), /*id=*/0);
+
+    auto cacheSize = options_->get<size_t>("cache-size", 0);
+    if(cacheSize > 0) {
+      if(options_->get<bool>("n-best", false))
+        LOG(warn, "[warning] Translation cache is disabled with --n-best as n-best lists contain sentence ids");
+      else
+        cache_ = New<TranslationCache>(cacheSize);
     }
+
+    if(options_->get<bool>("warmup", false))
+      warmup(version_);
+
+    metrics_ = New<ServiceMetrics>(numDevices_);
   }
 
   std::string run(const std::string& input) override {
+    timer::Timer timer;
+    metrics_->startRequest();
+
+    size_t numTranslations;
+    auto output = translateInput(input, currentVersion(), numTranslations);
+
+    size_t requests = metrics_->finishRequest(timer.elapsed(), numTranslations);
+    auto logFreq = options_->get<size_t>("metrics-log-freq", 0);
+    if(logFreq > 0 && requests % logFreq == 0) {
+      auto lines = utils::split(metrics(), "\n");
+      LOG(info, "[metrics] {}", utils::join(lines, ", "));
+    }
+    return output;
+  }
+
+  std::string metrics() override {
+    std::ostringstream out;
+    metrics_->report(out);
+    auto version = currentVersion();
+    out << "marian_model_version " << version->id << "\n";
+    for(size_t i = 0; i < version->graphs.size(); ++i)
+      out << "marian_workspace_peak_bytes{worker=\"" << i << "\"} " << version->graphs[i]->workspacePeakBytes() << "\n";
+    if(cache_) {
+      out << "marian_cache_entries " << cache_->size() << "\n";
+      out << "marian_cache_hits_total " << cache_->hits() << "\n";
+      out << "marian_cache_misses_total " << cache_->misses() << "\n";
+      out << "marian_cache_hit_ratio " << cache_->hitRate() << "\n";
+    }
+    return out.str();
+  }
+
+  // Loads the given model files (the current ones if empty) into new graphs next to the ones in
+  // use and switches to them once they are ready. Vocabularies and shortlist stay the same.
+  bool reload(const std::vector<std::string>& models) override {
+    std::lock_guard<std::mutex> reloadLock(reloadMutex_);
+    timer::Timer timer;
+
+    auto previous = currentVersion();
+    auto version = load(models.empty() ? previous->models : models, previous->id + 1);
+    if(options_->get<bool>("warmup", false))
+      warmup(version);
+
+    {
+      std::lock_guard<std::mutex> lock(versionMutex_);
+      version_ = version;
+    }
+    LOG(info,
+        "Switched to model version {} after {:.2f}s, running requests finish with version {}",
+        version->id, timer.elapsed(), previous->id);
+    return true;
+  }
+
+  // model files of the version that new requests use
+  std::vector<std::string> modelFiles() { return currentVersion()->models; }
+
+private:
+  Ptr<ModelVersion> currentVersion() {
+    std::lock_guard<std::mutex> lock(versionMutex_);
+    return version_;
+  }
+
+  // Creates the graphs and scorers of all devices for the given model files, on pinned worker
+  // threads so that their memory is first touched locally
+  Ptr<ModelVersion> load(const std::vector<std::string>& models, size_t id) {
+    auto options = options_->with("models", models);
+    bool sharedParams = options->get<bool>("shared-params", false) && devices_.front().type == DeviceType::cpu;
+
+    auto version = New<ModelVersion>();
+    version->id = id;
+    version->models = models;
+    version->graphs.resize(numDevices_);
+    version->scorers.resize(numDevices_);
+    version->sharedModels.resize(numDevices_);
+    {
+      ThreadPool threadPool(numDevices_, numDevices_);
+      for(size_t i = 0; i < numDevices_; ++i) {
+        auto task = [&](DeviceId device, size_t i) {
+          int numaNode = affinity::pinWorker(cpuAffinity_, i, numDevices_);
+
+          auto graph = New<ExpressionGraph>(true);
+
+          auto precison = options->get<std::vector<std::string>>("precision", {"float32"});
+          if(sharedParams)
+            for(auto model : models) // a reloaded file is a new entry of the store, see version id
+              version->sharedModels[i].push_back(
+                  ParameterStore::get(model, typeFromString(precison[0]), numaNode, id));
+
+          graph->setDefaultElementType(typeFromString(precison[0])); // only use first type, used for parameter type in graph
+          graph->setDevice(device);
+          graph->getBackend()->setClip(options->get<float>("clip-gemm"));
+          if (device.type == DeviceType::cpu) {
+            graph->getBackend()->setOptimized(options->get<bool>("optimize"));
+            graph->getBackend()->setAutotune(options->get<bool>("autotune-gemm", false));
+          }
+          graph->setStaticMemoryPlanning(options->get<bool>("static-memory-planning", false));
+          graph->reserveWorkspaceMB(options->get<size_t>("workspace"));
+          version->graphs[i] = graph;
+
+          auto scorers = version->sharedModels[i].empty() ? createScorers(options) : createScorers(options, version->sharedModels[i]);
+          for(auto scorer : scorers) {
+            scorer->init(graph);
+            if(shortlistGenerator_)
+              scorer->setShortlistGenerator(shortlistGenerator_);
+          }
+          version->scorers[i] = scorers;
+        };
+        threadPool.enqueue(task, devices_[i], i);
+      }
+    } // wait for all graphs
+    return version;
+  }
+
+  // Translates a request with the given model version, returns the translations and their number
+  // in numTranslations
+  std::string translateInput(const std::string& input,
+                             Ptr<ModelVersion> version,
+                             /*out*/ size_t& numTranslations) {
     // split tab-separated input into fields if necessary
     auto inputs = options_->get<bool>("tsv", false)
                       ? convertTsvToLists(input, options_->get<size_t>("tsv-fields", 1))
                       : std::vector<std::string>({input});
+    if(!cache_) {
+      auto translations = translate(inputs, version);
+      numTranslations = translations.size();
+      return utils::join(translations, "\n");
+    }
+
+    // split the input(s) into sentences, TextInput stops at the end of the shortest input
+    std::vector<std::vector<std::string>> sentences(inputs.size());
+    size_t numSentences = std::numeric_limits<size_t>::max();
+    for(size_t i = 0; i < inputs.size(); ++i) {
+      std::istringstream inputStream(inputs[i]);
+      std::string line;
+      while(io::getline(inputStream, line))
+        sentences[i].push_back(line);
+      numSentences = std::min(numSentences, sentences[i].size());
+    }
+
+    // look up every sentence and collect the missing ones, duplicates within the input are translated once
+    std::vector<std::string> translations(numSentences);
+    std::vector<std::string> keys(numSentences);
+    std::vector<size_t> missing(numSentences, std::string::npos); // index into missingKeys for sentences not found
+    std::vector<std::string> missingKeys;
+    std::unordered_map<std::string, size_t> missingIndex;
+    std::vector<std::string> missingInputs(inputs.size());
+    for(size_t j = 0; j < numSentences; ++j) {
+      // normalize by the token ids of the source sentence(s), translations of other model versions
+      // are not used and age out of the cache
+      keys[j] = std::to_string(version->id) + "\t";
+      for(size_t i = 0; i < inputs.size(); ++i) {
+        for(auto word : srcVocabs_[i]->encode(sentences[i][j], /*addEOS=*/true, /*inference=*/true))
+          keys[j] += word.toString() + " ";
+        keys[j] += "\t";
+      }
+
+      if(cache_->get(keys[j], translations[j]))
+        continue;
+
+      auto it = missingIndex.find(keys[j]);
+      if(it == missingIndex.end()) {
+        it = missingIndex.emplace(keys[j], missingKeys.size()).first;
+        missingKeys.push_back(keys[j]);
+        for(size_t i = 0; i < inputs.size(); ++i)
+          missingInputs[i] += sentences[i][j] + "\n";
+      }
+      missing[j] = it->second;
+    }
+
+    if(!missingKeys.empty()) {
+      auto missingTranslations = translate(missingInputs, version);
+      for(size_t k = 0; k < missingKeys.size(); ++k)
+        cache_->put(missingKeys[k], missingTranslations[k]);
+      for(size_t j = 0; j < numSentences; ++j)
+        if(missing[j] != std::string::npos)
+          translations[j] = missingTranslations[missing[j]];
+    }
+
+    numTranslations = translations.size();
+    return utils::join(translations, "\n");
+  }
+
+  // Translates sample inputs with every worker graph before the first request arrives, so that the
+  // workspaces have grown to their working size and packed or quantized weights, output layers and
+  // other lazily created parts of the models already exist. Uses --warmup-input if given, otherwise
+  // sentences of several lengths made up of vocabulary items.
+  void warmup(Ptr<ModelVersion> version) {
+    timer::Timer timer;
+
+    std::vector<std::string> inputs;
+    if(options_->hasAndNotEmpty("warmup-input")) {
+      io::InputFileStream in(options_->get<std::string>("warmup-input"));
+      std::string text, line;
+      while(io::getline(in, line))
+        text += line + "\n";
+      inputs = options_->get<bool>("tsv", false)
+                   ? convertTsvToLists(text, options_->get<size_t>("tsv-fields", 1))
+                   : std::vector<std::string>({text});
+    } else {
+      // one mini-batch of each length, capped by --max-length
+      size_t miniBatch = std::max(options_->get<int>("mini-batch"), 1);
+      size_t maxLength = options_->get<size_t>("max-length");
+      for(auto vocab : srcVocabs_) {
+        std::string text;
+        for(size_t length : {1, 8, 32, 128}) {
+          length = std::min(length, maxLength > 1 ? maxLength - 1 : 1); // leave room for EOS
+          for(size_t i = 0; i < miniBatch; ++i) {
+            Words words;
+            size_t first = std::min((size_t)2, vocab->size() - 1); // skip </s> and <unk> at the start
+            for(size_t j = 0; j < length; ++j) // spread over the vocabulary
+              words.push_back(Word::fromWordIndex(first + (i * 7919 + j * 104729) % (vocab->size() - first)));
+            text += vocab->decode(words) + "\n";
+          }
+        }
+        inputs.push_back(text);
+      }
+    }
+
+    auto corpus = New<data::TextInput>(inputs, srcVocabs_, options_);
+    data::BatchGenerator<data::TextInput> batchGenerator(corpus, options_);
+    batchGenerator.prepare();
+
+    std::vector<Ptr<data::CorpusBatch>> batches;
+    size_t sentences = 0;
+    for(auto batch : batchGenerator) {
+      batches.push_back(batch);
+      sentences += batch->size();
+    }
+
+    // every worker translates all batches
+    {
+      ThreadPool threadPool(numDevices_, numDevices_);
+      for(size_t id = 0; id < numDevices_; ++id) {
+        auto task = [&](size_t id) {
+          affinity::pinWorker(cpuAffinity_, id, numDevices_);
+          for(auto batch : batches) {
+            auto search = New<Search>(options_, version->scorers[id], trgVocab_);
+            search->search(version->graphs[id], batch);
+          }
+        };
+        threadPool.enqueue(task, id);
+      }
+    } // wait for all workers
+
+    LOG(info, "Warmed up {} worker(s) of model version {} with {} sentences in {:.2f}s",
+        numDevices_, version->id, sentences, timer.elapsed());
+  }
+
+  // Translates the given (tab-separated) inputs, returns one translation per sentence
+  std::vector<std::string> translate(const std::vector<std::string>& inputs, Ptr<ModelVersion> version) {
     auto corpus_ = New<data::TextInput>(inputs, srcVocabs_, options_);
     data::BatchGenerator<data::TextInput> batchGenerator(corpus_, options_);
 
@@ -267,21 +593,28 @@ public:
         auto task = [=](size_t id) {
           thread_local Ptr<ExpressionGraph> graph;
           thread_local std::vector<Ptr<Scorer>> scorers;
+          thread_local size_t worker;
 
           if(!graph) {
-            graph = graphs_[id % numDevices_];
-            scorers = scorers_[id % numDevices_];
+            worker = id % numDevices_;
+            graph = version->graphs[worker];
+            scorers = version->scorers[worker];
+            affinity::pinWorker(cpuAffinity_, worker, numDevices_);
           }
 
+          timer::Timer batchTimer;
           auto search = New<Search>(options_, scorers, trgVocab_);
           auto histories = search->search(graph, batch);
 
+          size_t trgWords = 0;
           for(auto history : histories) {
             std::stringstream best1;
             std::stringstream bestn;
             printer->print(history, best1, bestn);
             collector->add((long)history->getLineNum(), best1.str(), bestn.str());
+            trgWords += std::get<0>(history->top()).size();
           }
+          metrics_->addBatch(worker, batch, trgWords, batchTimer.elapsed());
         };
 
         threadPool_.enqueue(task, batchId);
@@ -289,11 +622,9 @@ public:
       }
     }
 
-    auto translations = collector->collect(options_->get<bool>("n-best"));
-    return utils::join(translations, "\n");
+    return collector->collect(options_->get<bool>("n-best"));
   }
 
-private:
   // Converts a multi-line input with tab-separated source(s) and target sentences into separate lists
   // of sentences from source(s) and target sides, e.g.
   // "src1 \t trg1 \n src2 \t trg2" -> ["src1 \n src2", "trg1 \n trg2"]